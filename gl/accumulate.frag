@@ -0,0 +1,9 @@
+#version 120
+
+uniform sampler2D sample_texture;
+
+varying vec2 tex_coord;
+
+void main() {
+    gl_FragColor = texture2D(sample_texture, tex_coord);
+}
@@ -0,0 +1,9 @@
+#version 120
+attribute vec2 vertex_position;
+
+varying vec2 tex_coord;
+
+void main() {
+    gl_Position = vec4(vertex_position, 0.0, 1.0);
+    tex_coord = vertex_position*0.5 + 0.5;
+}
@@ -0,0 +1,11 @@
+#version 450 core
+
+uniform sampler2D sample_texture;
+
+in vec2 tex_coord;
+
+out vec4 frag_color;
+
+void main() {
+    frag_color = texture(sample_texture, tex_coord);
+}
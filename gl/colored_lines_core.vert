@@ -0,0 +1,14 @@
+#version 450 core
+in vec3 vertex_position;
+in vec3 vertex_color;
+
+uniform mat4 transform_matrix;
+uniform mat4 view_matrix;
+
+out vec3 frag_color;
+
+void main() {
+    gl_Position = view_matrix*transform_matrix*
+        vec4(vertex_position, 1.0);
+    frag_color = vertex_color;
+}
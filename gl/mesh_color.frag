@@ -0,0 +1,35 @@
+#version 120
+#extension GL_EXT_gpu_shader4 : require
+
+uniform float zoom;
+
+// Colour of each triangle, in rows of 4096 (see GLMesh::COLOR_TEXTURE_WIDTH)
+uniform sampler2D face_colors;
+uniform int primitive_offset;
+
+varying vec3 ec_pos;
+
+void main() {
+    vec3 base3 = vec3(0.99, 0.96, 0.89);
+    vec3 base2 = vec3(0.92, 0.91, 0.83);
+    vec3 base00 = vec3(0.40, 0.48, 0.51);
+
+    // Faces with a colour of their own replace the default palette
+    int i = primitive_offset + gl_PrimitiveID;
+    vec4 face = texelFetch2D(face_colors, ivec2(i & 4095, i >> 12), 0);
+    if (face.a > 0.0) {
+        base3 = mix(face.rgb, vec3(1.0), 0.2);
+        base2 = face.rgb;
+        base00 = face.rgb*0.4;
+    }
+
+    vec3 ec_normal = normalize(cross(dFdx(ec_pos), dFdy(ec_pos)));
+    ec_normal.z *= zoom;
+    ec_normal = normalize(ec_normal);
+
+    float a = dot(ec_normal, vec3(0.0, 0.0, 1.0));
+    float b = dot(ec_normal, vec3(-0.57, -0.57, 0.57));
+
+    gl_FragColor = vec4((a*base2 + (1-a)*base00)*0.5 +
+                        (b*base3 + (1-b)*base00)*0.5, 1.0);
+}
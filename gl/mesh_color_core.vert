@@ -0,0 +1,22 @@
+#version 450 core
+layout(location = 0) in vec3 vertex_position;
+
+// First triangle of the cluster being drawn (an instanced attribute)
+layout(location = 1) in uint first_triangle;
+
+layout(std140, binding = 0) uniform MeshUniforms
+{
+    mat4 transform_matrix;
+    mat4 view_matrix;
+    float zoom;
+};
+
+out vec3 ec_pos;
+flat out uint primitive_offset;
+
+void main() {
+    gl_Position = view_matrix*transform_matrix*
+        vec4(vertex_position, 1.0);
+    ec_pos = gl_Position.xyz;
+    primitive_offset = first_triangle;
+}
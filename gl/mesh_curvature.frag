@@ -0,0 +1,27 @@
+#version 120
+
+uniform float zoom;
+
+varying vec3 ec_pos;
+varying float curvature;
+
+void main() {
+    // Blue where curvature is negative, red where it's positive, and the
+    // usual surface colour where the mesh is flat
+    vec3 flat_color = vec3(0.92, 0.91, 0.83);
+    vec3 base2 = curvature < 0.0
+        ? mix(flat_color, vec3(0.15, 0.35, 0.80), -curvature)
+        : mix(flat_color, vec3(0.80, 0.20, 0.15), curvature);
+    vec3 base3 = mix(base2, vec3(1.0), 0.2);
+    vec3 base00 = base2*0.4;
+
+    vec3 ec_normal = normalize(cross(dFdx(ec_pos), dFdy(ec_pos)));
+    ec_normal.z *= zoom;
+    ec_normal = normalize(ec_normal);
+
+    float a = dot(ec_normal, vec3(0.0, 0.0, 1.0));
+    float b = dot(ec_normal, vec3(-0.57, -0.57, 0.57));
+
+    gl_FragColor = vec4((a*base2 + (1-a)*base00)*0.5 +
+                        (b*base3 + (1-b)*base00)*0.5, 1.0);
+}
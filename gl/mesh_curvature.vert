@@ -0,0 +1,25 @@
+#version 120
+attribute vec3 vertex_position;
+
+// Mean and Gaussian curvature of the vertex
+attribute vec2 vertex_curvature;
+
+uniform mat4 transform_matrix;
+uniform mat4 view_matrix;
+
+// Which curvature to show (0 for mean, 1 for Gaussian), and the value
+// that gets the full colour
+uniform int curvature_component;
+uniform float curvature_range;
+
+varying vec3 ec_pos;
+varying float curvature;
+
+void main() {
+    gl_Position = view_matrix*transform_matrix*
+        vec4(vertex_position, 1.0);
+    ec_pos = gl_Position.xyz;
+
+    float c = curvature_component == 0 ? vertex_curvature.x : vertex_curvature.y;
+    curvature = clamp(c / curvature_range, -1.0, 1.0);
+}
@@ -0,0 +1,29 @@
+#version 450 core
+layout(location = 0) in vec3 vertex_position;
+
+// Mean and Gaussian curvature of the vertex
+layout(location = 2) in vec2 vertex_curvature;
+
+layout(std140, binding = 0) uniform MeshUniforms
+{
+    mat4 transform_matrix;
+    mat4 view_matrix;
+    float zoom;
+};
+
+// Which curvature to show (0 for mean, 1 for Gaussian), and the value
+// that gets the full colour
+uniform int curvature_component;
+uniform float curvature_range;
+
+out vec3 ec_pos;
+out float curvature;
+
+void main() {
+    gl_Position = view_matrix*transform_matrix*
+        vec4(vertex_position, 1.0);
+    ec_pos = gl_Position.xyz;
+
+    float c = curvature_component == 0 ? vertex_curvature.x : vertex_curvature.y;
+    curvature = clamp(c / curvature_range, -1.0, 1.0);
+}
@@ -0,0 +1,13 @@
+#version 120
+attribute vec3 vertex_position;
+
+uniform mat4 transform_matrix;
+uniform mat4 view_matrix;
+uniform float point_size;
+
+void main() {
+    gl_Position = view_matrix*transform_matrix*
+        vec4(vertex_position, 1.0);
+    // Nearer splats are drawn larger, so that they keep covering the surface
+    gl_PointSize = max(point_size / gl_Position.w, 1.0);
+}
@@ -0,0 +1,23 @@
+#version 450 core
+
+out vec4 frag_color;
+
+void main() {
+    vec3 base3 = vec3(0.99, 0.96, 0.89);
+    vec3 base2 = vec3(0.92, 0.91, 0.83);
+    vec3 base00 = vec3(0.40, 0.48, 0.51);
+
+    // Round off the splat and shade it as a sphere facing the viewer,
+    // since points have no surface normal
+    vec2 p = gl_PointCoord*2.0 - 1.0;
+    float r2 = dot(p, p);
+    if (r2 > 1.0)
+        discard;
+    vec3 ec_normal = vec3(p.x, -p.y, sqrt(1.0 - r2));
+
+    float a = dot(ec_normal, vec3(0.0, 0.0, 1.0));
+    float b = dot(ec_normal, vec3(-0.57, -0.57, 0.57));
+
+    frag_color = vec4((a*base2 + (1-a)*base00)*0.5 +
+                      (b*base3 + (1-b)*base00)*0.5, 1.0);
+}
@@ -0,0 +1,17 @@
+#version 450 core
+layout(location = 0) in vec3 vertex_position;
+
+layout(std140, binding = 0) uniform MeshUniforms
+{
+    mat4 transform_matrix;
+    mat4 view_matrix;
+    float zoom;
+    float point_size;
+};
+
+void main() {
+    gl_Position = view_matrix*transform_matrix*
+        vec4(vertex_position, 1.0);
+    // Nearer splats are drawn larger, so that they keep covering the surface
+    gl_PointSize = max(point_size / gl_Position.w, 1.0);
+}
@@ -0,0 +1,24 @@
+#version 450 core
+
+layout(std140, binding = 0) uniform MeshUniforms
+{
+    mat4 transform_matrix;
+    mat4 view_matrix;
+    float zoom;
+};
+
+in vec3 ec_pos;
+
+out vec4 frag_color;
+
+void main() {
+    vec3 ec_normal = normalize(cross(dFdx(ec_pos), dFdy(ec_pos)));
+    ec_normal.z *= zoom;
+    ec_normal = normalize(ec_normal);
+    //rotated 10deg around the red axis for better color match
+    float x = dot(ec_normal, vec3(1.0, 0.0, 0.0));
+    float y = dot(ec_normal, vec3(0.0, 0.985, 0.174));
+    float z = dot(ec_normal, vec3(0.0, -0.174, 0.985));
+
+    frag_color = vec4(0.5-0.5*x, 0.5-0.5*y, 0.5+0.5*z, 1.0);
+}
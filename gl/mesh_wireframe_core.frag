@@ -0,0 +1,9 @@
+#version 450 core
+
+in vec3 ec_pos;
+
+out vec4 frag_color;
+
+void main() {
+    frag_color = vec4(1.0, 1.0, 1.0, 1.0);
+}
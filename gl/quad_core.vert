@@ -0,0 +1,10 @@
+#version 450 core
+in vec2 vertex_position;
+in vec3 vertex_color;
+
+out vec3 frag_color;
+
+void main() {
+    gl_Position = vec4(vertex_position, 0.9, 1.0);
+    frag_color = vertex_color;
+}
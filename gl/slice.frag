@@ -0,0 +1,9 @@
+#version 120
+
+uniform sampler2D slice;
+
+varying vec2 frag_texcoord;
+
+void main() {
+    gl_FragColor = texture2D(slice, frag_texcoord);
+}
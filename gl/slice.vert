@@ -0,0 +1,14 @@
+#version 120
+attribute vec3 vertex_position;
+attribute vec2 vertex_texcoord;
+
+uniform mat4 transform_matrix;
+uniform mat4 view_matrix;
+
+varying vec2 frag_texcoord;
+
+void main() {
+    gl_Position = view_matrix*transform_matrix*
+        vec4(vertex_position, 1.0);
+    frag_texcoord = vertex_texcoord;
+}
@@ -0,0 +1,11 @@
+#version 450 core
+
+uniform sampler2D slice;
+
+in vec2 frag_texcoord;
+
+out vec4 out_color;
+
+void main() {
+    out_color = texture(slice, frag_texcoord);
+}
@@ -0,0 +1,126 @@
+#include <QOpenGLContext>
+#include <QOpenGLExtraFunctions>
+#include <QOpenGLFramebufferObject>
+
+#include "accumulator.h"
+#include "glcore.h"
+
+Accumulator::Accumulator()
+    : sample(nullptr), average(nullptr), count(0)
+{
+    initializeOpenGLFunctions();
+
+    shader.addCacheableShaderFromSourceFile(QOpenGLShader::Vertex, gl_shader_path("accumulate.vert"));
+    shader.addCacheableShaderFromSourceFile(QOpenGLShader::Fragment, gl_shader_path("accumulate.frag"));
+    shader.link();
+
+    float vbuf[] = {-1, -1,  -1, 1,  1, -1,  1, 1};
+    vertices.create();
+    vertices.bind();
+    vertices.allocate(vbuf, sizeof(vbuf));
+    vertices.release();
+}
+
+Accumulator::~Accumulator()
+{
+    delete sample;
+    delete average;
+}
+
+bool Accumulator::supported()
+{
+    const QOpenGLContext* context = QOpenGLContext::currentContext();
+    return QOpenGLFramebufferObject::hasOpenGLFramebufferBlit() &&
+           (context->format().majorVersion() >= 3 ||
+            context->hasExtension("GL_ARB_texture_float"));
+}
+
+void Accumulator::begin_sample(const QSize& size)
+{
+    if (!sample || sample->size() != size)
+    {
+        delete sample;
+        delete average;
+        sample = new QOpenGLFramebufferObject(
+                size, QOpenGLFramebufferObject::CombinedDepthStencil);
+        // Half floats keep the average of many samples free of banding
+        average = new QOpenGLFramebufferObject(
+                size, QOpenGLFramebufferObject::NoAttachment,
+                GL_TEXTURE_2D, GL_RGBA16F);
+        count = 0;
+    }
+    sample->bind();
+    glViewport(0, 0, size.width(), size.height());
+}
+
+void Accumulator::end_sample(GLuint target)
+{
+    // Blend with weight 1/(n + 1), which keeps a running mean of all
+    // samples so far (the first sample replaces whatever was there)
+    average->bind();
+    glDisable(GL_DEPTH_TEST);
+    glEnable(GL_BLEND);
+    glBlendColor(0, 0, 0, 1.0f / (count + 1));
+    glBlendFuncSeparate(GL_CONSTANT_ALPHA, GL_ONE_MINUS_CONSTANT_ALPHA,
+                        GL_ONE, GL_ZERO);
+
+    shader.bind();
+    vertices.bind();
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, sample->texture());
+    shader.setUniformValue("sample_texture", 0);
+
+    const GLuint vp = shader.attributeLocation("vertex_position");
+    glEnableVertexAttribArray(vp);
+    glVertexAttribPointer(vp, 2, GL_FLOAT, false, 2 * sizeof(GLfloat), 0);
+    glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+    glDisableVertexAttribArray(vp);
+
+    glBindTexture(GL_TEXTURE_2D, 0);
+    vertices.release();
+    shader.release();
+    glDisable(GL_BLEND);
+    glEnable(GL_DEPTH_TEST);
+
+    count++;
+    present(target);
+}
+
+void Accumulator::present(GLuint target)
+{
+    // Anything drawn on top (e.g. the axes) is tested against the depth
+    // of the last sample, which is off by at most a pixel.
+    QOpenGLExtraFunctions* f = QOpenGLContext::currentContext()->extraFunctions();
+    const QSize size = average->size();
+    f->glBindFramebuffer(GL_DRAW_FRAMEBUFFER, target);
+    f->glBindFramebuffer(GL_READ_FRAMEBUFFER, average->handle());
+    f->glBlitFramebuffer(0, 0, size.width(), size.height(),
+                         0, 0, size.width(), size.height(),
+                         GL_COLOR_BUFFER_BIT, GL_NEAREST);
+    f->glBindFramebuffer(GL_READ_FRAMEBUFFER, sample->handle());
+    f->glBlitFramebuffer(0, 0, size.width(), size.height(),
+                         0, 0, size.width(), size.height(),
+                         GL_DEPTH_BUFFER_BIT, GL_NEAREST);
+    f->glBindFramebuffer(GL_FRAMEBUFFER, target);
+}
+
+QVector2D Accumulator::jitter() const
+{
+    // Halton (2, 3) points cover the pixel evenly for any sample count.
+    // The first sample is centered, so it matches an ordinary frame.
+    if (count == 0)
+    {
+        return QVector2D();
+    }
+    auto halton = [](int i, int base)
+    {
+        float f = 1, r = 0;
+        for (; i > 0; i /= base)
+        {
+            f /= base;
+            r += f * (i % base);
+        }
+        return r;
+    };
+    return QVector2D(halton(count, 2) - 0.5f, halton(count, 3) - 0.5f);
+}
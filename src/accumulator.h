@@ -0,0 +1,50 @@
+#ifndef ACCUMULATOR_H
+#define ACCUMULATOR_H
+
+#include <QOpenGLBuffer>
+#include <QOpenGLShaderProgram>
+#include <QOpenGLFunctions>
+#include <QVector2D>
+
+class QOpenGLFramebufferObject;
+
+/*
+ *  Averages jittered renders of a still view into a floating-point
+ *  framebuffer, for progressive anti-aliasing while the view is idle.
+ */
+class Accumulator : protected QOpenGLFunctions
+{
+public:
+    Accumulator();
+    ~Accumulator();
+
+    /*  Checks for float render targets and framebuffer blits */
+    static bool supported();
+
+    /*  Binds (and clears) the framebuffer that the next sample should be
+     *  drawn into, resizing the buffers if needed */
+    void begin_sample(const QSize& size);
+
+    /*  Blends the sample into the running average, then copies the
+     *  average (and the sample's depth) into the target framebuffer */
+    void end_sample(GLuint target);
+
+    /*  Copies the current average into the target framebuffer */
+    void present(GLuint target);
+
+    /*  Sub-pixel offset (in pixels) for the next sample */
+    QVector2D jitter() const;
+
+    int samples() const { return count; }
+    void reset() { count = 0; }
+
+private:
+    QOpenGLShaderProgram shader;
+    QOpenGLBuffer vertices;
+
+    QOpenGLFramebufferObject* sample;
+    QOpenGLFramebufferObject* average;
+    int count;
+};
+
+#endif // ACCUMULATOR_H
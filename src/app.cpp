@@ -1,14 +1,39 @@
 #include <QDebug>
 #include <QFileOpenEvent>
+#include <QCommandLineParser>
 
 #include "app.h"
 #include "window.h"
+#include "profile.h"
+#include "cli.h"
 
 App::App(int& argc, char *argv[]) :
-    QApplication(argc, argv), window(new Window())
+    QApplication(argc, argv), window(nullptr)
 {
-    if (argc > 1)
-        window->load_stl(argv[1]);
+    QCommandLineParser parser;
+    cli_add_options(parser);
+
+    // parse() rather than process(), so that unexpected options (e.g. the
+    // -psn_* argument added by older macOS launchers) aren't fatal
+    parser.parse(arguments());
+    if (parser.isSet("help"))
+        parser.showHelp();
+    if (parser.isSet("version"))
+        parser.showVersion();
+    if (parser.isSet("startup-profile"))
+        StartupProfile::enable();
+    StartupProfile::mark("QApplication constructed");
+
+    window = new Window(nullptr, parser.isSet("gl-core"));
+    StartupProfile::mark("Window constructed");
+
+    // The loader thread starts here, so that reading the file overlaps
+    // with showing the window and setting up GL
+    const auto files = parser.positionalArguments();
+    if (parser.isSet("ingest"))
+        window->start_ingest(parser.value("ingest"));
+    else if (!files.isEmpty())
+        window->load_stl(files.first());
     else
         window->load_stl(":gl/sphere.stl");
     window->show();
@@ -14,7 +14,7 @@ public:
 protected:
     bool event(QEvent* e) override;
 private:
-    Window* const window;
+    Window* window;
 
 };
 
@@ -1,4 +1,5 @@
 #include "axis.h"
+#include "glcore.h"
 
 const float xLet[] = {
     -0.1, -0.2, 0,
@@ -29,9 +30,9 @@ Axis::Axis()
 {
     initializeOpenGLFunctions();
 
-    shader.addShaderFromSourceFile(QOpenGLShader::Vertex, ":/gl/colored_lines.vert");
-    shader.addShaderFromSourceFile(QOpenGLShader::Fragment, ":/gl/colored_lines.frag");
-    shader.link();
+    shader.addCacheableShaderFromSourceFile(QOpenGLShader::Vertex, gl_shader_path("colored_lines.vert"));
+    shader.addCacheableShaderFromSourceFile(QOpenGLShader::Fragment, gl_shader_path("colored_lines.frag"));
+    // Linked in draw(), since axes are hidden by default
     const int ptSize = 6*sizeof(float);
     for(int lIdx = 0; lIdx < 3; lIdx++)
     {
@@ -96,6 +97,10 @@ void Axis::setScale(QVector3D min, QVector3D max)
 void Axis::draw(QMatrix4x4 transMat, QMatrix4x4 viewMat,
     QMatrix4x4 orientMat, QMatrix4x4 aspectMat, float aspectRatio)
 {
+    if (!shader.isLinked())
+    {
+        shader.link();
+    }
     shader.bind();
     vertices.bind();
     // Load the transform and view matrices into the shader
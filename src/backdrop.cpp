@@ -1,11 +1,12 @@
 #include "backdrop.h"
+#include "glcore.h"
 
 Backdrop::Backdrop()
 {
     initializeOpenGLFunctions();
 
-    shader.addShaderFromSourceFile(QOpenGLShader::Vertex, ":/gl/quad.vert");
-    shader.addShaderFromSourceFile(QOpenGLShader::Fragment, ":/gl/quad.frag");
+    shader.addCacheableShaderFromSourceFile(QOpenGLShader::Vertex, gl_shader_path("quad.vert"));
+    shader.addCacheableShaderFromSourceFile(QOpenGLShader::Fragment, gl_shader_path("quad.frag"));
     shader.link();
 
     float vbuf[] = {
@@ -37,7 +38,7 @@ void Backdrop::draw()
                           5 * sizeof(GLfloat),
                           (GLvoid*)(2 * sizeof(GLfloat)));
 
-    glDrawArrays(GL_TRIANGLE_STRIP, 0, 8);
+    glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
 
     vertices.release();
     shader.release();
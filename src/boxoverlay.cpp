@@ -0,0 +1,87 @@
+#include "boxoverlay.h"
+#include "hull.h"
+#include "glcore.h"
+
+BoxOverlay::BoxOverlay()
+    : visible(false)
+{
+    initializeOpenGLFunctions();
+
+    shader.addCacheableShaderFromSourceFile(QOpenGLShader::Vertex, gl_shader_path("colored_lines.vert"));
+    shader.addCacheableShaderFromSourceFile(QOpenGLShader::Fragment, gl_shader_path("colored_lines.frag"));
+    // Linked in draw(), since the box is hidden by default
+
+    vertices.create();
+}
+
+void BoxOverlay::set_box(const OrientedBox* box)
+{
+    visible = box != nullptr;
+    if (!box)
+    {
+        return;
+    }
+
+    QVector3D corners[8];
+    box->corners(corners);
+
+    // Each of the twelve edges joins two corners that differ in one bit,
+    // with 6 floats (position and colour) per end
+    float vbuf[12*2*6];
+    float* v = vbuf;
+    for (int i=0; i < 8; ++i)
+    {
+        for (int bit=1; bit < 8; bit <<= 1)
+        {
+            if (i & bit)
+            {
+                continue;
+            }
+            for (const QVector3D& c : {corners[i], corners[i | bit]})
+            {
+                *v++ = c.x();
+                *v++ = c.y();
+                *v++ = c.z();
+                *v++ = 1.0f;
+                *v++ = 0.8f;
+                *v++ = 0.2f;
+            }
+        }
+    }
+    vertices.bind();
+    vertices.allocate(vbuf, sizeof(vbuf));
+    vertices.release();
+}
+
+void BoxOverlay::draw(const QMatrix4x4& transform, const QMatrix4x4& view)
+{
+    if (!visible)
+    {
+        return;
+    }
+    if (!shader.isLinked())
+    {
+        shader.link();
+    }
+
+    shader.bind();
+    glUniformMatrix4fv(shader.uniformLocation("transform_matrix"),
+                       1, GL_FALSE, transform.data());
+    glUniformMatrix4fv(shader.uniformLocation("view_matrix"),
+                       1, GL_FALSE, view.data());
+
+    vertices.bind();
+    const GLuint vp = shader.attributeLocation("vertex_position");
+    const GLuint vc = shader.attributeLocation("vertex_color");
+    glEnableVertexAttribArray(vp);
+    glEnableVertexAttribArray(vc);
+    glVertexAttribPointer(vp, 3, GL_FLOAT, false, 6 * sizeof(GLfloat), 0);
+    glVertexAttribPointer(vc, 3, GL_FLOAT, false, 6 * sizeof(GLfloat),
+                          (GLvoid*)(3 * sizeof(GLfloat)));
+    glDrawArrays(GL_LINES, 0, 12*2);
+    glDisableVertexAttribArray(vp);
+    glDisableVertexAttribArray(vc);
+    vertices.release();
+
+    shader.release();
+}
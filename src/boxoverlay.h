@@ -0,0 +1,29 @@
+#ifndef BOXOVERLAY_H
+#define BOXOVERLAY_H
+
+#include <QOpenGLBuffer>
+#include <QOpenGLShaderProgram>
+#include <QOpenGLFunctions>
+
+struct OrientedBox;
+
+/*
+ *  Overlay that draws the edges of an OrientedBox in model space
+ */
+class BoxOverlay : protected QOpenGLFunctions
+{
+public:
+    BoxOverlay();
+
+    /*  Copies the box to draw, or hides the overlay if box is null */
+    void set_box(const OrientedBox* box);
+
+    void draw(const QMatrix4x4& transform, const QMatrix4x4& view);
+
+private:
+    QOpenGLShaderProgram shader;
+    QOpenGLBuffer vertices;
+    bool visible;
+};
+
+#endif // BOXOVERLAY_H
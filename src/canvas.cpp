@@ -1,20 +1,57 @@
+#include <QElapsedTimer>
 #include <QMouseEvent>
+#include <QOpenGLExtraFunctions>
+#include <QOpenGLFramebufferObject>
+#include <QOpenGLFunctions_4_5_Core>
 
 #include <cmath>
 
 #include "canvas.h"
 #include "backdrop.h"
 #include "axis.h"
+#include "accumulator.h"
+#include "depthpyramid.h"
 #include "glmesh.h"
 #include "mesh.h"
+#include "ingest.h"
+#include "profile.h"
+#include "glcore.h"
+#include "lodmesh.h"
+#include "plate.h"
+#include "preview.h"
+#include "slice.h"
+#include "voxel.h"
+#include "boxoverlay.h"
+
+// Not defined by every platform's GL headers
+#ifndef GL_VERTEX_PROGRAM_POINT_SIZE
+#define GL_VERTEX_PROGRAM_POINT_SIZE 0x8642
+#endif
+#ifndef GL_POINT_SPRITE
+#define GL_POINT_SPRITE 0x8861
+#endif
 
 const float Canvas::P_PERSPECTIVE = 0.25f;
 const float Canvas::P_ORTHOGRAPHIC = 0.0f;
+const float Canvas::TARGET_FRAME_MS = 12.0f;
+const float Canvas::MIN_RENDER_SCALE = 0.25f;
+const int Canvas::IDLE_MS = 250;
+const int Canvas::ACCUMULATE_SAMPLES = 16;
 
 Canvas::Canvas(const QSurfaceFormat& format, QWidget *parent)
-    : QOpenGLWidget(parent), mesh(nullptr),
-      scale(1), zoom(1),
-      anim(this, "perspective"), status(" "),
+    : QOpenGLWidget(parent), gl45(nullptr), mesh_uniforms(0),
+      depth_pyramid(nullptr), pyramid_mode(shaded), mesh(nullptr),
+      lod(nullptr), pending_mesh(nullptr), pending_is_reload(false),
+      pending_lod(nullptr), pending_plate(nullptr),
+      backdrop(nullptr), axis(nullptr),
+      scale(1), zoom(1), autoSplats(false),
+      anim(this, "perspective"),
+      scaled_fbo(nullptr), render_scale(1), frame_scale(1), frame_ms(0),
+      interacting(false), showPerformance(false), accumulator(nullptr),
+      voxels(nullptr), slice(nullptr), showSlice(false),
+      box_overlay(nullptr), showOrientedBox(false),
+      curvatureRange{0, 0}, color_shader_failed(false),
+      status(" "),
       meshInfo("")
 {
     setFormat(format);
@@ -25,15 +62,34 @@ Canvas::Canvas(const QSurfaceFormat& format, QWidget *parent)
     resetTransform();
 
     anim.setDuration(100);
+
+    idle_timer.setSingleShot(true);
+    idle_timer.setInterval(IDLE_MS);
+    connect(&idle_timer, &QTimer::timeout, this, &Canvas::on_idle);
 }
 
 Canvas::~Canvas()
 {
     makeCurrent();
     delete mesh;
-    delete mesh_vertshader;
+    delete pending_mesh;
+    delete lod;
+    delete pending_lod;
+    clear_plate();
+    delete pending_plate;
     delete backdrop;
     delete axis;
+    delete scaled_fbo;
+    delete accumulator;
+    delete depth_pyramid;
+    delete slice;
+    delete voxels;
+    delete box_overlay;
+    if (gl45)
+    {
+        gl45->glDeleteBuffers(1, &mesh_uniforms);
+    }
+    vao.destroy();
     doneCurrent();
 }
 
@@ -67,26 +123,293 @@ void Canvas::invert_zoom(bool d)
     update();
 }
 
+void Canvas::auto_splats(bool d)
+{
+    autoSplats = d;
+    restart_accumulation();
+    update();
+}
+
+void Canvas::show_performance(bool d)
+{
+    showPerformance = d;
+    update();
+}
+
+void Canvas::show_slice(bool d)
+{
+    showSlice = d;
+    update();
+}
+
+void Canvas::show_oriented_box(bool d)
+{
+    showOrientedBox = d;
+    update();
+}
+
+void Canvas::move_slice(int steps)
+{
+    if (slice)
+    {
+        slice->move(steps);
+        update();
+    }
+}
+
 void Canvas::setResetTransformOnLoad(bool d) {
     resetTransformOnLoad = d;
 }
 
 void Canvas::resetTransform() {
-    currentTransform.setToIdentity();
-    // apply some rotations to define initial orientation
-    currentTransform.rotate(-90.0, QVector3D(1, 0, 0));
-    currentTransform.rotate(180.0 + 15.0, QVector3D(0, 0, 1));
-    currentTransform.rotate(15.0, QVector3D(1, -sin(M_PI/12), 0));
-    
+    // initial orientation, shared with previews and thumbnails
+    currentTransform = starting_turn();
     zoom = 1;
 }
 
 void Canvas::load_mesh(Mesh* m, bool is_reload)
 {
+    // A new grid follows the mesh, if one was asked for
+    clear_voxels();
+
+    // The loader starts before the window is shown, so a small file can
+    // be ready before initializeGL(); keep it until then.
+    if (!isValid())
+    {
+        delete pending_mesh;
+        pending_mesh = m;
+        pending_is_reload = is_reload;
+        return;
+    }
+    upload_mesh(m, is_reload);
+}
+
+void Canvas::upload_mesh(Mesh* m, bool is_reload)
+{
+    makeCurrent();
     delete mesh;
+    delete lod;
+    lod = nullptr;
+    clear_plate();
     mesh = new GLMesh(m);
-    QVector3D lower(m->xmin(), m->ymin(), m->zmin());
-    QVector3D upper(m->xmax(), m->ymax(), m->zmax());
+    if (depth_pyramid)
+    {
+        depth_pyramid->reset();
+    }
+    set_mesh_bounds(QVector3D(m->xmin(), m->ymin(), m->zmin()),
+                    QVector3D(m->xmax(), m->ymax(), m->zmax()),
+                    m->triCount(), is_reload);
+    if (m->hasFacetNormals())
+    {
+        meshInfo += QStringLiteral("\nFlipped normals: %1\nMissing normals: %2")
+                        .arg(m->flippedNormals()).arg(m->missingNormals());
+    }
+    if (m->checkedWinding())
+    {
+        const WindingReport& w = m->winding();
+        meshInfo += QStringLiteral("\nShells: %1 (%2 non-orientable)"
+                                   "\nFlipped triangles: %3"
+                                   "\nOpen edges: %4\nNon-manifold edges: %5")
+                        .arg(w.shells).arg(w.nonorientable).arg(w.flipped)
+                        .arg(w.open_edges).arg(w.nonmanifold_edges);
+    }
+    if (m->filledHoles())
+    {
+        const HoleReport& h = m->holes();
+        meshInfo += QStringLiteral("\nHoles filled: %1 of %2 (%3 triangles)")
+                        .arg(h.filled).arg(h.holes).arg(h.triangles);
+    }
+    box_overlay->set_box(m->hasOrientedBox() ? &m->orientedBox() : nullptr);
+    if (m->hasOrientedBox())
+    {
+        const OrientedBox& b = m->orientedBox();
+        meshInfo += QStringLiteral("\nOriented box: %1 x %2 x %3\nOriented box volume: %4")
+                        .arg(b.size.x()).arg(b.size.y()).arg(b.size.z())
+                        .arg(b.volume());
+    }
+    if (m->hasPrintOrientation())
+    {
+        // Stand the part on the plate, seen from the usual angle
+        const PrintOrientation& o = m->printOrientation();
+        resetTransform();
+        currentTransform.rotate(o.rotation());
+        meshInfo += QStringLiteral("\nPrint up: (%1, %2, %3)\nOverhang area: %4"
+                                   "\nSupport volume: %5\nBuild height: %6")
+                        .arg(o.up.x()).arg(o.up.y()).arg(o.up.z())
+                        .arg(o.overhang_area).arg(o.support_volume).arg(o.height);
+    }
+    if (m->hasCurvature())
+    {
+        const CurvatureField& c = m->curvature();
+        curvatureRange[0] = c.mean_range;
+        curvatureRange[1] = c.gaussian_range;
+        meshInfo += QStringLiteral("\nMean curvature (%1%): %2\nGaussian curvature (%1%): %3")
+                        .arg(CurvatureField::PERCENTILE * 100)
+                        .arg(c.mean_range).arg(c.gaussian_range);
+    }
+    StartupProfile::mark("Mesh uploaded");
+
+    delete m;
+}
+
+void Canvas::load_ingest(Ingest* ingest)
+{
+    // Frames that arrive before GL is ready are dropped; the producer
+    // keeps pushing, so the next one will be shown.
+    if (!isValid())
+    {
+        return;
+    }
+
+    Ingest::Frame frame;
+    if (!ingest->begin_read(frame))
+    {
+        return;
+    }
+
+    // Upload straight from the shared segment (indices from the copy that
+    // begin_read checked), with no parsing or welding
+    makeCurrent();
+    GLMesh* m = new GLMesh(frame.vertices, frame.vertex_count,
+                           frame.indices.data(), frame.index_count);
+
+    QVector3D lower(frame.vertices[0], frame.vertices[1], frame.vertices[2]);
+    QVector3D upper = lower;
+    for (uint32_t i=0; i < frame.vertex_count; ++i)
+    {
+        for (int j=0; j < 3; ++j)
+        {
+            const float f = frame.vertices[3*i + j];
+            lower[j] = fmin(lower[j], f);
+            upper[j] = fmax(upper[j], f);
+        }
+    }
+
+    // If the producer overwrote the slot while we were reading it, drop
+    // the (possibly torn) upload and keep showing the previous frame.
+    if (!ingest->end_read(frame))
+    {
+        delete m;
+        doneCurrent();
+        return;
+    }
+
+    // Only frame the camera on the first mesh, not on every update
+    const bool is_reload = mesh != nullptr;
+    delete mesh;
+    delete lod;
+    lod = nullptr;
+    clear_plate();
+    mesh = m;
+    if (depth_pyramid)
+    {
+        depth_pyramid->reset();
+    }
+    box_overlay->set_box(nullptr);
+    doneCurrent();
+
+    set_mesh_bounds(lower, upper, frame.index_count / 3, is_reload);
+}
+
+void Canvas::load_lod(LodMesh* m)
+{
+    clear_voxels();
+
+    // Nodes are uploaded as they are drawn, but framing the camera needs
+    // the axes, so wait for GL like load_mesh does.
+    if (!isValid())
+    {
+        delete pending_lod;
+        pending_lod = m;
+        return;
+    }
+
+    makeCurrent();
+    delete mesh;
+    mesh = nullptr;
+    delete lod;
+    lod = m;
+    clear_plate();
+    box_overlay->set_box(nullptr);
+    doneCurrent();
+
+    set_mesh_bounds(m->lower(), m->upper(), m->triCount(), false);
+}
+
+void Canvas::load_plate(Plate* p)
+{
+    clear_voxels();
+
+    // Like load_lod, framing the camera waits for GL
+    if (!isValid())
+    {
+        delete pending_plate;
+        pending_plate = p;
+        return;
+    }
+
+    makeCurrent();
+    delete mesh;
+    mesh = nullptr;
+    delete lod;
+    lod = nullptr;
+    clear_plate();
+    for (const Mesh* part : p->parts)
+    {
+        plate_parts.push_back(new GLMesh(part));
+    }
+    for (const auto& placement : p->placements)
+    {
+        plate.push_back({plate_parts[placement.first], placement.second});
+    }
+    if (depth_pyramid)
+    {
+        depth_pyramid->reset();
+    }
+    box_overlay->set_box(nullptr);
+    doneCurrent();
+
+    set_mesh_bounds(p->lower, p->upper, p->tri_count, false);
+    delete p;
+}
+
+void Canvas::clear_plate()
+{
+    for (GLMesh* part : plate_parts)
+    {
+        delete part;
+    }
+    plate_parts.clear();
+    plate.clear();
+}
+
+void Canvas::clear_voxels()
+{
+    if (slice)
+    {
+        slice->set_grid(nullptr);
+    }
+    delete voxels;
+    voxels = nullptr;
+}
+
+void Canvas::load_voxels(VoxelGrid* grid)
+{
+    delete voxels;
+    voxels = grid;
+    if (slice)
+    {
+        slice->set_grid(grid);
+    }
+    meshInfo += QStringLiteral("\nVoxels: %1 x %2 x %3\nVoxel volume: %4")
+                    .arg(grid->dimension(0)).arg(grid->dimension(1))
+                    .arg(grid->dimension(2)).arg(grid->volume());
+    update();
+}
+
+void Canvas::set_mesh_bounds(const QVector3D& lower, const QVector3D& upper,
+                             int tri_count, bool is_reload)
+{
     if (!is_reload)
     {
         center = (lower + upper) / 2;
@@ -98,12 +421,11 @@ void Canvas::load_mesh(Mesh* m, bool is_reload)
             resetTransform();
         }
     }
-    meshInfo = QStringLiteral("Triangles: %1\nX: [%2, %3]\nY: [%4, %5]\nZ: [%6, %7]").arg(m->triCount());
+    meshInfo = QStringLiteral("Triangles: %1\nX: [%2, %3]\nY: [%4, %5]\nZ: [%6, %7]").arg(tri_count);
     for(int dIdx = 0; dIdx < 3; dIdx++) meshInfo = meshInfo.arg(lower[dIdx]).arg(upper[dIdx]);
     axis->setScale(lower, upper);
+    restart_accumulation();
     update();
-
-    delete m;
 }
 
 void Canvas::set_status(const QString &s)
@@ -121,6 +443,7 @@ void Canvas::set_perspective(float p)
 void Canvas::set_drawMode(enum DrawMode mode)
 {
     drawMode = mode;
+    restart_accumulation();
     update();
 }
 
@@ -132,90 +455,503 @@ void Canvas::clear_status()
 
 void Canvas::initializeGL()
 {
+    StartupProfile::mark("GL context created");
     initializeOpenGLFunctions();
 
-    mesh_vertshader = new QOpenGLShader(QOpenGLShader::Vertex);
-    mesh_vertshader->compileSourceFile(":/gl/mesh.vert");
-    mesh_shader.addShader(mesh_vertshader);
-    mesh_shader.addShaderFromSourceFile(QOpenGLShader::Fragment, ":/gl/mesh.frag");
-    mesh_shader.link();
-    mesh_wireframe_shader.addShader(mesh_vertshader);
-    mesh_wireframe_shader.addShaderFromSourceFile(QOpenGLShader::Fragment, ":/gl/mesh_wireframe.frag");
-    mesh_wireframe_shader.link();
-    mesh_surfaceangle_shader.addShader(mesh_vertshader);
-    mesh_surfaceangle_shader.addShaderFromSourceFile(QOpenGLShader::Fragment, ":/gl/mesh_surfaceangle.frag");
-    mesh_surfaceangle_shader.link();
+    // Shaders are compiled lazily (see mesh_shader), so only the draw
+    // mode that is actually shown costs anything at startup.  They are
+    // added as cacheable, so Qt keeps the linked program binaries in the
+    // cache directory (keyed by GL driver) and later launches skip
+    // compilation entirely.
+    const char* mesh_vert[] = {"mesh.vert",
+                               "mesh.vert",
+                               "mesh.vert",
+                               "mesh_splat.vert",
+                               "mesh_curvature.vert",
+                               "mesh_curvature.vert"};
+    const char* mesh_frag[] = {"mesh.frag",
+                               "mesh_wireframe.frag",
+                               "mesh_surfaceangle.frag",
+                               "mesh_splat.frag",
+                               "mesh_curvature.frag",
+                               "mesh_curvature.frag"};
+    for (int i=0; i < DRAWMODECOUNT; ++i)
+    {
+        mesh_shaders[i].addCacheableShaderFromSourceFile(QOpenGLShader::Vertex, gl_shader_path(mesh_vert[i]));
+        mesh_shaders[i].addCacheableShaderFromSourceFile(QOpenGLShader::Fragment, gl_shader_path(mesh_frag[i]));
+    }
+    // Only the core-profile variant needs its own vertex shader, which
+    // passes the first triangle of each cluster
+    color_shader.addCacheableShaderFromSourceFile(QOpenGLShader::Vertex,
+            gl_shader_path(gl_core_current() ? "mesh_color.vert" : "mesh.vert"));
+    color_shader.addCacheableShaderFromSourceFile(QOpenGLShader::Fragment, gl_shader_path("mesh_color.frag"));
+
+    if (gl_core_current())
+    {
+        gl45 = context()->versionFunctions<QOpenGLFunctions_4_5_Core>();
+        gl45->initializeOpenGLFunctions();
+        gl45->glCreateBuffers(1, &mesh_uniforms);
+        gl45->glNamedBufferStorage(mesh_uniforms, sizeof(MeshUniforms),
+                                   nullptr, GL_DYNAMIC_STORAGE_BIT);
+        vao.create();
+        cull_shader.addCacheableShaderFromSourceFile(QOpenGLShader::Compute, ":/gl/cull_core.comp");
+        cull_shader.link();
+        depth_pyramid = new DepthPyramid();
+    }
 
     backdrop = new Backdrop();
     axis = new Axis();
+    slice = new VoxelSlice();
+    slice->set_grid(voxels);
+    box_overlay = new BoxOverlay();
+    if (Accumulator::supported())
+    {
+        accumulator = new Accumulator();
+    }
+    StartupProfile::mark("GL initialized");
+
+    if (pending_mesh)
+    {
+        upload_mesh(pending_mesh, pending_is_reload);
+        pending_mesh = nullptr;
+    }
+    if (pending_lod)
+    {
+        load_lod(pending_lod);
+        pending_lod = nullptr;
+    }
+    if (pending_plate)
+    {
+        load_plate(pending_plate);
+        pending_plate = nullptr;
+    }
 }
 
 
 void Canvas::paintGL()
 {
-    glClearColor(0.0, 0.0, 0.0, 0.0);
-    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-    glEnable(GL_DEPTH_TEST);
-    backdrop->draw();
-    if (mesh)  draw_mesh();
+    // While interacting, draw the scene into a smaller framebuffer and
+    // upscale it afterwards; the axes and text stay at full resolution.
+    const QSize native = size() * devicePixelRatioF();
+    frame_scale = interacting && QOpenGLFramebufferObject::hasOpenGLFramebufferBlit()
+                ? render_scale : 1;
+
+    // Otherwise, average jittered frames until ACCUMULATE_SAMPLES, then
+    // keep showing the average without drawing the scene at all.
+    const QMatrix4x4 camera = view_matrix() * transform_matrix();
+    if (interacting || camera != accumulated_camera)
+    {
+        restart_accumulation();
+        accumulated_camera = camera;
+    }
+    const bool accumulate = accumulator && !interacting;
+    const bool draw_scene = !accumulate ||
+                            accumulator->samples() < ACCUMULATE_SAMPLES;
+
+    if (frame_scale < 1)
+    {
+        const QSize scaled = bind_scaled_fbo(native * frame_scale)->size();
+        glViewport(0, 0, scaled.width(), scaled.height());
+    }
+    else if (accumulate && draw_scene)
+    {
+        accumulator->begin_sample(native);
+        jitter = accumulator->jitter() * 2;
+        jitter /= QVector2D(native.width(), native.height());
+    }
+    QElapsedTimer timer;
+    timer.start();
+
+    if (vao.isCreated()) vao.bind();
+    if (draw_scene)
+    {
+        glClearColor(0.0, 0.0, 0.0, 0.0);
+        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+        glEnable(GL_DEPTH_TEST);
+        backdrop->draw();
+        if (mesh || lod || !plate.empty())  draw_mesh();
+    }
+    jitter = QVector2D();
+
+    if (frame_scale < 1)
+    {
+        blit_scaled_fbo(native);
+    }
+    else if (accumulate)
+    {
+        if (draw_scene)
+        {
+            accumulator->end_sample(defaultFramebufferObject());
+            if (accumulator->samples() < ACCUMULATE_SAMPLES)
+            {
+                update();
+            }
+        }
+        else
+        {
+            accumulator->present(defaultFramebufferObject());
+        }
+        glViewport(0, 0, native.width(), native.height());
+    }
+    if (interacting)
+    {
+        // Wait for the GPU, so that the time covers the actual drawing.
+        // This only happens while interacting, when the scale is adapted.
+        glFinish();
+        adapt_render_scale(timer.nsecsElapsed() / 1e6);
+    }
+
+    if (showOrientedBox) box_overlay->draw(transform_matrix(), view_matrix());
+    if (showSlice) slice->draw(transform_matrix(), view_matrix());
     if (drawAxes) axis->draw(transform_matrix(), view_matrix(),
         orient_matrix(), aspect_matrix(), width() / float(height()));
+    if (vao.isCreated()) vao.release();
 
     QPainter painter(this);
     painter.setRenderHint(QPainter::Antialiasing);
     float textHeight = painter.fontInfo().pointSize();
-    if (drawAxes) painter.drawText(QRect(10, textHeight, width(), height()), meshInfo);
+    QString info = meshInfo;
+    if (lod)
+    {
+        info += QStringLiteral("\nLOD nodes: %1 of %2\nDrawn triangles: %3")
+                .arg(lod->drawnNodes()).arg(lod->nodeCount())
+                .arg(lod->drawnTriangles());
+        if (lod->corruptNodes())
+        {
+            info += QStringLiteral("\nCorrupt nodes skipped: %1").arg(lod->corruptNodes());
+        }
+    }
+    if (showSlice && voxels)
+    {
+        info += QStringLiteral("\nSlice: %1 of %2")
+                .arg(slice->layer() + 1).arg(voxels->dimension(2));
+    }
+    if (drawAxes) painter.drawText(QRect(10, textHeight, width(), height()), info);
+    if (showPerformance)
+    {
+        painter.drawText(QRect(0, textHeight, width() - 10, height()),
+                         Qt::AlignRight,
+                         QStringLiteral("Frame: %1 ms\nRender scale: %2%\nSamples: %3")
+                         .arg(frame_ms, 0, 'f', 1)
+                         .arg(int(frame_scale * 100))
+                         .arg(accumulator ? accumulator->samples() : 1));
+    }
     painter.drawText(10, height() - textHeight, status);
+
+    if (mesh || lod || !plate.empty()) StartupProfile::finish();
+}
+
+QOpenGLFramebufferObject* Canvas::bind_scaled_fbo(const QSize& size)
+{
+    if (!scaled_fbo || scaled_fbo->size() != size)
+    {
+        delete scaled_fbo;
+        scaled_fbo = new QOpenGLFramebufferObject(
+                size, QOpenGLFramebufferObject::CombinedDepthStencil);
+    }
+    scaled_fbo->bind();
+    return scaled_fbo;
+}
+
+void Canvas::blit_scaled_fbo(const QSize& native)
+{
+    // Colour is filtered when upscaling, but depth (which the axes are
+    // tested against) can only be copied with nearest sampling.
+    QOpenGLExtraFunctions* f = context()->extraFunctions();
+    const QSize scaled = scaled_fbo->size();
+    f->glBindFramebuffer(GL_READ_FRAMEBUFFER, scaled_fbo->handle());
+    f->glBindFramebuffer(GL_DRAW_FRAMEBUFFER, defaultFramebufferObject());
+    f->glBlitFramebuffer(0, 0, scaled.width(), scaled.height(),
+                         0, 0, native.width(), native.height(),
+                         GL_COLOR_BUFFER_BIT, GL_LINEAR);
+    f->glBlitFramebuffer(0, 0, scaled.width(), scaled.height(),
+                         0, 0, native.width(), native.height(),
+                         GL_DEPTH_BUFFER_BIT, GL_NEAREST);
+    f->glBindFramebuffer(GL_FRAMEBUFFER, defaultFramebufferObject());
+    glViewport(0, 0, native.width(), native.height());
+}
+
+void Canvas::adapt_render_scale(float ms)
+{
+    frame_ms = ms;
+
+    // Drawing time is roughly proportional to the pixel count, which goes
+    // with the square of the scale.  Steps are limited so that one slow
+    // frame doesn't drop the resolution all at once, and snapped to 5%
+    // so that the framebuffer isn't reallocated on every frame.
+    const float step = sqrt(TARGET_FRAME_MS / std::max(ms, 0.1f));
+    const float s = render_scale * std::min(std::max(step, 0.8f), 1.1f);
+    render_scale = std::min(std::max(std::round(s * 20) / 20, MIN_RENDER_SCALE), 1.0f);
+}
+
+void Canvas::restart_accumulation()
+{
+    if (accumulator)
+    {
+        accumulator->reset();
+    }
+}
+
+void Canvas::begin_interaction()
+{
+    interacting = true;
+    idle_timer.start();
+}
+
+void Canvas::on_idle()
+{
+    // Redraw once more at native resolution.  The scale is kept for the
+    // next interaction, which probably has the same load.
+    interacting = false;
+    update();
 }
 
 void Canvas::draw_mesh()
 {
-    QOpenGLShaderProgram* selected_mesh_shader = NULL;
-    if(drawMode == wireframe)
+    const enum DrawMode mode = mesh_draw_mode();
+
+    if(mode == wireframe)
     {
-        selected_mesh_shader = &mesh_wireframe_shader;
         glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
     }
     else
     {
-        if(drawMode == shaded)
+        glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
+    }
+
+    // Splats set their own size in the vertex shader.  Point sprites
+    // (for gl_PointCoord) must be enabled explicitly before OpenGL 3.2.
+    if (mode == splats)
+    {
+        glEnable(GL_VERTEX_PROGRAM_POINT_SIZE);
+        if (!gl45) glEnable(GL_POINT_SPRITE);
+    }
+
+    // A plate draws each part's buffers once for every placement of it,
+    // with the placement as part of the model matrix
+    if (plate.empty())
+    {
+        draw_instance(mesh, QMatrix4x4(), mode);
+    }
+    for (const auto& instance : plate)
+    {
+        draw_instance(instance.first, instance.second, mode);
+    }
+
+    // Reset draw mode for the background and anything else that needs to be drawn
+    glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
+    if (mode == splats)
+    {
+        glDisable(GL_VERTEX_PROGRAM_POINT_SIZE);
+        if (!gl45) glDisable(GL_POINT_SPRITE);
+    }
+
+    if (!lod && depth_pyramid)
+    {
+        depth_pyramid->capture(view_matrix() * transform_matrix());
+        pyramid_camera = accumulated_camera;
+        pyramid_mode = mode;
+    }
+}
+
+void Canvas::draw_instance(GLMesh* target, const QMatrix4x4& placement,
+                           enum DrawMode mode)
+{
+    const QMatrix4x4 model = transform_matrix() * placement;
+
+    // Skip clusters that are off screen (on the GPU for the core-profile
+    // path, otherwise on the CPU).  Wireframes show back faces, so only
+    // the other modes skip clusters that face away.  LOD meshes cull
+    // whole nodes instead.
+    //
+    // The core path also skips clusters that were behind last frame's
+    // depth.  Clusters coming into view then show up a frame late, which
+    // is only allowed while the view moves: still frames (which are
+    // averaged) only use depth drawn from the same camera.
+    if (target)
+    {
+        const bool occlusion = depth_pyramid && depth_pyramid->ready() &&
+                               pyramid_mode == mode &&
+                               (interacting || pyramid_camera == accumulated_camera);
+        target->cull(view_matrix() * model,
+                     cull_shader.isLinked() ? &cull_shader : nullptr,
+                     mode != wireframe, occlusion ? depth_pyramid : nullptr,
+                     placement);
+    }
+    QOpenGLShaderProgram* selected_mesh_shader = mesh_shader(mode);
+
+    // Files with face colours show them in the shaded mode, if the driver
+    // can look faces up by gl_PrimitiveID
+    QOpenGLShaderProgram* colored = (mode == shaded && target && target->has_colors())
+                                  ? color_mesh_shader() : nullptr;
+    if (colored)
+    {
+        selected_mesh_shader = colored;
+        target->bind_colors();
+    }
+
+    selected_mesh_shader->bind();
+
+    // Curvature modes pick a component and scale it into the colour map
+    const bool curvature = mode == meancurvature || mode == gaussiancurvature;
+    if (curvature)
+    {
+        const int component = mode == meancurvature ? 0 : 1;
+        selected_mesh_shader->setUniformValue("curvature_component", component);
+        selected_mesh_shader->setUniformValue("curvature_range",
+                std::max(curvatureRange[component], 1e-12f));
+    }
+
+    if (gl45)
+    {
+        draw_mesh_core(target, model, mode);
+    }
+    else
+    {
+        // Load the transform and view matrices into the shader
+        glUniformMatrix4fv(
+                    selected_mesh_shader->uniformLocation("transform_matrix"),
+                    1, GL_FALSE, model.constData());
+        glUniformMatrix4fv(
+                    selected_mesh_shader->uniformLocation("view_matrix"),
+                    1, GL_FALSE, view_matrix().data());
+
+        // Compensate for z-flattening when zooming
+        glUniform1f(selected_mesh_shader->uniformLocation("zoom"), 1/zoom);
+
+        // Splats overlap a little, so that the surface has no gaps
+        if (mode == splats)
         {
-            selected_mesh_shader = &mesh_shader;
+            glUniform1f(selected_mesh_shader->uniformLocation("point_size"),
+                        1.5f * target->point_spacing() * pixel_scale());
         }
-        else
+
+        // Face colours are looked up from texture unit 0
+        if (colored)
         {
-            selected_mesh_shader = &mesh_surfaceangle_shader;
+            glUniform1i(selected_mesh_shader->uniformLocation("face_colors"), 0);
         }
-        glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
+
+        // Find and enable the attribute location for vertex position
+        const GLuint vp = selected_mesh_shader->attributeLocation("vertex_position");
+        glEnableVertexAttribArray(vp);
+
+        // Then draw the mesh with that vertex position
+        draw_geometry(target, vp, mode, colored
+                ? selected_mesh_shader->uniformLocation("primitive_offset") : -1,
+                curvature ? selected_mesh_shader->attributeLocation("vertex_curvature") : -1);
+
+        // Clean up state machine
+        glDisableVertexAttribArray(vp);
     }
 
-    selected_mesh_shader->bind();
+    if (colored)
+    {
+        glBindTexture(GL_TEXTURE_2D, 0);
+    }
 
-    // Load the transform and view matrices into the shader
-    glUniformMatrix4fv(
-                selected_mesh_shader->uniformLocation("transform_matrix"),
-                1, GL_FALSE, transform_matrix().data());
-    glUniformMatrix4fv(
-                selected_mesh_shader->uniformLocation("view_matrix"),
-                1, GL_FALSE, view_matrix().data());
+    selected_mesh_shader->release();
+}
 
+void Canvas::draw_mesh_core(GLMesh* target, const QMatrix4x4& model,
+                            enum DrawMode mode)
+{
+    // Matches the std140 layout of MeshUniforms in mesh_core.vert (and
+    // mesh_splat_core.vert, which also reads point_size)
+    MeshUniforms uniforms;
+    memcpy(uniforms.transform_matrix, model.constData(),
+           sizeof(uniforms.transform_matrix));
+    memcpy(uniforms.view_matrix, view_matrix().constData(),
+           sizeof(uniforms.view_matrix));
     // Compensate for z-flattening when zooming
-    glUniform1f(selected_mesh_shader->uniformLocation("zoom"), 1/zoom);
+    uniforms.zoom = 1/zoom;
+    uniforms.point_size = mode == splats ? 1.5f * target->point_spacing() * pixel_scale() : 1;
 
-    // Find and enable the attribute location for vertex position
-    const GLuint vp = selected_mesh_shader->attributeLocation("vertex_position");
-    glEnableVertexAttribArray(vp);
+    gl45->glNamedBufferSubData(mesh_uniforms, 0, sizeof(uniforms), &uniforms);
+    gl45->glBindBufferBase(GL_UNIFORM_BUFFER, 0, mesh_uniforms);
 
-    // Then draw the mesh with that vertex position
-    mesh->draw(vp);
+    draw_geometry(target, 0, mode);
+}
 
-    // Reset draw mode for the background and anything else that needs to be drawn
-    glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
+void Canvas::draw_geometry(GLMesh* target, GLuint vp, enum DrawMode mode,
+                           GLint offset_location, GLint curvature_location)
+{
+    if (target)
+    {
+        if (mode == splats)
+        {
+            target->draw_points(vp);
+        }
+        else
+        {
+            target->draw(vp, offset_location, curvature_location);
+        }
+        return;
+    }
 
-    // Clean up state machine
-    glDisableVertexAttribArray(vp);
-    selected_mesh_shader->release();
+    if (lod->draw(vp, view_matrix() * transform_matrix(), pixel_scale()))
+    {
+        // Keep drawing while nodes stream in, and don't average frames
+        // that are about to change
+        restart_accumulation();
+        update();
+    }
 }
+
+enum DrawMode Canvas::mesh_draw_mode() const
+{
+    // Curvature is only known for meshes that were loaded with it
+    if ((drawMode == meancurvature || drawMode == gaussiancurvature) &&
+        !(mesh && mesh->has_curvature()))
+    {
+        return shaded;
+    }
+
+    // LOD meshes already thin out distant geometry, so they always draw
+    // triangles
+    if (lod)
+    {
+        return drawMode == splats ? shaded : drawMode;
+    }
+
+    // Once vertices are packed more densely than pixels, triangles are
+    // mostly sub-pixel and splats look the same for less work.  Plates
+    // mix parts of any density, so they keep the chosen mode.
+    if (autoSplats && drawMode == shaded && mesh &&
+        mesh->point_spacing() > 0 && mesh->point_spacing() * pixel_scale() < 1)
+    {
+        return splats;
+    }
+    return drawMode;
+}
+
+float Canvas::pixel_scale() const
+{
+    // One model unit at w = 1 covers this many pixels (see aspect_matrix)
+    return scale * zoom * std::min(width(), height()) / 2 * frame_scale;
+}
+
+QOpenGLShaderProgram* Canvas::color_mesh_shader()
+{
+    // The OpenGL 2.1 variant needs EXT_gpu_shader4, so this may fail; if
+    // it does, don't try again on every frame.
+    if (!color_shader.isLinked() && !color_shader_failed)
+    {
+        color_shader_failed = !color_shader.link();
+    }
+    return color_shader.isLinked() ? &color_shader : nullptr;
+}
+
+QOpenGLShaderProgram* Canvas::mesh_shader(enum DrawMode mode)
+{
+    QOpenGLShaderProgram* program = &mesh_shaders[mode];
+    if (!program->isLinked())
+    {
+        program->link();
+    }
+    return program;
+}
+
 QMatrix4x4 Canvas::orient_matrix() const
 {
     QMatrix4x4 m = currentTransform;
@@ -246,6 +982,10 @@ QMatrix4x4 Canvas::view_matrix() const
     QMatrix4x4 m = aspect_matrix();
     m.scale(zoom, zoom, 1);
     m(3, 2) = perspective;
+    // Shift by a sub-pixel amount in clip space (only while drawing a
+    // supersampling frame); x' = x + jitter * w
+    m.setRow(0, m.row(0) + jitter.x() * m.row(3));
+    m.setRow(1, m.row(1) + jitter.y() * m.row(3));
     return m;
 }
 
@@ -334,6 +1074,7 @@ void Canvas::mouseMoveEvent(QMouseEvent* event)
         QPointF p2r = changeMouseCoordinates(p);
         calcArcballTransform(p1r,p2r);
 
+        begin_interaction();
         update();
     }
     else if (event->buttons() & Qt::RightButton)
@@ -342,6 +1083,7 @@ void Canvas::mouseMoveEvent(QMouseEvent* event)
                  view_matrix().inverted() *
                  QVector3D(-d.x() / (0.5*width()),
                             d.y() / (0.5*height()), 0);
+        begin_interaction();
         update();
     }
     mouse_pos = p;
@@ -378,6 +1120,7 @@ void Canvas::wheelEvent(QWheelEvent *event)
     QVector3D b = transform_matrix().inverted() *
                   view_matrix().inverted() * v;
     center += b - a;
+    begin_interaction();
     update();
 }
 
@@ -4,13 +4,28 @@
 #include <QtOpenGL>
 #include <QSurfaceFormat>
 #include <QOpenGLShaderProgram>
+#include <QOpenGLVertexArrayObject>
+#include <QTimer>
+
+#include <vector>
 
 class GLMesh;
 class Mesh;
 class Backdrop;
 class Axis;
-
-enum DrawMode {shaded, wireframe, surfaceangle, DRAWMODECOUNT};
+class BoxOverlay;
+class Accumulator;
+class DepthPyramid;
+class Ingest;
+class LodMesh;
+struct Plate;
+class VoxelGrid;
+class VoxelSlice;
+class QOpenGLFunctions_4_5_Core;
+class QOpenGLFramebufferObject;
+
+enum DrawMode {shaded, wireframe, surfaceangle, splats,
+               meancurvature, gaussiancurvature, DRAWMODECOUNT};
 
 class Canvas : public QOpenGLWidget, protected QOpenGLFunctions
 {
@@ -23,9 +38,24 @@ public:
     const static float P_PERSPECTIVE;
     const static float P_ORTHOGRAPHIC;
 
+    // Dynamic resolution: while the view is moving, the scene is drawn at
+    // a reduced scale (no lower than MIN_RENDER_SCALE) so that it takes
+    // about TARGET_FRAME_MS, then upscaled to the widget.
+    const static float TARGET_FRAME_MS;
+    const static float MIN_RENDER_SCALE;
+    const static int IDLE_MS;
+
+    // Number of jittered frames averaged while the view is idle
+    const static int ACCUMULATE_SAMPLES;
+
     void view_perspective(float p, bool animate);
     void draw_axes(bool d);
     void invert_zoom(bool d);
+    void auto_splats(bool d);
+    void show_performance(bool d);
+    void show_slice(bool d);
+    void show_oriented_box(bool d);
+    void move_slice(int steps);
     void set_drawMode(enum DrawMode mode);
     void setResetTransformOnLoad(bool d);
 
@@ -33,6 +63,10 @@ public slots:
     void set_status(const QString& s);
     void clear_status();
     void load_mesh(Mesh* m, bool is_reload);
+    void load_ingest(Ingest* ingest);
+    void load_lod(LodMesh* m);
+    void load_plate(Plate* p);
+    void load_voxels(VoxelGrid* grid);
 
 protected:
     void paintGL() override;
@@ -47,8 +81,30 @@ protected:
     void set_perspective(float p);
     void view_anim(float v);
 
+protected slots:
+    void on_idle();
+
 private:
     void draw_mesh();
+    void draw_instance(GLMesh* target, const QMatrix4x4& placement,
+                       enum DrawMode mode);
+    void draw_mesh_core(GLMesh* target, const QMatrix4x4& model,
+                        enum DrawMode mode);
+    void draw_geometry(GLMesh* target, GLuint vp, enum DrawMode mode,
+                       GLint offset_location=-1, GLint curvature_location=-1);
+    enum DrawMode mesh_draw_mode() const;
+    float pixel_scale() const;
+
+    void begin_interaction();
+    QOpenGLFramebufferObject* bind_scaled_fbo(const QSize& size);
+    void blit_scaled_fbo(const QSize& native);
+    void adapt_render_scale(float frame_ms);
+    void restart_accumulation();
+    void upload_mesh(Mesh* m, bool is_reload);
+    void clear_voxels();
+    void clear_plate();
+    void set_mesh_bounds(const QVector3D& lower, const QVector3D& upper,
+                         int tri_count, bool is_reload);
 
     QMatrix4x4 orient_matrix() const;
     QMatrix4x4 transform_matrix() const;
@@ -58,12 +114,53 @@ private:
     QPointF changeMouseCoordinates(QPoint p);
     void calcArcballTransform(QPointF p1, QPointF p2);
 
-    QOpenGLShader* mesh_vertshader;
-    QOpenGLShaderProgram mesh_shader;
-    QOpenGLShaderProgram mesh_wireframe_shader;
-    QOpenGLShaderProgram mesh_surfaceangle_shader;
+    QOpenGLShaderProgram* mesh_shader(enum DrawMode mode);
+    QOpenGLShaderProgram* color_mesh_shader();
+
+    // One program per draw mode, linked the first time it is used
+    QOpenGLShaderProgram mesh_shaders[DRAWMODECOUNT];
+
+    // Shaded program for meshes with face colours (see GLMesh)
+    QOpenGLShaderProgram color_shader;
+
+    // State for the OpenGL 4.5 core-profile path (null gl45 otherwise).
+    // Mesh uniforms live in a uniform buffer, and the backdrop and axes
+    // draw with a shared vertex array, since core profiles have no
+    // default one.
+    struct MeshUniforms
+    {
+        GLfloat transform_matrix[16];
+        GLfloat view_matrix[16];
+        GLfloat zoom;
+        GLfloat point_size;
+        GLfloat padding[2];
+    };
+    QOpenGLFunctions_4_5_Core* gl45;
+    GLuint mesh_uniforms;
+    QOpenGLVertexArrayObject vao;
+    QOpenGLShaderProgram cull_shader;
+
+    // Depth of the last frame, for occlusion culling on the core path,
+    // with the (unjittered) camera and draw mode that it was drawn with
+    DepthPyramid* depth_pyramid;
+    QMatrix4x4 pyramid_camera;
+    enum DrawMode pyramid_mode;
 
     GLMesh* mesh;
+
+    // Out-of-core mesh, drawn instead of mesh when a LOD file is open
+    LodMesh* lod;
+
+    // Parts of a packed plate, drawn instead of mesh: each part is
+    // uploaded once, and drawn at every placement of it
+    std::vector<GLMesh*> plate_parts;
+    std::vector<std::pair<GLMesh*, QMatrix4x4>> plate;
+
+    // Mesh that finished loading before GL was initialized
+    Mesh* pending_mesh;
+    bool pending_is_reload;
+    LodMesh* pending_lod;
+    Plate* pending_plate;
     Backdrop* backdrop;
     Axis* axis;
 
@@ -76,10 +173,42 @@ private:
     enum DrawMode drawMode;
     bool drawAxes;
     bool invertZoom;
+    bool autoSplats;
     bool resetTransformOnLoad;
     Q_PROPERTY(float perspective MEMBER perspective WRITE set_perspective);
     QPropertyAnimation anim;
 
+    QOpenGLFramebufferObject* scaled_fbo;
+    float render_scale;     // Scale to use while interacting
+    float frame_scale;      // Scale of the frame being drawn
+    float frame_ms;         // Time taken by the last interactive frame
+    bool interacting;
+    QTimer idle_timer;
+    bool showPerformance;
+
+    // Progressive supersampling, restarted whenever the camera (or what
+    // it looks at) changes.  jitter offsets view_matrix() in clip space.
+    Accumulator* accumulator;
+    QMatrix4x4 accumulated_camera;
+    QVector2D jitter;
+
+    // Voxel grid of the current mesh (if one was built), and the overlay
+    // that shows a layer of it
+    VoxelGrid* voxels;
+    VoxelSlice* slice;
+    bool showSlice;
+
+    // Minimum oriented box of the current mesh (if it was measured)
+    BoxOverlay* box_overlay;
+    bool showOrientedBox;
+
+    // Curvatures of the current mesh that get the full colour in the
+    // curvature draw modes (mean, then Gaussian)
+    float curvatureRange[2];
+
+    // Set if color_shader can't be linked on this driver
+    bool color_shader_failed;
+
     QPoint mouse_pos;
     QString status;
     QString meshInfo;
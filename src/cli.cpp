@@ -0,0 +1,333 @@
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QElapsedTimer>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+
+#include <cstdio>
+#include <new>
+
+#include "cli.h"
+#include "duplicates.h"
+#include "loader.h"
+#include "lod.h"
+#include "quality.h"
+#include "voxel.h"
+
+void cli_add_options(QCommandLineParser& parser)
+{
+    parser.setApplicationDescription("A fast viewer for .stl files.");
+    parser.addHelpOption();
+    parser.addVersionOption();
+    parser.addPositionalArgument("file",
+            "File to open, or - to read from standard input.", "[file]");
+
+    parser.addOption(QCommandLineOption("ingest",
+            "Show meshes pushed through shared memory segment /<name> "
+            "and local socket <name>.", "name"));
+    parser.addOption(QCommandLineOption("startup-profile",
+            "Print how long each phase of startup takes."));
+    parser.addOption(QCommandLineOption("gl-core",
+            "Use the OpenGL 4.5 core-profile renderer if available."));
+
+    // Batch jobs, which run without a window
+    parser.addOption(QCommandLineOption("build-lod",
+            "Build a level-of-detail file from the binary .stl <file>, "
+            "then exit.  Open the result to view meshes that are too "
+            "large to load at once.", "output"));
+    parser.addOption(QCommandLineOption("voxelize",
+            "Write a voxel grid of <file> (see voxel.h for the format), "
+            "print its volume, then exit.", "output"));
+    parser.addOption(QCommandLineOption("voxel-resolution",
+            "Voxels along the longest side of the grid (default 256).",
+            "n", "256"));
+    parser.addOption(QCommandLineOption("sdf-band",
+            "Also compute signed distances out to <n> voxels from the "
+            "surface, and write those instead of inside/outside flags.",
+            "n", "0"));
+    parser.addOption(QCommandLineOption("voxel-winding",
+            "Decide inside voxels by winding number rather than the "
+            "even-odd rule, for meshes with overlapping shells."));
+    parser.addOption(QCommandLineOption("orient",
+            "Find the best print orientation of each <file> (any number "
+            "of them), print it, then exit."));
+    parser.addOption(QCommandLineOption("orient-candidates",
+            "Build directions to try, spread over the sphere (default 512).",
+            "n", "512"));
+    parser.addOption(QCommandLineOption("find-duplicates",
+            "Print groups of .stl files in <folder> (and its subfolders) "
+            "that hold the same part in any pose, then exit.", "folder"));
+    parser.addOption(QCommandLineOption("duplicate-tolerance",
+            "Largest relative difference between the shapes of duplicate "
+            "parts (default 0.01).", "x", "0.01"));
+    parser.addOption(QCommandLineOption("quality",
+            "Print edge length, aspect ratio and dihedral angle statistics "
+            "of each <file> (any number of them) as JSON, then exit."));
+}
+
+static int run_build_lod(const QCommandLineParser& parser, const QString& input)
+{
+    QElapsedTimer timer;
+    timer.start();
+    QString error;
+    if (!build_lod(input, parser.value("build-lod"), &error))
+    {
+        fprintf(stderr, "%s\n", qPrintable(error));
+        return 1;
+    }
+    printf("Built %s in %.1f s\n", qPrintable(parser.value("build-lod")),
+           timer.elapsed() / 1000.0);
+    return 0;
+}
+
+static int run_voxelize(const QCommandLineParser& parser, const QString& input)
+{
+    bool resolution_ok, band_ok;
+    const int resolution = parser.value("voxel-resolution").toInt(&resolution_ok);
+    const int band = parser.value("sdf-band").toInt(&band_ok);
+    if (!resolution_ok || resolution < 1 || resolution > VoxelGrid::MAX_RESOLUTION ||
+        !band_ok || band < 0 || band > VoxelGrid::MAX_BAND)
+    {
+        fprintf(stderr, "--voxel-resolution must be from 1 to %i, and "
+                        "--sdf-band from 0 to %i\n", VoxelGrid::MAX_RESOLUTION,
+                        VoxelGrid::MAX_BAND);
+        return 1;
+    }
+
+    QElapsedTimer timer;
+    timer.start();
+    QString error;
+    Mesh* mesh = Loader::load_now(input, &error);
+    if (!mesh)
+    {
+        fprintf(stderr, "%s\n", qPrintable(error));
+        return 1;
+    }
+    const qint64 load_ms = timer.restart();
+
+    const VoxelGrid grid(mesh, resolution, band, parser.isSet("voxel-winding"));
+    delete mesh;
+    const qint64 voxelize_ms = timer.elapsed();
+    if (!grid.save(parser.value("voxelize"), &error))
+    {
+        fprintf(stderr, "%s\n", qPrintable(error));
+        return 1;
+    }
+
+    printf("Grid: %i x %i x %i voxels of %g\n", grid.dimension(0),
+           grid.dimension(1), grid.dimension(2), grid.size());
+    printf("Inside: %zu voxels, volume %g\n", grid.insideCount(), grid.volume());
+    printf("Loaded in %.1f s, voxelized in %.1f s\n",
+           load_ms / 1000.0, voxelize_ms / 1000.0);
+    return 0;
+}
+
+static int run_orient(const QCommandLineParser& parser, const QStringList& inputs)
+{
+    bool ok;
+    const int candidates = parser.value("orient-candidates").toInt(&ok);
+    if (!ok || candidates < 1)
+    {
+        fprintf(stderr, "--orient-candidates must be at least 1\n");
+        return 1;
+    }
+
+    // Files are searched one at a time, since each search is parallel
+    int failures = 0;
+    for (const auto& input : inputs)
+    {
+        QElapsedTimer timer;
+        timer.start();
+        QString error;
+        Mesh* mesh = Loader::load_now(input, &error);
+        if (!mesh)
+        {
+            fprintf(stderr, "%s\n", qPrintable(error));
+            failures++;
+            continue;
+        }
+        mesh->orient_for_printing(candidates);
+        const PrintOrientation o = mesh->printOrientation();
+        delete mesh;
+
+        float angle;
+        QVector3D axis;
+        o.rotation().getAxisAndAngle(&axis, &angle);
+        printf("%s: up (%g, %g, %g), rotate %g degrees about (%g, %g, %g); "
+               "overhang %g, support %g, height %g (%.1f s)\n",
+               qPrintable(input), o.up.x(), o.up.y(), o.up.z(),
+               angle, axis.x(), axis.y(), axis.z(),
+               o.overhang_area, o.support_volume, o.height,
+               timer.elapsed() / 1000.0);
+    }
+    return failures ? 1 : 0;
+}
+
+static int run_find_duplicates(const QCommandLineParser& parser)
+{
+    bool ok;
+    const float tolerance = parser.value("duplicate-tolerance").toFloat(&ok);
+    if (!ok || tolerance < 0)
+    {
+        fprintf(stderr, "--duplicate-tolerance must be at least 0\n");
+        return 1;
+    }
+
+    QElapsedTimer timer;
+    timer.start();
+    const QStringList files = stl_files(parser.value("find-duplicates"));
+    QStringList unreadable;
+    const QList<QStringList> groups = find_duplicates(files, tolerance, &unreadable);
+    for (const auto& error : unreadable)
+    {
+        fprintf(stderr, "%s\n", qPrintable(error));
+    }
+
+    // One file per line, with a blank line between groups
+    for (const auto& group : groups)
+    {
+        for (const auto& file : group)
+        {
+            printf("%s\n", qPrintable(file));
+        }
+        printf("\n");
+    }
+    printf("%i groups of duplicates among %i files (%.1f s)\n",
+           groups.size(), files.size(), timer.elapsed() / 1000.0);
+    return 0;
+}
+
+static QJsonObject histogram_json(const Histogram& h)
+{
+    QJsonObject out;
+    out["min"] = h.min;
+    out["max"] = h.max;
+    out["mean"] = h.total ? h.sum / h.total : 0.0;
+    for (const int p : {1, 5, 50, 95, 99})
+    {
+        out[QString("p%1").arg(p)] = h.percentile(p / 100.0f);
+    }
+
+    // Coarser bins than the ones measured, which are too many to read
+    const Histogram coarse = h.coarsened(32);
+    QJsonArray counts;
+    for (const auto& c : coarse.counts)
+    {
+        counts.append(double(c));
+    }
+    QJsonObject bins;
+    bins["lower"] = coarse.lower;
+    bins["upper"] = coarse.upper;
+    bins["logarithmic"] = coarse.logarithmic;
+    bins["counts"] = counts;
+    out["histogram"] = bins;
+    return out;
+}
+
+static int run_quality(const QStringList& inputs)
+{
+    int failures = 0;
+    QJsonArray reports;
+    for (const auto& input : inputs)
+    {
+        QString error;
+        Mesh* mesh = Loader::load_now(input, &error);
+        if (!mesh)
+        {
+            fprintf(stderr, "%s\n", qPrintable(error));
+            failures++;
+            continue;
+        }
+        const QualityReport q = mesh->quality();
+        QJsonObject report;
+        report["file"] = input;
+        report["triangles"] = mesh->triCount();
+        report["degenerate"] = double(q.degenerate);
+        report["edge_length"] = histogram_json(q.edge_length);
+        report["aspect_ratio"] = histogram_json(q.aspect_ratio);
+        report["dihedral"] = histogram_json(q.dihedral);
+        reports.append(report);
+        delete mesh;
+    }
+    printf("%s", QJsonDocument(reports).toJson().constData());
+    return failures ? 1 : 0;
+}
+
+int cli_run_batch(int argc, char* argv[])
+{
+    QStringList arguments;
+    for (int i=0; i < argc; ++i)
+    {
+        arguments << QString::fromLocal8Bit(argv[i]);
+    }
+
+    // Parse before creating an application object, so that the viewer
+    // path pays nothing for batch support
+    QCommandLineParser parser;
+    cli_add_options(parser);
+    parser.parse(arguments);
+
+    // Each run does one job, so asking for two is an error rather than
+    // silently picking one of them
+    const char* const jobs[] = {"build-lod", "voxelize", "orient", "quality",
+                                "find-duplicates"};
+    QStringList requested;
+    for (const char* j : jobs)
+    {
+        if (parser.isSet(j))
+        {
+            requested << QString("--") + j;
+        }
+    }
+    if (requested.isEmpty())
+    {
+        return -1;
+    }
+    if (requested.size() > 1)
+    {
+        fprintf(stderr, "Only one job can be run at a time (got %s)\n",
+                requested.join(", ").toLocal8Bit().constData());
+        return 1;
+    }
+    const QByteArray job_name = requested.first().toLocal8Bit();
+    const char* job = job_name.constData();
+
+    QCoreApplication app(argc, argv);
+    if (parser.isSet("find-duplicates"))
+    {
+        return run_find_duplicates(parser);
+    }
+
+    const auto files = parser.positionalArguments();
+    // These take any number of files
+    if (parser.isSet("orient") || parser.isSet("quality"))
+    {
+        if (files.isEmpty())
+        {
+            fprintf(stderr, "%s needs at least one input file\n", job);
+            return 1;
+        }
+        return parser.isSet("orient") ? run_orient(parser, files)
+                                      : run_quality(files);
+    }
+    if (files.size() != 1)
+    {
+        fprintf(stderr, "%s needs exactly one input file\n", job);
+        return 1;
+    }
+
+    // Workers' exceptions come back through parallel_for, so running out
+    // of memory on a large mesh is reported instead of leaving partial
+    // output behind
+    try
+    {
+        return parser.isSet("build-lod") ? run_build_lod(parser, files.first())
+                                         : run_voxelize(parser, files.first());
+    }
+    catch (const std::bad_alloc&)
+    {
+        fprintf(stderr, "Out of memory running %s\n", job);
+        return 1;
+    }
+}
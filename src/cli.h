@@ -0,0 +1,16 @@
+#ifndef CLI_H
+#define CLI_H
+
+class QCommandLineParser;
+
+/*  Adds every command-line option (for both the viewer and batch jobs)
+ *  to the parser, so that they share one --help. */
+void cli_add_options(QCommandLineParser& parser);
+
+/*  If the arguments ask for a batch job (--build-lod, --voxelize, --orient,
+ *  --quality or --find-duplicates), runs it without opening a window and
+ *  returns the exit code; asking for more than one is an error.  Otherwise
+ *  returns -1, and the viewer should start as usual. */
+int cli_run_batch(int argc, char* argv[]);
+
+#endif // CLI_H
@@ -0,0 +1,150 @@
+#include <algorithm>
+#include <cmath>
+
+#include "curvature.h"
+#include "parallel.h"
+#include "topology.h"
+
+const float CurvatureField::PERCENTILE = 0.95f;
+
+namespace {
+
+struct Vec
+{
+    double x, y, z;
+    Vec operator-(const Vec& o) const { return {x - o.x, y - o.y, z - o.z}; }
+    Vec operator+(const Vec& o) const { return {x + o.x, y + o.y, z + o.z}; }
+    Vec operator*(double s) const { return {x * s, y * s, z * s}; }
+    double dot(const Vec& o) const { return x * o.x + y * o.y + z * o.z; }
+    Vec cross(const Vec& o) const
+    {
+        return {y * o.z - z * o.y, z * o.x - x * o.z, x * o.y - y * o.x};
+    }
+    double length() const { return sqrt(dot(*this)); }
+};
+
+/*  Value below which fraction p of the magnitudes fall */
+float percentile(std::vector<float>& magnitudes, float p)
+{
+    if (magnitudes.empty())
+    {
+        return 0;
+    }
+    auto nth = magnitudes.begin() + size_t(p * (magnitudes.size() - 1));
+    std::nth_element(magnitudes.begin(), nth, magnitudes.end());
+    return *nth;
+}
+
+}   // anonymous namespace
+
+CurvatureField estimate_curvature(const std::vector<GLfloat>& vertices,
+                                  const std::vector<GLuint>& indices)
+{
+    const size_t vertex_count = vertices.size() / 3;
+    const VertexTriangles around = vertex_triangles(vertex_count, indices);
+
+    CurvatureField field;
+    field.values.assign(vertex_count * 2, 0);
+    std::vector<unsigned char> interior(vertex_count, 0);
+
+    auto position = [&](GLuint v)
+    {
+        return Vec{vertices[v*3], vertices[v*3 + 1], vertices[v*3 + 2]};
+    };
+
+    parallel_for(vertex_count, [&](size_t begin, size_t end, size_t)
+    {
+        // Neighbours seen around the current vertex, to find open fans
+        std::vector<GLuint> ring;
+        for (size_t v=begin; v < end; ++v)
+        {
+            const Vec p = position(v);
+            Vec laplacian = {0, 0, 0}, normal = {0, 0, 0};
+            double area = 0, angles = 0;
+            ring.clear();
+
+            for (GLuint i=around.offsets[v]; i < around.offsets[v + 1]; ++i)
+            {
+                const GLuint* tri = &indices[size_t(around.incident[i]) * 3];
+                const int k = tri[0] == v ? 0 : tri[1] == v ? 1 : 2;
+                const GLuint a = tri[(k + 1) % 3], b = tri[(k + 2) % 3];
+                if (a == v || b == v || a == b)
+                {
+                    continue;
+                }
+                ring.push_back(a);
+                ring.push_back(b);
+
+                const Vec q = position(a), r = position(b);
+                const Vec pq = q - p, pr = r - p;
+                const Vec n = pq.cross(pr);
+                const double twice_area = n.length();
+                if (twice_area <= 0)
+                {
+                    continue;
+                }
+                normal = normal + n;
+
+                // Cotangents of the angles at q and r, each weighting the
+                // edge from p opposite it
+                const double dot_p = pq.dot(pr);
+                const double dot_q = (p - q).dot(r - q);
+                const double dot_r = (p - r).dot(q - r);
+                const double cot_q = dot_q / twice_area;
+                const double cot_r = dot_r / twice_area;
+                laplacian = laplacian + pq * cot_r + pr * cot_q;
+                angles += atan2(twice_area, dot_p);
+
+                // Voronoi area for acute triangles, otherwise a fixed share
+                if (dot_p < 0)
+                {
+                    area += twice_area / 4;
+                }
+                else if (dot_q < 0 || dot_r < 0)
+                {
+                    area += twice_area / 8;
+                }
+                else
+                {
+                    area += (pr.dot(pr) * cot_q + pq.dot(pq) * cot_r) / 8;
+                }
+            }
+
+            // In a closed fan, every neighbour is shared by two triangles
+            std::sort(ring.begin(), ring.end());
+            bool closed = !ring.empty() && area > 0;
+            for (size_t j=0; closed && j < ring.size(); j += 2)
+            {
+                closed = ring[j] == ring[j + 1] &&
+                         (j + 2 == ring.size() || ring[j + 2] != ring[j]);
+            }
+            if (!closed)
+            {
+                continue;
+            }
+
+            // The Laplacian is -2 H times the unit normal
+            const double length = normal.length();
+            const double mean = length > 0
+                ? -laplacian.dot(normal) / (4 * area * length) : 0;
+            field.values[v*2] = mean;
+            field.values[v*2 + 1] = (2 * M_PI - angles) / area;
+            interior[v] = 1;
+        }
+    });
+
+    std::vector<float> mean, gaussian;
+    mean.reserve(vertex_count);
+    gaussian.reserve(vertex_count);
+    for (size_t v=0; v < vertex_count; ++v)
+    {
+        if (interior[v])
+        {
+            mean.push_back(fabs(field.values[v*2]));
+            gaussian.push_back(fabs(field.values[v*2 + 1]));
+        }
+    }
+    field.mean_range = percentile(mean, CurvatureField::PERCENTILE);
+    field.gaussian_range = percentile(gaussian, CurvatureField::PERCENTILE);
+    return field;
+}
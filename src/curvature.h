@@ -0,0 +1,32 @@
+#ifndef CURVATURE_H
+#define CURVATURE_H
+
+#include <QtOpenGL/QtOpenGL>
+
+#include <vector>
+
+/*
+ *  Discrete curvature at each vertex of a welded mesh: mean curvature from
+ *  the cotangent Laplacian, and Gaussian curvature from the angle deficit,
+ *  both over the mixed Voronoi area around the vertex (Meyer et al.,
+ *  "Discrete Differential-Geometry Operators for Triangulated
+ *  2-Manifolds").  Mean curvature is positive where the surface bulges
+ *  outwards (against the winding's normals).  Vertices on open or
+ *  non-manifold edges get zero for both.
+ */
+struct CurvatureField
+{
+    // Mean and Gaussian curvature of each vertex, interleaved
+    std::vector<GLfloat> values;
+
+    // Most vertices (PERCENTILE of them) have curvatures smaller than
+    // these, which makes a robust range for colour-mapping
+    float mean_range;
+    float gaussian_range;
+    const static float PERCENTILE;
+};
+
+CurvatureField estimate_curvature(const std::vector<GLfloat>& vertices,
+                                  const std::vector<GLuint>& indices);
+
+#endif // CURVATURE_H
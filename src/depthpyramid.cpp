@@ -0,0 +1,155 @@
+#include <QOpenGLContext>
+#include <QOpenGLFunctions_4_5_Core>
+#include <QVector2D>
+
+#include <algorithm>
+
+#include "depthpyramid.h"
+
+DepthPyramid::DepthPyramid()
+    : fbo(0), depth(0), pyramid(0), depth_format(0), levels(0), captured(false)
+{
+    gl45 = QOpenGLContext::currentContext()->versionFunctions<QOpenGLFunctions_4_5_Core>();
+    gl45->initializeOpenGLFunctions();
+
+    shader.addCacheableShaderFromSourceFile(QOpenGLShader::Compute, ":/gl/depth_pyramid_core.comp");
+    shader.link();
+
+    gl45->glCreateFramebuffers(1, &fbo);
+    gl45->glNamedFramebufferDrawBuffer(fbo, GL_NONE);
+    gl45->glNamedFramebufferReadBuffer(fbo, GL_NONE);
+}
+
+DepthPyramid::~DepthPyramid()
+{
+    gl45->glDeleteTextures(1, &depth);
+    gl45->glDeleteTextures(1, &pyramid);
+    gl45->glDeleteFramebuffers(1, &fbo);
+}
+
+/*  Depth can only be blitted between identical formats, so the copy has
+ *  to match the framebuffer's own.  Returns 0 for anything unusual. */
+static GLenum matching_format(QOpenGLFunctions_4_5_Core* gl45, GLuint framebuffer)
+{
+    const GLenum depth_attachment = framebuffer ? GL_DEPTH_ATTACHMENT : GL_DEPTH;
+    const GLenum stencil_attachment = framebuffer ? GL_STENCIL_ATTACHMENT : GL_STENCIL;
+
+    GLint type = GL_NONE;
+    gl45->glGetNamedFramebufferAttachmentParameteriv(framebuffer, depth_attachment,
+            GL_FRAMEBUFFER_ATTACHMENT_OBJECT_TYPE, &type);
+    if (type == GL_NONE)
+    {
+        return 0;
+    }
+    GLint depth_bits = 0, component = GL_NONE, stencil_bits = 0;
+    gl45->glGetNamedFramebufferAttachmentParameteriv(framebuffer, depth_attachment,
+            GL_FRAMEBUFFER_ATTACHMENT_DEPTH_SIZE, &depth_bits);
+    gl45->glGetNamedFramebufferAttachmentParameteriv(framebuffer, depth_attachment,
+            GL_FRAMEBUFFER_ATTACHMENT_COMPONENT_TYPE, &component);
+    gl45->glGetNamedFramebufferAttachmentParameteriv(framebuffer, stencil_attachment,
+            GL_FRAMEBUFFER_ATTACHMENT_OBJECT_TYPE, &type);
+    if (type != GL_NONE)
+    {
+        gl45->glGetNamedFramebufferAttachmentParameteriv(framebuffer, stencil_attachment,
+                GL_FRAMEBUFFER_ATTACHMENT_STENCIL_SIZE, &stencil_bits);
+    }
+
+    const bool is_float = component == GL_FLOAT;
+    if (stencil_bits == 8)
+    {
+        if (depth_bits == 24 && !is_float)  return GL_DEPTH24_STENCIL8;
+        if (depth_bits == 32 && is_float)   return GL_DEPTH32F_STENCIL8;
+    }
+    else if (stencil_bits == 0)
+    {
+        if (depth_bits == 32 && is_float)   return GL_DEPTH_COMPONENT32F;
+        if (depth_bits == 32)               return GL_DEPTH_COMPONENT32;
+        if (depth_bits == 24)               return GL_DEPTH_COMPONENT24;
+        if (depth_bits == 16)               return GL_DEPTH_COMPONENT16;
+    }
+    return 0;
+}
+
+void DepthPyramid::resize(const QSize& s, GLenum format)
+{
+    gl45->glDeleteTextures(1, &depth);
+    gl45->glDeleteTextures(1, &pyramid);
+    size = s;
+    depth_format = format;
+
+    gl45->glCreateTextures(GL_TEXTURE_2D, 1, &depth);
+    gl45->glTextureStorage2D(depth, 1, format, s.width(), s.height());
+    gl45->glTextureParameteri(depth, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    gl45->glTextureParameteri(depth, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    const bool stencil = format == GL_DEPTH24_STENCIL8 || format == GL_DEPTH32F_STENCIL8;
+    gl45->glNamedFramebufferTexture(fbo, stencil ? GL_DEPTH_STENCIL_ATTACHMENT
+                                                 : GL_DEPTH_ATTACHMENT, depth, 0);
+
+    // Levels shrink like mipmaps (rounding down), and the last texel of
+    // each row and column also covers the odd one out below it
+    const int w = std::max(1, s.width() / 2);
+    const int h = std::max(1, s.height() / 2);
+    levels = 1;
+    while (std::max(w, h) >> levels)
+    {
+        levels++;
+    }
+    gl45->glCreateTextures(GL_TEXTURE_2D, 1, &pyramid);
+    gl45->glTextureStorage2D(pyramid, levels, GL_R32F, w, h);
+    gl45->glTextureParameteri(pyramid, GL_TEXTURE_MIN_FILTER, GL_NEAREST_MIPMAP_NEAREST);
+    gl45->glTextureParameteri(pyramid, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+}
+
+void DepthPyramid::capture(const QMatrix4x4& mvp)
+{
+    captured = false;
+
+    GLint viewport[4];
+    GLint source = 0;
+    gl45->glGetIntegerv(GL_VIEWPORT, viewport);
+    gl45->glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &source);
+    const QSize s(viewport[2], viewport[3]);
+    const GLenum format = matching_format(gl45, source);
+    if (!format || s.isEmpty() || !shader.isLinked())
+    {
+        return;
+    }
+    if (s != size || format != depth_format)
+    {
+        resize(s, format);
+    }
+
+    // Resolves multisampled depth too, since the sizes match
+    gl45->glBlitNamedFramebuffer(source, fbo,
+            viewport[0], viewport[1], viewport[0] + s.width(), viewport[1] + s.height(),
+            0, 0, s.width(), s.height(), GL_DEPTH_BUFFER_BIT, GL_NEAREST);
+
+    // Each level is reduced from the one below it, or from the copied
+    // depth for level 0
+    shader.bind();
+    shader.setUniformValue("source", 0);
+    for (GLint level=0; level < levels; ++level)
+    {
+        gl45->glBindTextureUnit(0, level ? pyramid : depth);
+        shader.setUniformValue("source_level", level ? level - 1 : 0);
+        gl45->glBindImageTexture(0, pyramid, level, GL_FALSE, 0, GL_WRITE_ONLY, GL_R32F);
+        const int w = std::max(1, (size.width() / 2) >> level);
+        const int h = std::max(1, (size.height() / 2) >> level);
+        gl45->glDispatchCompute((w + 7) / 8, (h + 7) / 8, 1);
+        gl45->glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT);
+    }
+    gl45->glBindTextureUnit(0, 0);
+    shader.release();
+
+    matrix = mvp;
+    captured = true;
+}
+
+void DepthPyramid::bind(QOpenGLShaderProgram* cull_shader,
+                        const QMatrix4x4& placement) const
+{
+    gl45->glBindTextureUnit(0, pyramid);
+    cull_shader->setUniformValue("pyramid", 0);
+    cull_shader->setUniformValue("pyramid_mvp", matrix * placement);
+    cull_shader->setUniformValue("pyramid_size", QVector2D(size.width(), size.height()));
+}
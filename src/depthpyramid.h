@@ -0,0 +1,58 @@
+#ifndef DEPTHPYRAMID_H
+#define DEPTHPYRAMID_H
+
+#include <QMatrix4x4>
+#include <QOpenGLShaderProgram>
+#include <QSize>
+
+class QOpenGLFunctions_4_5_Core;
+
+/*
+ *  Farthest depth over blocks of the last frame, for occlusion culling
+ *  on the OpenGL 4.5 core-profile path.  The depth of a finished frame is
+ *  blitted into a texture, then reduced into a mip chain where each texel
+ *  holds the farthest depth of the pixels under it, so that a cluster is
+ *  hidden if its nearest point is behind every texel that it covers.
+ */
+class DepthPyramid
+{
+public:
+    DepthPyramid();
+    ~DepthPyramid();
+
+    /*  Copies the depth of the framebuffer being drawn (over the current
+     *  viewport) and rebuilds the pyramid.  mvp is the matrix that the
+     *  scene was drawn with, which culling projects clusters by. */
+    void capture(const QMatrix4x4& mvp);
+
+    /*  Forgets the last capture, when what it shows has changed */
+    void reset() { captured = false; }
+
+    /*  Whether there is a capture to cull against */
+    bool ready() const { return captured; }
+
+    /*  Binds the pyramid to texture unit 0 and sets the uniforms that
+     *  cull_core.comp reads it with, for a mesh drawn with placement
+     *  applied before the captured matrix */
+    void bind(QOpenGLShaderProgram* cull_shader, const QMatrix4x4& placement) const;
+
+private:
+    void resize(const QSize& s, GLenum format);
+
+    QOpenGLFunctions_4_5_Core* gl45;
+    QOpenGLShaderProgram shader;
+
+    // Framebuffer holding the copied depth, and the pyramid reduced from
+    // it (half its size at level 0)
+    GLuint fbo;
+    GLuint depth;
+    GLuint pyramid;
+    QSize size;
+    GLenum depth_format;
+    GLint levels;
+
+    QMatrix4x4 matrix;
+    bool captured;
+};
+
+#endif // DEPTHPYRAMID_H
@@ -0,0 +1,108 @@
+#include <QDirIterator>
+
+#include <atomic>
+#include <unordered_map>
+
+#include "duplicates.h"
+#include "loader.h"
+#include "mesh.h"
+#include "signature.h"
+
+QStringList stl_files(const QString& folder)
+{
+    QStringList files;
+    QDirIterator it(folder, QStringList() << "*.stl", QDir::Files,
+                    QDirIterator::Subdirectories);
+    while (it.hasNext())
+    {
+        files << it.next();
+    }
+    files.sort();
+    return files;
+}
+
+QList<QStringList> find_duplicates(const QStringList& files, float tolerance,
+                                   QStringList* unreadable,
+                                   std::function<void()> done)
+{
+    const size_t count = files.size();
+    std::vector<ShapeSignature> signatures(count);
+    std::vector<QString> errors(count);
+
+    // Loading and signing a mesh are both split between all the workers
+    // already, so files are taken one at a time; running several loads
+    // at once would start workers squared threads.  Byte-for-byte copies
+    // share one signature, found by content hash.
+    std::unordered_map<quint64, ShapeSignature> known;
+    for (size_t i=0; i < count; ++i)
+    {
+        Mesh* mesh = Loader::load_now(files[i], &errors[i]);
+        if (mesh)
+        {
+            const auto k = known.find(mesh->fingerprint());
+            if (k != known.end())
+            {
+                signatures[i] = k->second;
+            }
+            else
+            {
+                signatures[i] = mesh->signature();
+                known[mesh->fingerprint()] = signatures[i];
+            }
+            delete mesh;
+        }
+        if (done)
+        {
+            done();
+        }
+    }
+
+    // Only readable files take part in the grouping
+    std::vector<ShapeSignature> readable;
+    std::vector<size_t> index;
+    for (size_t i=0; i < count; ++i)
+    {
+        if (errors[i].isEmpty())
+        {
+            readable.push_back(signatures[i]);
+            index.push_back(i);
+        }
+        else if (unreadable)
+        {
+            *unreadable << errors[i];
+        }
+    }
+
+    QList<QStringList> groups;
+    for (const auto& g : group_signatures(readable, tolerance))
+    {
+        QStringList group;
+        for (size_t i : g)
+        {
+            group << files[index[i]];
+        }
+        groups << group;
+    }
+    return groups;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+DuplicateFinder::DuplicateFinder(QObject* parent, const QString& folder)
+    : QThread(parent), folder(folder)
+{
+    qRegisterMetaType<QList<QStringList>>();
+}
+
+void DuplicateFinder::run()
+{
+    const QStringList files = stl_files(folder);
+    emit progress(0, files.size());
+
+    std::atomic<int> finished(0);
+    QStringList unreadable;
+    const QList<QStringList> groups = find_duplicates(
+            files, DUPLICATE_TOLERANCE, &unreadable,
+            [&]() { emit progress(++finished, files.size()); });
+    emit got_groups(groups, unreadable);
+}
@@ -0,0 +1,42 @@
+#ifndef DUPLICATES_H
+#define DUPLICATES_H
+
+#include <QThread>
+#include <QStringList>
+
+#include <functional>
+
+// Largest ShapeSignature::difference between copies of the same part
+const float DUPLICATE_TOLERANCE = 0.01f;
+
+/*  Returns the .stl files in a folder and its subfolders */
+QStringList stl_files(const QString& folder);
+
+/*  Loads every file and groups the ones holding the same part (in any
+ *  pose), comparing the shape signatures from signature.h.  Files that
+ *  can't be loaded are listed in unreadable, and done (if given) is
+ *  called as each file is finished.  */
+QList<QStringList> find_duplicates(const QStringList& files, float tolerance,
+                                   QStringList* unreadable,
+                                   std::function<void()> done=nullptr);
+
+/*
+ *  Finds duplicate parts in a folder (see above) on a background thread.
+ */
+class DuplicateFinder : public QThread
+{
+    Q_OBJECT
+public:
+    explicit DuplicateFinder(QObject* parent, const QString& folder);
+    void run();
+
+signals:
+    void progress(int done, int total);
+    void got_groups(const QList<QStringList>& groups,
+                    const QStringList& unreadable);
+
+private:
+    const QString folder;
+};
+
+#endif // DUPLICATES_H
@@ -0,0 +1,140 @@
+#include <QtEndian>
+
+#include "fingerprint.h"
+#include "parallel.h"
+
+const size_t ContentHash::CHUNK_SIZE;
+
+namespace {
+
+const quint64 PRIME1 = 11400714785074694791ULL;
+const quint64 PRIME2 = 14029467366897019727ULL;
+const quint64 PRIME3 = 1609587929392839161ULL;
+const quint64 PRIME4 = 9650029242287828579ULL;
+const quint64 PRIME5 = 2870177450012600261ULL;
+
+inline quint64 rotl(quint64 x, int r)
+{
+    return (x << r) | (x >> (64 - r));
+}
+
+inline quint64 xxh_round(quint64 acc, quint64 input)
+{
+    return rotl(acc + input * PRIME2, 31) * PRIME1;
+}
+
+inline quint64 merge(quint64 acc, quint64 value)
+{
+    return (acc ^ xxh_round(0, value)) * PRIME1 + PRIME4;
+}
+
+}   // anonymous namespace
+
+quint64 xxh64(const char* data, size_t size, quint64 seed)
+{
+    const uchar* p = reinterpret_cast<const uchar*>(data);
+    const uchar* const end = p + size;
+    quint64 h;
+
+    if (size >= 32)
+    {
+        quint64 v1 = seed + PRIME1 + PRIME2, v2 = seed + PRIME2;
+        quint64 v3 = seed, v4 = seed - PRIME1;
+        for (; p + 32 <= end; p += 32)
+        {
+            v1 = xxh_round(v1, qFromLittleEndian<quint64>(p));
+            v2 = xxh_round(v2, qFromLittleEndian<quint64>(p + 8));
+            v3 = xxh_round(v3, qFromLittleEndian<quint64>(p + 16));
+            v4 = xxh_round(v4, qFromLittleEndian<quint64>(p + 24));
+        }
+        h = rotl(v1, 1) + rotl(v2, 7) + rotl(v3, 12) + rotl(v4, 18);
+        h = merge(merge(merge(merge(h, v1), v2), v3), v4);
+    }
+    else
+    {
+        h = seed + PRIME5;
+    }
+    h += size;
+
+    for (; p + 8 <= end; p += 8)
+    {
+        h = rotl(h ^ xxh_round(0, qFromLittleEndian<quint64>(p)), 27) * PRIME1 + PRIME4;
+    }
+    if (p + 4 <= end)
+    {
+        h = rotl(h ^ (qFromLittleEndian<quint32>(p) * PRIME1), 23) * PRIME2 + PRIME3;
+        p += 4;
+    }
+    for (; p < end; ++p)
+    {
+        h = rotl(h ^ (*p * PRIME5), 11) * PRIME1;
+    }
+
+    h ^= h >> 33;
+    h *= PRIME2;
+    h ^= h >> 29;
+    h *= PRIME3;
+    h ^= h >> 32;
+    return h;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+ContentHash::ContentHash()
+    : length(0)
+{
+    // Nothing to do here
+}
+
+void ContentHash::add(const char* data, size_t size)
+{
+    length += size;
+
+    // Top up a partly-filled chunk first
+    if (!pending.empty())
+    {
+        const size_t n = std::min(size, CHUNK_SIZE - pending.size());
+        pending.insert(pending.end(), data, data + n);
+        data += n;
+        size -= n;
+        if (pending.size() < CHUNK_SIZE)
+        {
+            return;
+        }
+        chunks.push_back(xxh64(pending.data(), CHUNK_SIZE));
+        pending.clear();
+    }
+
+    // Whole chunks are hashed straight from the caller's buffer
+    const size_t whole = size / CHUNK_SIZE;
+    if (whole)
+    {
+        const size_t first = chunks.size();
+        chunks.resize(first + whole);
+        parallel_for(whole, [&](size_t begin, size_t end, size_t)
+        {
+            for (size_t i=begin; i < end; ++i)
+            {
+                chunks[first + i] = xxh64(data + i * CHUNK_SIZE, CHUNK_SIZE);
+            }
+        });
+        data += whole * CHUNK_SIZE;
+        size -= whole * CHUNK_SIZE;
+    }
+    pending.insert(pending.end(), data, data + size);
+}
+
+quint64 ContentHash::result() const
+{
+    std::vector<quint64> all = chunks;
+    if (!pending.empty())
+    {
+        all.push_back(xxh64(pending.data(), pending.size()));
+    }
+    for (auto& h : all)
+    {
+        h = qToLittleEndian(h);
+    }
+    return xxh64(reinterpret_cast<const char*>(all.data()),
+                 all.size() * sizeof(quint64), length);
+}
@@ -0,0 +1,39 @@
+#ifndef FINGERPRINT_H
+#define FINGERPRINT_H
+
+#include <QtGlobal>
+
+#include <vector>
+
+/*
+ *  Fast 64-bit hash of a file's contents, fed with the bytes as the loader
+ *  reads them (so it costs no extra pass over the file).  The contents are
+ *  split into fixed-size chunks, each hashed with XXH64, and large reads
+ *  hash their chunks in parallel; the chunk hashes are then hashed together
+ *  with the length, so the result doesn't depend on how reads are split.
+ *
+ *  This is for telling files apart (cache keys, reload checks, duplicate
+ *  detection), not for security.
+ */
+class ContentHash
+{
+public:
+    ContentHash();
+
+    void add(const char* data, size_t size);
+    void add(const QByteArray& data) { add(data.constData(), data.size()); }
+
+    quint64 result() const;
+
+    const static size_t CHUNK_SIZE = 1 << 20;
+
+private:
+    std::vector<quint64> chunks;
+    std::vector<char> pending;  // Start of the next chunk
+    quint64 length;
+};
+
+/*  XXH64 of one buffer */
+quint64 xxh64(const char* data, size_t size, quint64 seed=0);
+
+#endif // FINGERPRINT_H
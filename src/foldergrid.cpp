@@ -0,0 +1,195 @@
+#include <QFileInfo>
+#include <QPainter>
+#include <QSet>
+
+#include "foldergrid.h"
+#include "folderindex.h"
+#include "thumbnail.h"
+
+const int ThumbnailModel::MAX_CACHED;
+
+ThumbnailModel::ThumbnailModel(QObject* parent, FolderIndex* index)
+    : QAbstractListModel(parent), folder_index(index),
+      thumbnailer(new Thumbnailer(this)), thumbnails(MAX_CACHED),
+      placeholder(ThumbnailRenderer::SIZE, ThumbnailRenderer::SIZE)
+{
+    placeholder.fill(Qt::transparent);
+    QPainter painter(&placeholder);
+    painter.setPen(QPen(Qt::gray, 1, Qt::DashLine));
+    painter.drawRect(placeholder.rect().adjusted(4, 4, -5, -5));
+
+    QObject::connect(folder_index, &FolderIndex::updated,
+                     this, &ThumbnailModel::on_index_updated);
+    QObject::connect(thumbnailer, &Thumbnailer::rendered,
+                     this, &ThumbnailModel::on_rendered);
+    on_index_updated();
+}
+
+int ThumbnailModel::rowCount(const QModelIndex& parent) const
+{
+    return parent.isValid() ? 0 : files.size();
+}
+
+QVariant ThumbnailModel::data(const QModelIndex& index, int role) const
+{
+    if (!index.isValid() || index.row() >= files.size())
+    {
+        return QVariant();
+    }
+
+    const QString& filename = files[index.row()];
+    if (role == Qt::DisplayRole)
+    {
+        return QFileInfo(filename).fileName();
+    }
+    else if (role == Qt::ToolTipRole)
+    {
+        return filename;
+    }
+    else if (role == Qt::DecorationRole)
+    {
+        const QPixmap* pixmap = thumbnails.object(filename);
+        if (!pixmap)
+        {
+            // Asked again each time the cell is drawn, which moves it
+            // to the front of the queue while it's on screen
+            thumbnailer->request(filename);
+            return placeholder;
+        }
+        return pixmap->isNull() ? placeholder : *pixmap;
+    }
+    return QVariant();
+}
+
+void ThumbnailModel::on_index_updated()
+{
+    const QStringList updated = folder_index->files();
+    QSet<QString> present;
+    for (const auto& f : updated)
+    {
+        present.insert(f);
+    }
+
+    // Files in both lists should be in the same order in each (the index
+    // keeps them sorted), in which case only the rows that came and went
+    // are changed, and the view keeps its selection and scroll position.
+    // Anything else (e.g. a new folder) resets the model.
+    QStringList kept, expected;
+    for (const auto& f : files)
+    {
+        if (present.contains(f))
+        {
+            kept << f;
+        }
+    }
+    for (const auto& f : updated)
+    {
+        if (rows.contains(f))
+        {
+            expected << f;
+        }
+    }
+
+    if (kept.isEmpty() || kept != expected)
+    {
+        beginResetModel();
+        files = updated;
+        update_rows();
+        endResetModel();
+        return;
+    }
+
+    // Remove each run of missing files, from the end so that the rows
+    // before it keep their numbers
+    for (int i=files.size(); i > 0; )
+    {
+        if (present.contains(files[i - 1]))
+        {
+            i--;
+            continue;
+        }
+        int first = i - 1;
+        while (first > 0 && !present.contains(files[first - 1]))
+        {
+            first--;
+        }
+        beginRemoveRows(QModelIndex(), first, i - 1);
+        files.erase(files.begin() + first, files.begin() + i);
+        endRemoveRows();
+        i = first;
+    }
+
+    // Then insert each run of new files where it belongs
+    for (int i=0; i < updated.size(); )
+    {
+        if (i < files.size() && files[i] == updated[i])
+        {
+            i++;
+            continue;
+        }
+        int last = i;
+        while (last + 1 < updated.size() && !rows.contains(updated[last + 1]))
+        {
+            last++;
+        }
+        beginInsertRows(QModelIndex(), i, last);
+        for (int j=i; j <= last; ++j)
+        {
+            files.insert(j, updated[j]);
+        }
+        endInsertRows();
+        i = last + 1;
+    }
+    update_rows();
+}
+
+void ThumbnailModel::update_rows()
+{
+    rows.clear();
+    rows.reserve(files.size());
+    for (int i=0; i < files.size(); ++i)
+    {
+        rows[files[i]] = i;
+    }
+}
+
+void ThumbnailModel::on_rendered(const QString& filename, const QImage& image)
+{
+    thumbnails.insert(filename, new QPixmap(QPixmap::fromImage(image)));
+    const int row = rows.value(filename, -1);
+    if (row >= 0)
+    {
+        const QModelIndex i = index(row);
+        emit dataChanged(i, i, QVector<int>() << Qt::DecorationRole);
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+FolderGrid::FolderGrid(QWidget* parent, FolderIndex* index)
+    : QListView(parent), model(new ThumbnailModel(this, index))
+{
+    setModel(model);
+    setViewMode(QListView::IconMode);
+    setMovement(QListView::Static);
+    setResizeMode(QListView::Adjust);
+    setSelectionMode(QAbstractItemView::SingleSelection);
+    setTextElideMode(Qt::ElideMiddle);
+    setVerticalScrollMode(QAbstractItemView::ScrollPerPixel);
+
+    // Fixed cell sizes and batched layout keep folders with thousands
+    // of files from stalling the view
+    setIconSize(QSize(ThumbnailRenderer::SIZE, ThumbnailRenderer::SIZE));
+    setGridSize(QSize(ThumbnailRenderer::SIZE + 24, ThumbnailRenderer::SIZE + 40));
+    setUniformItemSizes(true);
+    setLayoutMode(QListView::Batched);
+    setBatchSize(1000);
+
+    QObject::connect(this, &QListView::activated,
+                     this, &FolderGrid::on_activated);
+}
+
+void FolderGrid::on_activated(const QModelIndex& index)
+{
+    emit file_activated(model->file(index.row()));
+}
@@ -0,0 +1,69 @@
+#ifndef FOLDERGRID_H
+#define FOLDERGRID_H
+
+#include <QAbstractListModel>
+#include <QCache>
+#include <QListView>
+#include <QPixmap>
+
+class FolderIndex;
+class Thumbnailer;
+
+/*
+ *  Model of the files in a FolderIndex, with thumbnails as decorations.
+ *  Views only ask for the data of cells they draw, so thumbnails are
+ *  requested for visible cells only, and filled in as they arrive.
+ */
+class ThumbnailModel : public QAbstractListModel
+{
+    Q_OBJECT
+public:
+    explicit ThumbnailModel(QObject* parent, FolderIndex* index);
+
+    int rowCount(const QModelIndex& parent=QModelIndex()) const override;
+    QVariant data(const QModelIndex& index, int role) const override;
+
+    /*  Returns the path of the file in the given row */
+    QString file(int row) const { return files[row]; }
+
+private slots:
+    void on_index_updated();
+    void on_rendered(const QString& filename, const QImage& image);
+
+private:
+    void update_rows();
+
+    FolderIndex* const folder_index;
+    Thumbnailer* const thumbnailer;
+
+    QStringList files;
+    QHash<QString, int> rows;
+
+    // Thumbnails that have arrived (null for unreadable files), up to
+    // MAX_CACHED of them; evicted ones are reloaded from the disk cache
+    QCache<QString, QPixmap> thumbnails;
+    QPixmap placeholder;
+
+    const static int MAX_CACHED = 2048;
+};
+
+/*
+ *  Grid of thumbnails of the files in the current folder
+ */
+class FolderGrid : public QListView
+{
+    Q_OBJECT
+public:
+    explicit FolderGrid(QWidget* parent, FolderIndex* index);
+
+signals:
+    void file_activated(const QString& filename);
+
+private slots:
+    void on_activated(const QModelIndex& index);
+
+private:
+    ThumbnailModel* const model;
+};
+
+#endif // FOLDERGRID_H
@@ -0,0 +1,233 @@
+#include <QDir>
+#include <QFileInfo>
+#include <QFileSystemWatcher>
+#include <QSet>
+
+#include <algorithm>
+
+#include "folderindex.h"
+#include "parallel.h"
+
+bool folder_order(const FolderEntry& a, const FolderEntry& b)
+{
+    const int c = a.key.compare(b.key);
+    return c ? c < 0 : a.name < b.name;
+}
+
+static QCollator natural_collator()
+{
+    QCollator collator;
+    collator.setNumericMode(true);
+    return collator;
+}
+
+FolderEntries sorted_entries(const QStringList& names)
+{
+    // Each worker keys and sorts its own run of names (QCollator isn't
+    // thread-safe, so each has its own), then the runs are merged
+    std::vector<FolderEntries> runs(worker_count());
+    parallel_for(names.size(), [&](size_t begin, size_t end, size_t w)
+    {
+        const QCollator collator = natural_collator();
+        FolderEntries& run = runs[w];
+        run.reserve(end - begin);
+        for (size_t i=begin; i < end; ++i)
+        {
+            run.push_back({names[i], collator.sortKey(names[i])});
+        }
+        std::sort(run.begin(), run.end(), folder_order);
+    });
+
+    while (runs.size() > 1)
+    {
+        std::vector<FolderEntries> merged((runs.size() + 1) / 2);
+        parallel_for(merged.size(), [&](size_t begin, size_t end, size_t)
+        {
+            for (size_t i=begin; i < end; ++i)
+            {
+                if (2*i + 1 == runs.size())
+                {
+                    merged[i] = std::move(runs[2*i]);
+                    continue;
+                }
+                const FolderEntries& a = runs[2*i];
+                const FolderEntries& b = runs[2*i + 1];
+                merged[i].reserve(a.size() + b.size());
+                std::merge(a.begin(), a.end(), b.begin(), b.end(),
+                           std::back_inserter(merged[i]), folder_order);
+            }
+        });
+        runs.swap(merged);
+    }
+    return runs.empty() ? FolderEntries() : std::move(runs.front());
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+FolderScanner::FolderScanner(QObject* parent, const QString& folder,
+                             std::shared_ptr<const FolderEntries> previous)
+    : QThread(parent), folder(folder), previous(previous)
+{
+    // Nothing to do here
+}
+
+void FolderScanner::run()
+{
+    const QStringList names = QDir(folder).entryList(
+            QStringList() << "*.stl",
+            QDir::Files | QDir::Readable | QDir::Hidden, QDir::Unsorted);
+    QSet<QString> added;
+    for (const auto& name : names)
+    {
+        added.insert(name);
+    }
+
+    // Entries that are still there keep their place, which leaves only
+    // the new names to key and sort before merging them in
+    FolderEntries kept;
+    if (previous)
+    {
+        kept.reserve(previous->size());
+        for (const auto& e : *previous)
+        {
+            if (added.remove(e.name))
+            {
+                kept.push_back(e);
+            }
+        }
+    }
+    const FolderEntries fresh = sorted_entries(added.values());
+
+    result.reserve(kept.size() + fresh.size());
+    std::merge(kept.begin(), kept.end(), fresh.begin(), fresh.end(),
+               std::back_inserter(result), folder_order);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+FolderIndex::FolderIndex(QObject* parent)
+    : QObject(parent), entries(std::make_shared<FolderEntries>()),
+      is_ready(false), scanner(nullptr), rescan(false),
+      watcher(new QFileSystemWatcher(this)), collator(natural_collator())
+{
+    QObject::connect(watcher, &QFileSystemWatcher::directoryChanged,
+                     this, &FolderIndex::on_directory_changed);
+}
+
+FolderIndex::~FolderIndex()
+{
+    // The scanner can't be deleted (as our child) while it's running
+    if (scanner)
+    {
+        scanner->wait();
+    }
+}
+
+void FolderIndex::set_file(const QString& filename)
+{
+    const QString path = QFileInfo(filename).absolutePath();
+    if (path == folder)
+    {
+        return;
+    }
+
+    folder = path;
+    entries = std::make_shared<FolderEntries>();
+    is_ready = false;
+    if (!watcher->directories().isEmpty())
+    {
+        watcher->removePaths(watcher->directories());
+    }
+    watcher->addPath(folder);
+    scan();
+    emit updated();
+}
+
+void FolderIndex::scan()
+{
+    // Changes that arrive during a scan are picked up by one more scan
+    // once it finishes, so bursts of changes don't pile up threads
+    if (scanner)
+    {
+        rescan = true;
+        return;
+    }
+    rescan = false;
+    scanner = new FolderScanner(this, folder, entries);
+    QObject::connect(scanner, &FolderScanner::finished,
+                     this, &FolderIndex::on_scanned);
+    scanner->start();
+}
+
+void FolderIndex::on_directory_changed()
+{
+    scan();
+}
+
+void FolderIndex::on_scanned()
+{
+    // Results for a folder we've since left are dropped
+    if (scanner->folder == folder)
+    {
+        entries = std::make_shared<FolderEntries>(std::move(scanner->result));
+        is_ready = true;
+        emit updated();
+    }
+    else
+    {
+        rescan = true;
+    }
+    scanner->deleteLater();
+    scanner = nullptr;
+
+    if (rescan)
+    {
+        scan();
+    }
+}
+
+QString FolderIndex::neighbor(const QString& filename, int step) const
+{
+    const QFileInfo info(filename);
+    if (!is_ready || info.absolutePath() != folder)
+    {
+        return QString();
+    }
+
+    // The current file may have been deleted, so this finds where it
+    // would be rather than expecting to find it
+    const FolderEntry target = {info.fileName(), collator.sortKey(info.fileName())};
+    auto it = std::lower_bound(entries->begin(), entries->end(),
+                               target, folder_order);
+    if (step > 0)
+    {
+        if (it != entries->end() && it->name == target.name)
+        {
+            ++it;
+        }
+        if (it == entries->end())
+        {
+            return QString();
+        }
+    }
+    else
+    {
+        if (it == entries->begin())
+        {
+            return QString();
+        }
+        --it;
+    }
+    return folder + QDir::separator() + it->name;
+}
+
+QStringList FolderIndex::files() const
+{
+    QStringList out;
+    out.reserve(entries->size());
+    for (const auto& e : *entries)
+    {
+        out << folder + QDir::separator() + e.name;
+    }
+    return out;
+}
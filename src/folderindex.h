@@ -0,0 +1,100 @@
+#ifndef FOLDERINDEX_H
+#define FOLDERINDEX_H
+
+#include <QCollator>
+#include <QThread>
+
+#include <memory>
+#include <vector>
+
+class QFileSystemWatcher;
+
+/*  File name with its precomputed natural-order collation key */
+struct FolderEntry
+{
+    QString name;
+    QCollatorSortKey key;
+};
+typedef std::vector<FolderEntry> FolderEntries;
+
+/*  Orders entries by key, then by name (so that names the collator
+ *  considers equal, like "a1" and "a01", still have a fixed order) */
+bool folder_order(const FolderEntry& a, const FolderEntry& b);
+
+/*  Returns entries for the given names in natural order, computing the
+ *  keys and sorting in parallel */
+FolderEntries sorted_entries(const QStringList& names);
+
+/*
+ *  Lists the .stl files in a folder on a background thread, reusing the
+ *  entries (and keys) of a previous listing for names that are still
+ *  there, so that only new files need keys and sorting.
+ */
+class FolderScanner : public QThread
+{
+    Q_OBJECT
+public:
+    explicit FolderScanner(QObject* parent, const QString& folder,
+                           std::shared_ptr<const FolderEntries> previous);
+    void run();
+
+    const QString folder;
+
+    // Sorted entries, once the thread has finished
+    FolderEntries result;
+
+private:
+    const std::shared_ptr<const FolderEntries> previous;
+};
+
+/*
+ *  Naturally sorted catalogue of the .stl files in the folder of the
+ *  current file, for stepping through them with the arrow keys.  It is
+ *  built in the background and kept up to date as files are added or
+ *  removed, and lookups are binary searches that never wait on a scan.
+ */
+class FolderIndex : public QObject
+{
+    Q_OBJECT
+public:
+    explicit FolderIndex(QObject* parent);
+    ~FolderIndex();
+
+    /*  Starts indexing the folder holding filename, unless it's already
+     *  indexed (or being indexed) */
+    void set_file(const QString& filename);
+
+    /*  Returns the path of the file before (step < 0) or after (step > 0)
+     *  filename in its folder, or an empty string if there isn't one or
+     *  the folder hasn't been indexed yet */
+    QString neighbor(const QString& filename, int step) const;
+
+    /*  Returns the path of every indexed file, in order */
+    QStringList files() const;
+
+signals:
+    /*  Emitted when the folder changes, and whenever a scan finishes */
+    void updated();
+
+private slots:
+    void on_directory_changed();
+    void on_scanned();
+
+private:
+    void scan();
+
+    QString folder;
+    std::shared_ptr<const FolderEntries> entries;
+
+    // Set once entries hold a listing of folder
+    bool is_ready;
+
+    // Running scan (or null), and whether another is needed after it
+    FolderScanner* scanner;
+    bool rescan;
+
+    QFileSystemWatcher* const watcher;
+    QCollator collator;
+};
+
+#endif // FOLDERINDEX_H
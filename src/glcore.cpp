@@ -0,0 +1,66 @@
+#include <QOffscreenSurface>
+#include <QOpenGLContext>
+
+#include "glcore.h"
+
+QSurfaceFormat gl_surface_format(bool core)
+{
+    QSurfaceFormat format;
+    format.setDepthBufferSize(24);
+    format.setStencilBufferSize(8);
+    if (core)
+    {
+        format.setVersion(4, 5);
+    }
+    else
+    {
+        format.setVersion(2, 1);
+    }
+    format.setProfile(QSurfaceFormat::CoreProfile);
+    return format;
+}
+
+bool gl_core_available()
+{
+    const QSurfaceFormat format = gl_surface_format(true);
+
+    QOffscreenSurface surface;
+    surface.setFormat(format);
+    surface.create();
+
+    QOpenGLContext context;
+    context.setFormat(format);
+    if (!context.create() || !context.makeCurrent(&surface))
+    {
+        return false;
+    }
+
+    // Drivers may hand back an older context than the one we asked for
+    const auto actual = context.format();
+    const bool okay = actual.profile() == QSurfaceFormat::CoreProfile &&
+                      actual.version() >= qMakePair(4, 5);
+    context.doneCurrent();
+    return okay;
+}
+
+bool gl_core_current()
+{
+    const auto context = QOpenGLContext::currentContext();
+    if (!context)
+    {
+        return false;
+    }
+    const auto format = context->format();
+    return format.profile() == QSurfaceFormat::CoreProfile &&
+           format.version() >= qMakePair(4, 5);
+}
+
+QString gl_shader_path(const QString& name)
+{
+    QString path = ":/gl/" + name;
+    if (gl_core_current())
+    {
+        path.insert(path.lastIndexOf('.'), "_core");
+    }
+    return path;
+}
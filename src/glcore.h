@@ -0,0 +1,26 @@
+#ifndef GLCORE_H
+#define GLCORE_H
+
+#include <QSurfaceFormat>
+#include <QString>
+
+/*
+ *  Helpers for the optional OpenGL 4.5 core-profile renderer (--gl-core).
+ *  The default renderer targets OpenGL 2.1 and is always available as a
+ *  fallback.
+ */
+
+/*  Returns the surface format to request for the chosen renderer */
+QSurfaceFormat gl_surface_format(bool core);
+
+/*  Checks whether a 4.5 core-profile context can actually be created */
+bool gl_core_available();
+
+/*  Returns true if the current context uses the 4.5 core-profile path */
+bool gl_core_current();
+
+/*  Returns the resource path of a shader, picking the core-profile
+ *  variant ("name_core.ext") when the current context needs it */
+QString gl_shader_path(const QString& name);
+
+#endif // GLCORE_H
@@ -1,11 +1,65 @@
+#include <QOpenGLContext>
+#include <QOpenGLFunctions_4_5_Core>
+#include <QOpenGLShaderProgram>
+
+#include <algorithm>
+#include <cmath>
+
 #include "glmesh.h"
+#include "glcore.h"
+#include "depthpyramid.h"
 #include "mesh.h"
 
 GLMesh::GLMesh(const Mesh* const mesh)
-    : vertices(QOpenGLBuffer::VertexBuffer), indices(QOpenGLBuffer::IndexBuffer)
+    : GLMesh(mesh->vertices.data(), mesh->vertices.size() / 3,
+             mesh->indices.data(), mesh->indices.size(),
+             mesh->cluster_bounds.data(),
+             mesh->hasColors() ? mesh->face_colors.data() : nullptr,
+             mesh->cluster_cones.empty() ? nullptr : mesh->cluster_cones.data(),
+             mesh->hasCurvature() ? mesh->curvature().values.data() : nullptr)
+{
+    // Nothing to do here
+}
+
+GLMesh::GLMesh(const GLfloat* vertex_data, size_t vertex_count,
+               const GLuint* index_data, size_t index_count,
+               const GLfloat* cluster_bounds, const GLuint* face_colors,
+               const GLfloat* cluster_cones, const GLfloat* vertex_curvature)
+    : vertices(QOpenGLBuffer::VertexBuffer), indices(QOpenGLBuffer::IndexBuffer),
+      curvature(QOpenGLBuffer::VertexBuffer), curvature_uploaded(vertex_curvature != nullptr),
+      total_indices(index_count), total_vertices(vertex_count), spacing(0),
+      color_texture(0),
+      gl45(nullptr), vao(0), core_buffers{0, 0, 0, 0, 0, 0, 0}, cluster_count(0),
+      core_bounds(false), core_cones(false)
 {
     initializeOpenGLFunctions();
 
+    // A cluster's triangles cover roughly the disk of its bounding sphere,
+    // shared among about half as many vertices
+    const size_t clusters = (index_count / 3 + Mesh::CLUSTER_TRIANGLES - 1)
+                          / Mesh::CLUSTER_TRIANGLES;
+    if (cluster_bounds && clusters)
+    {
+        double r = 0;
+        for (size_t c=0; c < clusters; ++c)
+        {
+            r += cluster_bounds[c * 4 + 3];
+        }
+        spacing = r / clusters * sqrt(M_PI / (Mesh::CLUSTER_TRIANGLES / 2));
+    }
+
+    if (face_colors)
+    {
+        create_color_texture(face_colors, index_count / 3);
+    }
+
+    if (gl_core_current())
+    {
+        create_core(vertex_data, vertex_count, index_data, index_count,
+                    cluster_bounds, has_colors(), cluster_cones, vertex_curvature);
+        return;
+    }
+
     vertices.create();
     indices.create();
 
@@ -13,25 +67,347 @@ GLMesh::GLMesh(const Mesh* const mesh)
     indices.setUsagePattern(QOpenGLBuffer::StaticDraw);
 
     vertices.bind();
-    vertices.allocate(mesh->vertices.data(),
-                      mesh->vertices.size() * sizeof(float));
+    vertices.allocate(vertex_data, vertex_count * 3 * sizeof(float));
     vertices.release();
 
     indices.bind();
-    indices.allocate(mesh->indices.data(),
-                     mesh->indices.size() * sizeof(uint32_t));
+    indices.allocate(index_data, index_count * sizeof(uint32_t));
     indices.release();
+
+    if (vertex_curvature)
+    {
+        curvature.create();
+        curvature.setUsagePattern(QOpenGLBuffer::StaticDraw);
+        curvature.bind();
+        curvature.allocate(vertex_curvature, vertex_count * 2 * sizeof(float));
+        curvature.release();
+    }
+
+    // Until the first cull, everything is visible
+    visible.push_back(std::make_pair(0u, total_indices));
+    if (cluster_bounds)
+    {
+        bounds.assign(cluster_bounds, cluster_bounds + clusters * 4);
+        if (cluster_cones)
+        {
+            cones.assign(cluster_cones, cluster_cones + clusters * 4);
+        }
+    }
+}
+
+GLMesh::~GLMesh()
+{
+    if (gl45)
+    {
+        gl45->glDeleteVertexArrays(1, &vao);
+        gl45->glDeleteBuffers(7, core_buffers);
+    }
+    glDeleteTextures(1, &color_texture);
+}
+
+void GLMesh::create_color_texture(const GLuint* face_colors, size_t tri_count)
+{
+    GLint max_size;
+    glGetIntegerv(GL_MAX_TEXTURE_SIZE, &max_size);
+    const GLsizei rows = (tri_count + COLOR_TEXTURE_WIDTH - 1) / COLOR_TEXTURE_WIDTH;
+    if (rows == 0 || rows > max_size || COLOR_TEXTURE_WIDTH > max_size)
+    {
+        return;
+    }
+
+    // Upload full rows, then the partial last row, so that the colours
+    // never need to be copied into a padded array
+    glGenTextures(1, &color_texture);
+    glBindTexture(GL_TEXTURE_2D, color_texture);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, COLOR_TEXTURE_WIDTH, rows, 0,
+                 GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+    const GLsizei full_rows = tri_count / COLOR_TEXTURE_WIDTH;
+    if (full_rows)
+    {
+        glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, COLOR_TEXTURE_WIDTH, full_rows,
+                        GL_RGBA, GL_UNSIGNED_BYTE, face_colors);
+    }
+    if (full_rows < rows)
+    {
+        glTexSubImage2D(GL_TEXTURE_2D, 0, 0, full_rows,
+                        tri_count % COLOR_TEXTURE_WIDTH, 1, GL_RGBA, GL_UNSIGNED_BYTE,
+                        face_colors + size_t(full_rows) * COLOR_TEXTURE_WIDTH);
+    }
+    glBindTexture(GL_TEXTURE_2D, 0);
+}
+
+void GLMesh::bind_colors()
+{
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, color_texture);
+}
+
+void GLMesh::create_core(const GLfloat* vertex_data, size_t vertex_count,
+                         const GLuint* index_data, size_t index_count,
+                         const GLfloat* cluster_bounds, bool face_colors,
+                         const GLfloat* cluster_cones, const GLfloat* vertex_curvature)
+{
+    gl45 = QOpenGLContext::currentContext()->versionFunctions<QOpenGLFunctions_4_5_Core>();
+    gl45->initializeOpenGLFunctions();
+
+    // Layout of the commands read by glMultiDrawElementsIndirect.  Each
+    // cluster is drawn as instance (base_instance) c, which picks its
+    // first triangle out of an instanced attribute for colour lookups.
+    struct DrawElementsIndirectCommand
+    {
+        GLuint count;
+        GLuint instance_count;
+        GLuint first_index;
+        GLint base_vertex;
+        GLuint base_instance;
+    };
+
+    const GLuint tri_count = index_count / 3;
+    std::vector<DrawElementsIndirectCommand> commands;
+    std::vector<GLuint> first_triangles;
+    commands.reserve((tri_count + Mesh::CLUSTER_TRIANGLES - 1) / Mesh::CLUSTER_TRIANGLES);
+    for (GLuint t=0; t < tri_count; t += Mesh::CLUSTER_TRIANGLES)
+    {
+        const GLuint n = std::min<GLuint>(Mesh::CLUSTER_TRIANGLES, tri_count - t);
+        commands.push_back({n * 3, 1, t * 3, 0, GLuint(commands.size())});
+        first_triangles.push_back(t);
+    }
+    cluster_count = commands.size();
+
+    // The geometry buffers are immutable, since the mesh never changes
+    // once uploaded.  The command buffer is only written by the culling
+    // compute shader, which immutable storage allows.
+    gl45->glCreateBuffers(7, core_buffers);
+    gl45->glNamedBufferStorage(core_buffers[0],
+            std::max<GLsizeiptr>(vertex_count * 3 * sizeof(GLfloat), 1), vertex_data, 0);
+    gl45->glNamedBufferStorage(core_buffers[1],
+            std::max<GLsizeiptr>(index_count * sizeof(GLuint), 1), index_data, 0);
+    gl45->glNamedBufferStorage(core_buffers[2],
+            std::max<GLsizeiptr>(commands.size() * sizeof(commands[0]), 1),
+            commands.data(), 0);
+    if (cluster_bounds)
+    {
+        gl45->glNamedBufferStorage(core_buffers[3],
+                std::max<GLsizeiptr>(cluster_count * 4 * sizeof(GLfloat), 1),
+                cluster_bounds, 0);
+        core_bounds = true;
+        if (cluster_cones)
+        {
+            gl45->glNamedBufferStorage(core_buffers[5],
+                    std::max<GLsizeiptr>(cluster_count * 4 * sizeof(GLfloat), 1),
+                    cluster_cones, 0);
+            core_cones = true;
+        }
+    }
+
+    // The vertex array object records the layout, so draw_core only has
+    // to bind it.  Positions are at attribute location 0 in mesh_core.vert
+    gl45->glCreateVertexArrays(1, &vao);
+    gl45->glVertexArrayVertexBuffer(vao, 0, core_buffers[0], 0, 3 * sizeof(GLfloat));
+    gl45->glVertexArrayAttribFormat(vao, 0, 3, GL_FLOAT, GL_FALSE, 0);
+    gl45->glVertexArrayAttribBinding(vao, 0, 0);
+    gl45->glEnableVertexArrayAttrib(vao, 0);
+    gl45->glVertexArrayElementBuffer(vao, core_buffers[1]);
+
+    if (face_colors)
+    {
+        gl45->glNamedBufferStorage(core_buffers[4],
+                std::max<GLsizeiptr>(first_triangles.size() * sizeof(GLuint), 1),
+                first_triangles.data(), 0);
+        gl45->glVertexArrayVertexBuffer(vao, 1, core_buffers[4], 0, sizeof(GLuint));
+        gl45->glVertexArrayAttribIFormat(vao, 1, 1, GL_UNSIGNED_INT, 0);
+        gl45->glVertexArrayAttribBinding(vao, 1, 1);
+        gl45->glVertexArrayBindingDivisor(vao, 1, 1);
+        gl45->glEnableVertexArrayAttrib(vao, 1);
+    }
+
+    // Curvatures are at attribute location 2 in mesh_curvature_core.vert
+    if (vertex_curvature)
+    {
+        gl45->glNamedBufferStorage(core_buffers[6],
+                std::max<GLsizeiptr>(vertex_count * 2 * sizeof(GLfloat), 1),
+                vertex_curvature, 0);
+        gl45->glVertexArrayVertexBuffer(vao, 2, core_buffers[6], 0, 2 * sizeof(GLfloat));
+        gl45->glVertexArrayAttribFormat(vao, 2, 2, GL_FLOAT, GL_FALSE, 0);
+        gl45->glVertexArrayAttribBinding(vao, 2, 2);
+        gl45->glEnableVertexArrayAttrib(vao, 2);
+    }
 }
 
-void GLMesh::draw(GLuint vp)
+void GLMesh::cull(const QMatrix4x4& mvp, QOpenGLShaderProgram* cull_shader,
+                  bool backfaces, const DepthPyramid* occluders,
+                  const QMatrix4x4& placement)
 {
+    // Frustum planes, extracted from the rows of the matrix and normalized
+    // so that they give distances in model space
+    QVector4D planes[6];
+    for (int i=0; i < 3; ++i)
+    {
+        planes[2*i]     = mvp.row(3) + mvp.row(i);
+        planes[2*i + 1] = mvp.row(3) - mvp.row(i);
+    }
+    for (auto& p : planes)
+    {
+        p /= p.toVector3D().length();
+    }
+
+    // The eye in homogeneous model coordinates (with w = 0 for an
+    // orthographic view).  E.xyz - c * E.w then points from the eye
+    // towards c, scaled by -E.w, which is never negative.
+    const QVector4D eye = mvp.inverted() * QVector4D(0, 0, 1, 0);
+
+    if (gl45)
+    {
+        if (!core_bounds || !cull_shader)
+        {
+            return;
+        }
+        cull_shader->bind();
+        cull_shader->setUniformValueArray("planes", planes, 6);
+        cull_shader->setUniformValue("cluster_count", GLuint(cluster_count));
+        cull_shader->setUniformValue("eye", eye);
+        cull_shader->setUniformValue("use_cones", GLuint(backfaces && core_cones));
+        cull_shader->setUniformValue("use_pyramid", GLuint(occluders != nullptr));
+        if (occluders)
+        {
+            occluders->bind(cull_shader, placement);
+        }
+        gl45->glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, core_buffers[3]);
+        gl45->glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, core_buffers[2]);
+        gl45->glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 2, core_buffers[5]);
+        gl45->glDispatchCompute((cluster_count + 63) / 64, 1, 1);
+        gl45->glMemoryBarrier(GL_COMMAND_BARRIER_BIT);
+        gl45->glBindTextureUnit(0, 0);
+        cull_shader->release();
+        return;
+    }
+
+    if (bounds.empty())
+    {
+        return;
+    }
+
+    // Merge runs of visible clusters into index ranges, so that a mesh
+    // that is entirely on screen still takes a single draw call.
+    visible.clear();
+    for (size_t c=0; c < bounds.size() / 4; ++c)
+    {
+        const GLfloat* b = &bounds[c * 4];
+        bool inside = true;
+        for (const auto& p : planes)
+        {
+            if (p.x()*b[0] + p.y()*b[1] + p.z()*b[2] + p.w() < -b[3])
+            {
+                inside = false;
+                break;
+            }
+        }
+        if (!inside)
+        {
+            continue;
+        }
+
+        // A cluster faces away if every normal in its cone does, from
+        // every point of its bounding sphere
+        if (backfaces && !cones.empty())
+        {
+            const GLfloat* cone = &cones[c * 4];
+            const QVector3D v = eye.toVector3D() - QVector3D(b[0], b[1], b[2]) * eye.w();
+            if (QVector3D::dotProduct(v, QVector3D(cone[0], cone[1], cone[2])) >
+                cone[3] * v.length() - b[3] * eye.w())
+            {
+                continue;
+            }
+        }
+
+        const GLuint first = c * Mesh::CLUSTER_TRIANGLES * 3;
+        const GLuint count = std::min<GLuint>(Mesh::CLUSTER_TRIANGLES * 3,
+                                              total_indices - first);
+        if (!visible.empty() &&
+            visible.back().first + visible.back().second == first)
+        {
+            visible.back().second += count;
+        }
+        else
+        {
+            visible.push_back(std::make_pair(first, count));
+        }
+    }
+}
+
+void GLMesh::draw(GLuint vp, GLint offset_location, GLint curvature_location)
+{
+    if (gl45)
+    {
+        draw_core();
+        return;
+    }
+
+    const bool curvatures = curvature_uploaded && curvature_location >= 0;
+    if (curvatures)
+    {
+        curvature.bind();
+        glVertexAttribPointer(curvature_location, 2, GL_FLOAT, false, 2*sizeof(float), NULL);
+        glEnableVertexAttribArray(curvature_location);
+        curvature.release();
+    }
+
     vertices.bind();
     indices.bind();
 
     glVertexAttribPointer(vp, 3, GL_FLOAT, false, 3*sizeof(float), NULL);
-    glDrawElements(GL_TRIANGLES, indices.size() / sizeof(uint32_t),
-                   GL_UNSIGNED_INT, NULL);
+    for (const auto& range : visible)
+    {
+        if (offset_location >= 0)
+        {
+            glUniform1i(offset_location, range.first / 3);
+        }
+        glDrawElements(GL_TRIANGLES, range.second, GL_UNSIGNED_INT,
+                       (GLvoid*)(range.first * sizeof(uint32_t)));
+    }
 
     vertices.release();
     indices.release();
+    if (curvatures)
+    {
+        glDisableVertexAttribArray(curvature_location);
+    }
+}
+
+void GLMesh::draw_points(GLuint vp)
+{
+    // Points don't go through the index buffer, so cluster culling
+    // doesn't apply; every welded vertex is drawn once.
+    if (gl45)
+    {
+        GLint previous_vao;
+        gl45->glGetIntegerv(GL_VERTEX_ARRAY_BINDING, &previous_vao);
+        gl45->glBindVertexArray(vao);
+        gl45->glDrawArrays(GL_POINTS, 0, total_vertices);
+        gl45->glBindVertexArray(previous_vao);
+        return;
+    }
+
+    vertices.bind();
+    glVertexAttribPointer(vp, 3, GL_FLOAT, false, 3*sizeof(float), NULL);
+    glDrawArrays(GL_POINTS, 0, total_vertices);
+    vertices.release();
+}
+
+void GLMesh::draw_core()
+{
+    // Restore the caller's vertex array afterwards, since the backdrop
+    // and axes draw with a shared one
+    GLint previous_vao;
+    gl45->glGetIntegerv(GL_VERTEX_ARRAY_BINDING, &previous_vao);
+
+    gl45->glBindVertexArray(vao);
+    gl45->glBindBuffer(GL_DRAW_INDIRECT_BUFFER, core_buffers[2]);
+    gl45->glMultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT,
+                                      nullptr, cluster_count, 0);
+    gl45->glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+
+    gl45->glBindVertexArray(previous_vao);
 }
@@ -3,18 +3,101 @@
 
 #include <QOpenGLBuffer>
 #include <QOpenGLFunctions>
+#include <QMatrix4x4>
+
+#include <vector>
 
 // forward declaration
 class Mesh;
+class DepthPyramid;
+class QOpenGLFunctions_4_5_Core;
+class QOpenGLShaderProgram;
 
 class GLMesh : protected QOpenGLFunctions
 {
 public:
     GLMesh(const Mesh* const mesh);
-    void draw(GLuint vp);
+    GLMesh(const GLfloat* vertex_data, size_t vertex_count,
+           const GLuint* index_data, size_t index_count,
+           const GLfloat* cluster_bounds=nullptr,
+           const GLuint* face_colors=nullptr,
+           const GLfloat* cluster_cones=nullptr,
+           const GLfloat* vertex_curvature=nullptr);
+    ~GLMesh();
+
+    /*  Culls clusters against the view frustum of the given matrix, and
+     *  (if backfaces is set and the mesh has normal cones) clusters that
+     *  face entirely away from the eye.  On the core-profile path this
+     *  runs the cull_shader compute program, which writes the indirect
+     *  draw buffer, and also culls clusters that were hidden behind the
+     *  depth of the occluders pyramid (if given); otherwise it is done on
+     *  the CPU, without occlusion.  placement is the part of the model
+     *  matrix that the pyramid wasn't drawn with (a part's place on a
+     *  plate).  Meshes without cluster bounds are never culled. */
+    void cull(const QMatrix4x4& mvp, QOpenGLShaderProgram* cull_shader,
+              bool backfaces=false, const DepthPyramid* occluders=nullptr,
+              const QMatrix4x4& placement=QMatrix4x4());
+
+    /*  Draws the visible clusters.  On the OpenGL 2.1 path, the first
+     *  triangle of each draw call is written to the (int) uniform at
+     *  offset_location, so that shaders can find the triangle index as
+     *  offset + gl_PrimitiveID.  The core path passes it as attribute 1.
+     *  Likewise, curvatures are fed to the attribute at curvature_location
+     *  (if any) on the OpenGL 2.1 path, and always to attribute 2 on the
+     *  core path. */
+    void draw(GLuint vp, GLint offset_location=-1, GLint curvature_location=-1);
+
+    /*  Draws every vertex as a point, for splat rendering */
+    void draw_points(GLuint vp);
+
+    /*  Typical distance between neighbouring vertices in model units,
+     *  estimated from the cluster bounds (0 if there are none) */
+    GLfloat point_spacing() const { return spacing; }
+
+    /*  Face colours are stored in a texture, COLOR_TEXTURE_WIDTH
+     *  triangles per row, since vertices are shared between faces */
+    bool has_colors() const { return color_texture != 0; }
+    void bind_colors();
+    const static GLsizei COLOR_TEXTURE_WIDTH = 4096;
+
+    /*  Mean and Gaussian curvature of each vertex (see curvature.h), if
+     *  the mesh came with them */
+    bool has_curvature() const { return curvature_uploaded; }
+
 private:
+    void create_core(const GLfloat* vertex_data, size_t vertex_count,
+                     const GLuint* index_data, size_t index_count,
+                     const GLfloat* cluster_bounds, bool face_colors,
+                     const GLfloat* cluster_cones, const GLfloat* vertex_curvature);
+    void create_color_texture(const GLuint* face_colors, size_t tri_count);
+    void draw_core();
+
 	QOpenGLBuffer vertices;
 	QOpenGLBuffer indices;
+    QOpenGLBuffer curvature;
+    bool curvature_uploaded;
+
+    // Bounding spheres of clusters (CPU culling), and the index ranges
+    // (first index, count) that survived the last cull
+    std::vector<GLfloat> bounds;
+    std::vector<GLfloat> cones;
+    std::vector<std::pair<GLuint, GLuint>> visible;
+    GLuint total_indices;
+    GLuint total_vertices;
+    GLfloat spacing;
+    GLuint color_texture;
+
+    // Objects for the OpenGL 4.5 core-profile path, which uses direct
+    // state access, immutable buffer storage and multi-draw indirect.
+    // gl45 is null on the default (OpenGL 2.1) path.
+    QOpenGLFunctions_4_5_Core* gl45;
+    GLuint vao;
+    GLuint core_buffers[7]; // vertices, indices, indirect commands, bounds,
+                            // first triangle of each cluster, normal cones,
+                            // vertex curvatures
+    GLsizei cluster_count;
+    bool core_bounds;
+    bool core_cones;
 };
 
 #endif // GLMESH_H
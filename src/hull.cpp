@@ -0,0 +1,767 @@
+#include <algorithm>
+#include <cmath>
+#include <tuple>
+#include <unordered_map>
+
+#include "hull.h"
+#include "parallel.h"
+
+namespace {
+
+struct Vec
+{
+    double x, y, z;
+    Vec operator-(const Vec& o) const { return {x - o.x, y - o.y, z - o.z}; }
+    double dot(const Vec& o) const { return x*o.x + y*o.y + z*o.z; }
+    Vec cross(const Vec& o) const
+    {
+        return {y*o.z - z*o.y, z*o.x - x*o.z, x*o.y - y*o.x};
+    }
+    double length() const { return sqrt(dot(*this)); }
+};
+
+/*  Sequential quickhull over a subset of points, keeping outside points
+ *  in a list per face and adding the furthest one each step.  Faces are
+ *  found across edges through a map of directed edges. */
+class QuickHull
+{
+public:
+    QuickHull(const std::vector<GLfloat>& vertices, double epsilon)
+        : vertices(vertices), epsilon(epsilon) {}
+
+    /*  Returns false if the points are all (nearly) coplanar, or in the
+     *  unlikely event that rounding breaks the hull's topology */
+    bool build(const std::vector<GLuint>& points);
+
+    /*  Points on the hull, and its triangles */
+    std::vector<GLuint> hull_points() const;
+    std::vector<GLuint> hull_triangles() const;
+
+    /*  Outward unit normals and offsets of the hull's faces */
+    std::vector<std::pair<Vec, double>> planes() const;
+
+private:
+    struct Face
+    {
+        GLuint v[3];
+        Vec normal;
+        double offset;
+        std::vector<GLuint> outside;
+        bool alive;
+    };
+
+    Vec point(GLuint i) const
+    {
+        return {vertices[i*3], vertices[i*3 + 1], vertices[i*3 + 2]};
+    }
+    double distance(const Face& f, GLuint i) const
+    {
+        return f.normal.dot(point(i)) - f.offset;
+    }
+    /*  Whether p is in front of the face's own corners.  Float inputs make
+     *  this nearly exact in doubles, which keeps the set of visible faces
+     *  a disc (so the horizon is a simple loop) where a tolerance can't. */
+    bool sees(const Face& f, GLuint p) const
+    {
+        const Vec a = point(f.v[0]);
+        return (point(f.v[1]) - a).cross(point(f.v[2]) - a).dot(point(p) - a) > 0;
+    }
+    static uint64_t key(GLuint a, GLuint b) { return (uint64_t(a) << 32) | b; }
+
+    size_t add_face(GLuint a, GLuint b, GLuint c);
+    void assign(const std::vector<GLuint>& points, const std::vector<size_t>& faces);
+
+    const std::vector<GLfloat>& vertices;
+    const double epsilon;
+    std::vector<Face> faces;
+    std::vector<size_t> unused;     // Slots of dead faces, for reuse
+    std::unordered_map<uint64_t, size_t> edges;
+};
+
+size_t QuickHull::add_face(GLuint a, GLuint b, GLuint c)
+{
+    Face f;
+    f.v[0] = a;
+    f.v[1] = b;
+    f.v[2] = c;
+    f.normal = (point(b) - point(a)).cross(point(c) - point(a));
+    // Sliver faces get a zero normal, so that nothing is ever outside them
+    const double length = f.normal.length();
+    const double scale = length > 0 ? 1 / length : 0;
+    f.normal = {f.normal.x * scale, f.normal.y * scale, f.normal.z * scale};
+    f.offset = f.normal.dot(point(a));
+    f.alive = true;
+
+    size_t i = faces.size();
+    if (unused.empty())
+    {
+        faces.push_back(std::move(f));
+    }
+    else
+    {
+        i = unused.back();
+        unused.pop_back();
+        faces[i] = std::move(f);
+    }
+    edges[key(a, b)] = i;
+    edges[key(b, c)] = i;
+    edges[key(c, a)] = i;
+    return i;
+}
+
+void QuickHull::assign(const std::vector<GLuint>& points,
+                       const std::vector<size_t>& candidates)
+{
+    // Each point goes to the first face that it is outside, or is
+    // dropped if it is inside all of them
+    for (GLuint p : points)
+    {
+        for (size_t f : candidates)
+        {
+            if (distance(faces[f], p) > epsilon)
+            {
+                faces[f].outside.push_back(p);
+                break;
+            }
+        }
+    }
+}
+
+bool QuickHull::build(const std::vector<GLuint>& points)
+{
+    faces.clear();
+    unused.clear();
+    edges.clear();
+    if (points.size() < 4)
+    {
+        return false;
+    }
+
+    // Start from a tetrahedron of extreme points
+    GLuint extremes[6];
+    std::fill(extremes, extremes + 6, points[0]);
+    for (GLuint p : points)
+    {
+        for (int j=0; j < 3; ++j)
+        {
+            if (vertices[p*3 + j] < vertices[extremes[j*2]*3 + j])      extremes[j*2] = p;
+            if (vertices[p*3 + j] > vertices[extremes[j*2 + 1]*3 + j])  extremes[j*2 + 1] = p;
+        }
+    }
+    GLuint a = extremes[0], b = extremes[1];
+    for (int i=0; i < 6; ++i)
+    {
+        for (int j=i + 1; j < 6; ++j)
+        {
+            if ((point(extremes[i]) - point(extremes[j])).length() >
+                (point(a) - point(b)).length())
+            {
+                a = extremes[i];
+                b = extremes[j];
+            }
+        }
+    }
+    const Vec ab = point(b) - point(a);
+    GLuint c = a;
+    double best = epsilon;
+    for (GLuint p : points)
+    {
+        const double d = ab.cross(point(p) - point(a)).length() / ab.length();
+        if (d > best)
+        {
+            best = d;
+            c = p;
+        }
+    }
+    if (c == a)
+    {
+        return false;
+    }
+    const Vec normal = ab.cross(point(c) - point(a));
+    const double scale = normal.length();
+    GLuint d = a;
+    best = epsilon;
+    for (GLuint p : points)
+    {
+        const double dist = fabs(normal.dot(point(p) - point(a))) / scale;
+        if (dist > best)
+        {
+            best = dist;
+            d = p;
+        }
+    }
+    if (d == a)
+    {
+        return false;
+    }
+
+    // Wind the faces so that their normals point away from d
+    if (normal.dot(point(d) - point(a)) > 0)
+    {
+        std::swap(b, c);
+    }
+    std::vector<size_t> initial = {add_face(a, b, c), add_face(a, d, b),
+                                   add_face(b, d, c), add_face(c, d, a)};
+    assign(points, initial);
+
+    std::vector<size_t> pending = initial;
+    std::vector<size_t> visible, created;
+    std::vector<GLuint> orphans;
+    std::vector<std::pair<GLuint, GLuint>> horizon;
+    while (!pending.empty())
+    {
+        const size_t start = pending.back();
+        if (!faces[start].alive || faces[start].outside.empty())
+        {
+            pending.pop_back();
+            continue;
+        }
+
+        // The furthest outside point becomes a hull vertex
+        const auto& outside = faces[start].outside;
+        const GLuint eye = *std::max_element(outside.begin(), outside.end(),
+            [&](GLuint p, GLuint q)
+            {
+                return distance(faces[start], p) < distance(faces[start], q);
+            });
+
+        // Flood out over the faces that the eye can see; the edges between
+        // them and the rest form the horizon.
+        visible = {start};
+        faces[start].alive = false;
+        horizon.clear();
+        for (size_t i=0; i < visible.size(); ++i)
+        {
+            const Face& f = faces[visible[i]];
+            for (int k=0; k < 3; ++k)
+            {
+                const GLuint u = f.v[k];
+                const GLuint v = f.v[(k + 1) % 3];
+                const auto found = edges.find(key(v, u));
+                if (found == edges.end())
+                {
+                    return false;
+                }
+                const size_t n = found->second;
+                if (!faces[n].alive)
+                {
+                    continue;
+                }
+                if (sees(faces[n], eye))
+                {
+                    faces[n].alive = false;
+                    visible.push_back(n);
+                }
+                else
+                {
+                    horizon.push_back({u, v});
+                }
+            }
+        }
+
+        // Visible faces are replaced by a cone of new faces from the
+        // horizon to the eye, and their outside points are handed on
+        orphans.clear();
+        for (size_t f : visible)
+        {
+            for (GLuint p : faces[f].outside)
+            {
+                if (p != eye)
+                {
+                    orphans.push_back(p);
+                }
+            }
+            std::vector<GLuint>().swap(faces[f].outside);
+            for (int k=0; k < 3; ++k)
+            {
+                edges.erase(key(faces[f].v[k], faces[f].v[(k + 1) % 3]));
+            }
+        }
+        unused.insert(unused.end(), visible.begin(), visible.end());
+
+        created.clear();
+        for (const auto& e : horizon)
+        {
+            created.push_back(add_face(e.first, e.second, eye));
+        }
+        assign(orphans, created);
+        pending.insert(pending.end(), created.begin(), created.end());
+    }
+    return true;
+}
+
+std::vector<GLuint> QuickHull::hull_points() const
+{
+    std::vector<GLuint> out;
+    for (const auto& f : faces)
+    {
+        if (f.alive)
+        {
+            out.insert(out.end(), f.v, f.v + 3);
+        }
+    }
+    std::sort(out.begin(), out.end());
+    out.erase(std::unique(out.begin(), out.end()), out.end());
+    return out;
+}
+
+std::vector<GLuint> QuickHull::hull_triangles() const
+{
+    std::vector<GLuint> out;
+    for (const auto& f : faces)
+    {
+        if (f.alive)
+        {
+            out.insert(out.end(), f.v, f.v + 3);
+        }
+    }
+    return out;
+}
+
+std::vector<std::pair<Vec, double>> QuickHull::planes() const
+{
+    std::vector<std::pair<Vec, double>> out;
+    for (const auto& f : faces)
+    {
+        if (f.alive)
+        {
+            out.push_back({f.normal, f.offset});
+        }
+    }
+    return out;
+}
+
+}   // anonymous namespace
+
+////////////////////////////////////////////////////////////////////////////////
+
+std::vector<GLuint> convex_hull(const std::vector<GLfloat>& vertices)
+{
+    const size_t count = vertices.size() / 3;
+    if (count < 4)
+    {
+        return {};
+    }
+
+    // Tolerance relative to the size of the point set
+    const unsigned workers = worker_count();
+    std::vector<QVector3D> lowers(workers, QVector3D(INFINITY, INFINITY, INFINITY));
+    std::vector<QVector3D> uppers(workers, -lowers[0]);
+    parallel_for(count, [&](size_t begin, size_t end, size_t w)
+    {
+        for (size_t i=begin; i < end; ++i)
+        {
+            for (int j=0; j < 3; ++j)
+            {
+                lowers[w][j] = fmin(lowers[w][j], vertices[i*3 + j]);
+                uppers[w][j] = fmax(uppers[w][j], vertices[i*3 + j]);
+            }
+        }
+    });
+    double extent = 0;
+    for (int j=0; j < 3; ++j)
+    {
+        float lo = INFINITY, hi = -INFINITY;
+        for (unsigned w=0; w < workers; ++w)
+        {
+            lo = fmin(lo, lowers[w][j]);
+            hi = fmax(hi, uppers[w][j]);
+        }
+        extent = std::max(extent, double(hi) - lo);
+    }
+    const double epsilon = extent * 1e-7;
+
+    // Points inside the hull of the extremes along a few directions can't
+    // be on the hull, and dropping them in one streaming pass is far
+    // cheaper than sorting them into quickhull's outside lists
+    static const int DIRECTIONS = 13;
+    static const double AXES[DIRECTIONS][3] = {
+        {1, 0, 0}, {0, 1, 0}, {0, 0, 1},
+        {1, 1, 0}, {1, -1, 0}, {1, 0, 1}, {1, 0, -1}, {0, 1, 1}, {0, 1, -1},
+        {1, 1, 1}, {1, 1, -1}, {1, -1, 1}, {1, -1, -1}};
+    std::vector<GLuint> extremes(workers * DIRECTIONS * 2, 0);
+    parallel_for(count, [&](size_t begin, size_t end, size_t w)
+    {
+        GLuint* out = &extremes[w * DIRECTIONS * 2];
+        double lo[DIRECTIONS], hi[DIRECTIONS];
+        std::fill(lo, lo + DIRECTIONS, INFINITY);
+        std::fill(hi, hi + DIRECTIONS, -INFINITY);
+        for (size_t i=begin; i < end; ++i)
+        {
+            for (int d=0; d < DIRECTIONS; ++d)
+            {
+                const double t = AXES[d][0] * vertices[i*3] +
+                                 AXES[d][1] * vertices[i*3 + 1] +
+                                 AXES[d][2] * vertices[i*3 + 2];
+                if (t < lo[d])
+                {
+                    lo[d] = t;
+                    out[d*2] = i;
+                }
+                if (t > hi[d])
+                {
+                    hi[d] = t;
+                    out[d*2 + 1] = i;
+                }
+            }
+        }
+    });
+    std::sort(extremes.begin(), extremes.end());
+    extremes.erase(std::unique(extremes.begin(), extremes.end()), extremes.end());
+    QuickHull filter(vertices, epsilon);
+    std::vector<std::pair<Vec, double>> planes;
+    if (filter.build(extremes))
+    {
+        planes = filter.planes();
+    }
+
+    // Each worker finds the hull of its share of the points, and the hull
+    // of their hulls is the hull of everything.  Most points are inside
+    // their share's hull, so the final pass sees few of them.  With only
+    // one share, the final pass does the whole job.
+    std::vector<std::vector<GLuint>> partial(workers);
+    parallel_for(count, [&](size_t begin, size_t end, size_t w)
+    {
+        std::vector<GLuint> points;
+        for (size_t i=begin; i < end; ++i)
+        {
+            const Vec p = {vertices[i*3], vertices[i*3 + 1], vertices[i*3 + 2]};
+            bool outside = planes.empty();
+            for (size_t j=0; j < planes.size() && !outside; ++j)
+            {
+                outside = planes[j].first.dot(p) - planes[j].second > -epsilon;
+            }
+            if (outside)
+            {
+                points.push_back(i);
+            }
+        }
+        QuickHull hull(vertices, epsilon);
+        if (workers > 1 && hull.build(points))
+        {
+            points = hull.hull_points();
+        }
+        partial[w].swap(points);
+    });
+
+    std::vector<GLuint> merged;
+    for (const auto& p : partial)
+    {
+        merged.insert(merged.end(), p.begin(), p.end());
+    }
+    QuickHull hull(vertices, epsilon);
+    return hull.build(merged) ? hull.hull_triangles() : std::vector<GLuint>();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+void OrientedBox::corners(QVector3D* out) const
+{
+    for (int i=0; i < 8; ++i)
+    {
+        QVector3D c = center;
+        for (int j=0; j < 3; ++j)
+        {
+            c += axes[j] * size[j] * ((i & (1 << j)) ? 0.5f : -0.5f);
+        }
+        out[i] = c;
+    }
+}
+
+/*  Smallest rectangle around a set of 2D points, by rotating calipers
+ *  over their convex hull.  Returns the area, and sets the rectangle's
+ *  direction (along one side), its extents along that direction and the
+ *  one perpendicular to it. */
+static double min_rectangle(std::vector<std::pair<double, double>>& points,
+                            double* dir_x, double* dir_y, double lo[2], double hi[2])
+{
+    // Andrew's monotone chain, giving the hull counter-clockwise
+    std::sort(points.begin(), points.end());
+    points.erase(std::unique(points.begin(), points.end()), points.end());
+    auto cross = [](const std::pair<double, double>& o,
+                    const std::pair<double, double>& a,
+                    const std::pair<double, double>& b)
+    {
+        return (a.first - o.first) * (b.second - o.second) -
+               (a.second - o.second) * (b.first - o.first);
+    };
+    std::vector<std::pair<double, double>> hull(2 * points.size());
+    size_t k = 0;
+    for (size_t i=0; i < points.size(); ++i)
+    {
+        while (k >= 2 && cross(hull[k - 2], hull[k - 1], points[i]) <= 0) k--;
+        hull[k++] = points[i];
+    }
+    for (size_t i=points.size() - 1, t=k + 1; i > 0; --i)
+    {
+        while (k >= t && cross(hull[k - 2], hull[k - 1], points[i - 1]) <= 0) k--;
+        hull[k++] = points[i - 1];
+    }
+    hull.resize(k > 1 ? k - 1 : k);
+    const size_t n = hull.size();
+
+    double best = INFINITY;
+    *dir_x = 1;
+    *dir_y = 0;
+    lo[0] = lo[1] = hi[0] = hi[1] = 0;
+    if (n < 3)
+    {
+        return 0;
+    }
+
+    // For each edge direction, the calipers on the other three sides only
+    // ever move forwards around the hull
+    auto along = [&](size_t i, double ux, double uy)
+    {
+        return hull[i % n].first * ux + hull[i % n].second * uy;
+    };
+    size_t right = 0, top = 0, left = 0;
+    for (size_t i=0; i < n; ++i)
+    {
+        double ux = hull[(i + 1) % n].first - hull[i].first;
+        double uy = hull[(i + 1) % n].second - hull[i].second;
+        const double length = sqrt(ux*ux + uy*uy);
+        if (length == 0)
+        {
+            continue;
+        }
+        ux /= length;
+        uy /= length;
+        const double vx = -uy, vy = ux;
+
+        right = std::max(right, i);
+        while (along(right + 1, ux, uy) > along(right, ux, uy)) right++;
+        top = std::max(top, right);
+        while (along(top + 1, vx, vy) > along(top, vx, vy)) top++;
+        left = std::max(left, top);
+        while (along(left + 1, ux, uy) < along(left, ux, uy)) left++;
+
+        const double min_u = along(left, ux, uy);
+        const double max_u = along(right, ux, uy);
+        const double min_v = along(i, vx, vy);
+        const double max_v = along(top, vx, vy);
+        const double area = (max_u - min_u) * (max_v - min_v);
+        if (area < best)
+        {
+            best = area;
+            *dir_x = ux;
+            *dir_y = uy;
+            lo[0] = min_u;
+            hi[0] = max_u;
+            lo[1] = min_v;
+            hi[1] = max_v;
+        }
+    }
+    return best;
+}
+
+/*  Sorts candidate box axes, merging those that point the same way (in
+ *  either sense, since they give the same box) and adding their weights,
+ *  then keeps the heaviest if there are more than limit.  Only hull faces
+ *  that are exactly coplanar merge, and there are few of them, so a huge
+ *  list is first cut down to its heaviest entries rather than sorted. */
+static void merge_directions(std::vector<std::pair<QVector3D, float>>& dirs,
+                             size_t limit)
+{
+    auto heavier = [](const std::pair<QVector3D, float>& a,
+                      const std::pair<QVector3D, float>& b)
+    {
+        return a.second > b.second;
+    };
+    if (dirs.size() / 8 > limit)
+    {
+        std::nth_element(dirs.begin(), dirs.begin() + limit * 8, dirs.end(), heavier);
+        dirs.resize(limit * 8);
+    }
+    for (auto& d : dirs)
+    {
+        const QVector3D& v = d.first;
+        if (v.x() < 0 || (v.x() == 0 && (v.y() < 0 || (v.y() == 0 && v.z() < 0))))
+        {
+            d.first = -v;
+        }
+    }
+    std::sort(dirs.begin(), dirs.end(),
+        [](const std::pair<QVector3D, float>& a, const std::pair<QVector3D, float>& b)
+        {
+            return std::make_tuple(a.first.x(), a.first.y(), a.first.z()) <
+                   std::make_tuple(b.first.x(), b.first.y(), b.first.z());
+        });
+    size_t merged = 0;
+    for (size_t i=0; i < dirs.size(); ++i)
+    {
+        if (merged && QVector3D::dotProduct(dirs[merged - 1].first,
+                                            dirs[i].first) > 1 - 1e-6f)
+        {
+            dirs[merged - 1].second += dirs[i].second;
+        }
+        else
+        {
+            dirs[merged++] = dirs[i];
+        }
+    }
+    dirs.resize(merged);
+    if (dirs.size() > limit)
+    {
+        std::partial_sort(dirs.begin(), dirs.begin() + limit, dirs.end(), heavier);
+        dirs.resize(limit);
+    }
+}
+
+// Past these sizes, the search tries the largest faces' normals, the
+// longest edges' directions and the cross products of the PAIRED_EDGES
+// longest edges, and fits the rectangles to an even sample of the hull's
+// corners.  The final box is still sized to hold every corner.
+static const size_t MAX_DIRECTIONS = 256;
+static const size_t PAIRED_EDGES = 24;
+static const size_t MAX_CORNERS = 4096;
+
+OrientedBox min_oriented_box(const std::vector<GLfloat>& vertices,
+                             const std::vector<GLuint>& hull)
+{
+    auto point = [&](GLuint i)
+    {
+        return QVector3D(vertices[i*3], vertices[i*3 + 1], vertices[i*3 + 2]);
+    };
+
+    OrientedBox box;
+    box.axes[0] = QVector3D(1, 0, 0);
+    box.axes[1] = QVector3D(0, 1, 0);
+    box.axes[2] = QVector3D(0, 0, 1);
+
+    // Only the hull's corners matter
+    std::vector<GLuint> corners(hull);
+    std::sort(corners.begin(), corners.end());
+    corners.erase(std::unique(corners.begin(), corners.end()), corners.end());
+
+    // Each candidate is the box's third axis, with the other two found by
+    // rotating calipers in the plane across it.  Face normals give boxes
+    // flush with a hull face, and edge directions boxes with a hull edge
+    // along one of their own.  Each edge is shared by two triangles, which
+    // walk it in opposite directions, so it is taken once from a < b.
+    std::vector<std::pair<QVector3D, float>> normals;
+    std::vector<std::pair<QVector3D, float>> edges;
+    for (size_t t=0; t < hull.size(); t += 3)
+    {
+        const QVector3D a = point(hull[t]);
+        const QVector3D cross = QVector3D::crossProduct(point(hull[t + 1]) - a,
+                                                        point(hull[t + 2]) - a);
+        const float area = cross.length();
+        if (area > 0)
+        {
+            normals.push_back({cross / area, area});
+        }
+        for (int j=0; j < 3; ++j)
+        {
+            const GLuint from = hull[t + j];
+            const GLuint to = hull[t + (j + 1) % 3];
+            const QVector3D edge = point(to) - point(from);
+            const float length = edge.length();
+            if (from < to && length > 0)
+            {
+                edges.push_back({edge / length, length});
+            }
+        }
+    }
+    merge_directions(normals, MAX_DIRECTIONS);
+    merge_directions(edges, MAX_DIRECTIONS);
+
+    // A box can also touch the hull only along edges, with no face or edge
+    // parallel to its own (as around a regular tetrahedron), so the axes
+    // across pairs of long edges are tried too
+    std::vector<std::pair<QVector3D, float>> directions(normals);
+    directions.insert(directions.end(), edges.begin(), edges.end());
+    std::partial_sort(edges.begin(),
+                      edges.begin() + std::min(edges.size(), PAIRED_EDGES),
+                      edges.end(),
+        [](const std::pair<QVector3D, float>& a, const std::pair<QVector3D, float>& b)
+        {
+            return a.second > b.second;
+        });
+    for (size_t i=0; i < edges.size() && i < PAIRED_EDGES; ++i)
+    {
+        for (size_t j=0; j < i; ++j)
+        {
+            const QVector3D cross = QVector3D::crossProduct(edges[i].first,
+                                                            edges[j].first);
+            const float length = cross.length();
+            if (length > 1e-3f)
+            {
+                directions.push_back({cross / length, 0});
+            }
+        }
+    }
+    merge_directions(directions, directions.size());
+
+    std::vector<GLuint> sample;
+    const size_t stride = (corners.size() + MAX_CORNERS - 1) / MAX_CORNERS;
+    for (size_t c=0; c < corners.size(); c += stride)
+    {
+        sample.push_back(corners[c]);
+    }
+
+    // Each worker keeps the axes of the smallest box that it has found
+    const unsigned workers = worker_count();
+    std::vector<double> best(workers, INFINITY);
+    std::vector<OrientedBox> boxes(workers, box);
+    parallel_for(directions.size(), [&](size_t begin, size_t end, size_t w)
+    {
+        std::vector<std::pair<double, double>> flat;
+        for (size_t i=begin; i < end; ++i)
+        {
+            const QVector3D n = directions[i].first;
+            const QVector3D seed = fabs(n.x()) < 0.9f ? QVector3D(1, 0, 0)
+                                                      : QVector3D(0, 1, 0);
+            const QVector3D u = QVector3D::crossProduct(seed, n).normalized();
+            const QVector3D v = QVector3D::crossProduct(n, u);
+
+            flat.resize(sample.size());
+            double depth_lo = INFINITY, depth_hi = -INFINITY;
+            for (size_t c=0; c < sample.size(); ++c)
+            {
+                const QVector3D p = point(sample[c]);
+                flat[c] = {QVector3D::dotProduct(p, u), QVector3D::dotProduct(p, v)};
+                const double d = QVector3D::dotProduct(p, n);
+                depth_lo = std::min(depth_lo, d);
+                depth_hi = std::max(depth_hi, d);
+            }
+
+            double dx, dy, lo[2], hi[2];
+            const double volume = min_rectangle(flat, &dx, &dy, lo, hi) *
+                                  (depth_hi - depth_lo);
+            if (volume < best[w])
+            {
+                best[w] = volume;
+                boxes[w].axes[0] = (u * dx + v * dy).normalized();
+                boxes[w].axes[1] = (v * dx - u * dy).normalized();
+                boxes[w].axes[2] = n;
+            }
+        }
+    });
+    if (!directions.empty())
+    {
+        box = boxes[std::min_element(best.begin(), best.end()) - best.begin()];
+    }
+
+    // Size the box along its axes, over every vertex if there's no hull
+    const size_t count = corners.empty() ? vertices.size() / 3 : corners.size();
+    QVector3D lo(INFINITY, INFINITY, INFINITY);
+    QVector3D hi = -lo;
+    for (size_t i=0; i < count; ++i)
+    {
+        const QVector3D p = point(corners.empty() ? i : corners[i]);
+        for (int j=0; j < 3; ++j)
+        {
+            const float d = QVector3D::dotProduct(p, box.axes[j]);
+            lo[j] = fmin(lo[j], d);
+            hi[j] = fmax(hi[j], d);
+        }
+    }
+    box.size = hi - lo;
+    box.center = QVector3D();
+    for (int j=0; j < 3; ++j)
+    {
+        box.center += box.axes[j] * ((lo[j] + hi[j]) / 2);
+    }
+    return box;
+}
@@ -0,0 +1,37 @@
+#ifndef HULL_H
+#define HULL_H
+
+#include <QVector3D>
+#include <QtOpenGL/QtOpenGL>
+
+#include <vector>
+
+/*  Convex hull of a point set, as outward-facing triangles whose corners
+ *  index the input points.  Empty if the points are all coplanar. */
+std::vector<GLuint> convex_hull(const std::vector<GLfloat>& vertices);
+
+/*  A box with edges along three orthonormal axes */
+struct OrientedBox
+{
+    QVector3D center;
+    QVector3D axes[3];
+    QVector3D size;         // Full length along each axis
+
+    float volume() const { return size.x() * size.y() * size.z(); }
+
+    /*  Writes the eight corners, indexed by bit i choosing the high end
+     *  of axis i */
+    void corners(QVector3D* out) const;
+};
+
+/*  Finds a small oriented box around the points, searching directions
+ *  from their convex hull (given as from convex_hull) in parallel: face
+ *  normals, edge directions and the cross products of pairs of long
+ *  edges.  Each direction is one axis of a box, and rotating calipers
+ *  find the smallest rectangle around the hull's shadow across it.  Large
+ *  hulls are searched approximately (see MAX_DIRECTIONS in hull.cpp).
+ *  Falls back to the axis-aligned box if the hull is empty. */
+OrientedBox min_oriented_box(const std::vector<GLfloat>& vertices,
+                             const std::vector<GLuint>& hull);
+
+#endif // HULL_H
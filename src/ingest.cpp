@@ -0,0 +1,256 @@
+#include <QLocalServer>
+#include <QLocalSocket>
+
+#include <atomic>
+#include <cstring>
+
+#ifdef Q_OS_UNIX
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "ingest.h"
+
+const uint32_t Ingest::MAGIC;
+
+#ifdef Q_OS_UNIX
+namespace {
+
+// Touching a page of the mapping past the end of a segment that the
+// producer has shrunk raises SIGBUS.  While a frame is being read, a
+// fault inside the mapping replaces it with zero pages, so the read
+// finishes, and the frame is then dropped.  Other faults crash as usual.
+std::atomic<const uint8_t*> guarded_data(nullptr);
+std::atomic<size_t> guarded_size(0);
+volatile sig_atomic_t guard_tripped = 0;
+struct sigaction previous_sigbus;
+
+void on_sigbus(int sig, siginfo_t* info, void*)
+{
+    const uint8_t* base = guarded_data.load();
+    const size_t n = guarded_size.load();
+    const uint8_t* addr = static_cast<const uint8_t*>(info->si_addr);
+    if (base && addr >= base && addr < base + n &&
+        mmap(const_cast<uint8_t*>(base), n, PROT_READ,
+             MAP_FIXED | MAP_PRIVATE | MAP_ANONYMOUS, -1, 0) != MAP_FAILED)
+    {
+        guard_tripped = 1;
+        return;
+    }
+
+    // Not ours: fall back to the previous handler, which runs when the
+    // faulting instruction is retried
+    sigaction(sig, &previous_sigbus, nullptr);
+}
+
+void install_sigbus_guard()
+{
+    static bool installed = false;
+    if (!installed)
+    {
+        struct sigaction action;
+        memset(&action, 0, sizeof(action));
+        action.sa_sigaction = on_sigbus;
+        action.sa_flags = SA_SIGINFO | SA_NODEFER;
+        sigemptyset(&action.sa_mask);
+        sigaction(SIGBUS, &action, &previous_sigbus);
+        installed = true;
+    }
+}
+
+}   // anonymous namespace
+#endif
+
+Ingest::Ingest(QObject* parent, const QString& name)
+    : QObject(parent), ingest_name(name), server(new QLocalServer(this)),
+      fd(-1), data(nullptr), size(0)
+{
+    connect(server, &QLocalServer::newConnection,
+            this, &Ingest::on_connection);
+}
+
+Ingest::~Ingest()
+{
+    unmap_segment();
+#ifdef Q_OS_UNIX
+    if (fd >= 0)
+    {
+        close(fd);
+    }
+#endif
+}
+
+bool Ingest::start()
+{
+#ifdef Q_OS_UNIX
+    // Clean up a socket left behind by a previous instance that crashed
+    QLocalServer::removeServer(ingest_name);
+    if (!server->listen(ingest_name))
+    {
+        emit error(server->errorString());
+        return false;
+    }
+    return true;
+#else
+    emit error("Shared-memory ingest is only supported on Unix-like systems.");
+    return false;
+#endif
+}
+
+void Ingest::on_connection()
+{
+    while (QLocalSocket* socket = server->nextPendingConnection())
+    {
+        // The content of a notification doesn't matter; the header says
+        // which slot to show, so bursts of notifications collapse into
+        // a single upload of the latest frame.
+        connect(socket, &QLocalSocket::readyRead, this, [=]()
+        {
+            socket->readAll();
+            emit frame_ready(this);
+        });
+        connect(socket, &QLocalSocket::disconnected,
+                socket, &QLocalSocket::deleteLater);
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+bool Ingest::map_segment()
+{
+#ifdef Q_OS_UNIX
+    // The segment is opened lazily, so the producer may start after us
+    if (fd < 0)
+    {
+        fd = shm_open(("/" + ingest_name).toLocal8Bit().constData(),
+                      O_RDONLY, 0);
+        if (fd < 0)
+        {
+            return false;
+        }
+    }
+
+    // Check the size on every read, and remap if the producer has resized
+    // the segment (or a fault replaced the mapping with zero pages)
+    struct stat st;
+    if (fstat(fd, &st) != 0)
+    {
+        return false;
+    }
+    if (data && size == size_t(st.st_size) && !guard_tripped)
+    {
+        return true;
+    }
+
+    unmap_segment();
+    if (size_t(st.st_size) < sizeof(IngestHeader))
+    {
+        return false;
+    }
+    void* p = mmap(nullptr, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    if (p == MAP_FAILED)
+    {
+        return false;
+    }
+    data = static_cast<const uint8_t*>(p);
+    size = st.st_size;
+    guard_tripped = 0;
+    install_sigbus_guard();
+    return true;
+#else
+    return false;
+#endif
+}
+
+void Ingest::unmap_segment()
+{
+#ifdef Q_OS_UNIX
+    if (data)
+    {
+        if (guarded_data.load() == data)
+        {
+            guarded_data.store(nullptr);
+        }
+        munmap(const_cast<uint8_t*>(data), size);
+    }
+#endif
+    data = nullptr;
+    size = 0;
+}
+
+bool Ingest::begin_read(Frame& frame)
+{
+    if (!map_segment())
+    {
+        return false;
+    }
+#ifdef Q_OS_UNIX
+    guarded_size.store(size);
+    guarded_data.store(data);
+#endif
+
+    // The producer writes concurrently, so every header field is read once
+    // through a volatile pointer and then validated.
+    auto header = reinterpret_cast<const volatile IngestHeader*>(data);
+    const uint32_t front = header->front;
+    if (header->magic != MAGIC || front > 1)
+    {
+        return false;
+    }
+
+    const volatile IngestHeader::Slot& slot = header->slots[front];
+    frame.slot = front;
+    frame.generation = slot.generation;
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (frame.generation & 1)
+    {
+        return false; // The producer is still writing this slot
+    }
+
+    frame.vertex_count = slot.vertex_count;
+    frame.index_count = slot.index_count;
+    const uint64_t offset = slot.offset;
+    const uint64_t vertex_bytes = uint64_t(frame.vertex_count) * 3 * sizeof(GLfloat);
+    const uint64_t index_bytes = uint64_t(frame.index_count) * sizeof(GLuint);
+    if (frame.vertex_count == 0 || frame.index_count % 3 ||
+        offset < sizeof(IngestHeader) || offset % sizeof(GLfloat) ||
+        offset > size || vertex_bytes + index_bytes > size - offset)
+    {
+        return false;
+    }
+
+    frame.vertices = reinterpret_cast<const GLfloat*>(data + offset);
+
+    // Out-of-range indices would make the GPU read past the vertex buffer,
+    // so they are checked (and then uploaded) from a private copy
+    frame.indices.resize(frame.index_count);
+    memcpy(frame.indices.data(), data + offset + vertex_bytes, index_bytes);
+    for (uint32_t i=0; i < frame.index_count; ++i)
+    {
+        if (frame.indices[i] >= frame.vertex_count)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool Ingest::end_read(const Frame& frame)
+{
+    std::atomic_thread_fence(std::memory_order_acquire);
+    auto header = reinterpret_cast<const volatile IngestHeader*>(data);
+    bool ok = header->slots[frame.slot].generation == frame.generation;
+#ifdef Q_OS_UNIX
+    guarded_data.store(nullptr);
+    if (guard_tripped)
+    {
+        // The segment shrank under us; remap it on the next read
+        unmap_segment();
+        ok = false;
+    }
+#endif
+    return ok;
+}
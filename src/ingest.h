@@ -0,0 +1,100 @@
+#ifndef INGEST_H
+#define INGEST_H
+
+#include <QObject>
+#include <QtOpenGL/QtOpenGL>
+
+#include <cstdint>
+#include <vector>
+
+class QLocalServer;
+
+/*
+ *  Layout of the shared-memory segment used for live mesh ingest.
+ *
+ *  The segment starts with this header, followed by the data for two
+ *  slots.  Each slot holds vertex_count xyz float triples, immediately
+ *  followed by index_count uint32 indices (three per triangle).
+ *
+ *  A producer writes into the slot that isn't front, then makes it
+ *  front and writes any byte to the notification socket.  While writing
+ *  a slot, the producer keeps its generation odd (incrementing it before
+ *  and after the write); this lets the viewer detect and drop a frame
+ *  that was overwritten while being uploaded, so updates never tear.
+ *  If the producer shrinks the segment while the viewer is reading it,
+ *  the frame is dropped too (rather than the viewer crashing).
+ */
+struct IngestHeader
+{
+    uint32_t magic;     // Must be Ingest::MAGIC
+    uint32_t front;     // Slot (0 or 1) that is ready to be displayed
+    struct Slot
+    {
+        uint64_t generation;    // Odd while the producer is writing
+        uint64_t offset;        // Byte offset of the slot's data
+        uint32_t vertex_count;
+        uint32_t index_count;
+    } slots[2];
+};
+
+/*
+ *  Receives meshes pushed by another process through a POSIX shared
+ *  memory segment ("/<name>") and a local socket notification ("<name>").
+ */
+class Ingest : public QObject
+{
+    Q_OBJECT
+public:
+    explicit Ingest(QObject* parent, const QString& name);
+    ~Ingest();
+
+    /*  Maps the segment and starts listening for notifications */
+    bool start();
+
+    /*  A slot of the mapped segment.  Vertices are read in place, but
+     *  indices are copied out before they are checked, so that the
+     *  producer can't change them between the check and the upload. */
+    struct Frame
+    {
+        const GLfloat* vertices;
+        uint32_t vertex_count;
+        std::vector<GLuint> indices;
+        uint32_t index_count;
+
+        int slot;
+        uint64_t generation;
+    };
+
+    /*  Finds the front slot and checks that it is complete and in range.
+     *  The vertex pointer stays valid until end_read is called. */
+    bool begin_read(Frame& frame);
+
+    /*  Returns false if the producer touched the slot (or shrank the
+     *  segment) while it was being read, in which case anything read from
+     *  it must be discarded. */
+    bool end_read(const Frame& frame);
+
+    const QString& name() const { return ingest_name; }
+
+    const static uint32_t MAGIC = 0x4c545346; // "FSTL", little-endian
+
+signals:
+    void frame_ready(Ingest* ingest);
+    void error(const QString& message);
+
+private slots:
+    void on_connection();
+
+private:
+    bool map_segment();
+    void unmap_segment();
+
+    const QString ingest_name;
+    QLocalServer* server;
+
+    int fd;
+    const uint8_t* data;
+    size_t size;
+};
+
+#endif // INGEST_H
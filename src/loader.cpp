@@ -1,19 +1,129 @@
+#include <algorithm>
 #include <future>
+#include <limits>
+
+#include <QElapsedTimer>
+#include <QFileInfo>
 
 #include "loader.h"
+#include "recent.h"
 #include "vertex.h"
+#include "voxel.h"
+#include "profile.h"
+
+const uint32_t Loader::STREAM_CHUNK_TRIANGLES;
+const int Loader::STREAM_UPDATE_MS;
 
-Loader::Loader(QObject* parent, const QString& filename, bool is_reload)
-    : QThread(parent), filename(filename), is_reload(is_reload)
+Loader::Loader(QObject* parent, const QString& filename, bool is_reload,
+               bool facet_normals, int repairs)
+    : QThread(parent), filename(filename), is_reload(is_reload),
+      facet_normals(facet_normals), repairs(repairs),
+      voxel_resolution(0), voxel_band(0), oriented_box(false),
+      print_orientation(false), curvature(false), quality(false), summary(false),
+      unchanged_fingerprint(0),
+      emitted_partial(false)
 {
     // Nothing to do here
 }
 
+Mesh* Loader::load_now(const QString& filename, QString* error)
+{
+    Loader loader(nullptr, filename, false);
+    Mesh* mesh = nullptr;
+
+    // Streams emit partial meshes first, so keep only the last one
+    QObject::connect(&loader, &Loader::got_mesh, [&](Mesh* m, bool)
+    {
+        delete mesh;
+        mesh = m;
+    });
+    QObject::connect(&loader, &Loader::error_bad_stl,
+                     [&]() { *error = filename + " is not a valid .stl file"; });
+    QObject::connect(&loader, &Loader::error_empty_mesh,
+                     [&]() { *error = filename + " is empty"; });
+    QObject::connect(&loader, &Loader::error_missing_file,
+                     [&]() { *error = "Could not open " + filename; });
+
+    // Run the job directly, rather than start()ing the thread
+    loader.run();
+    if (!error->isEmpty())
+    {
+        delete mesh;
+        mesh = nullptr;
+    }
+    return mesh;
+}
+
+void Loader::set_voxelize(int resolution, int band)
+{
+    voxel_resolution = resolution;
+    voxel_band = band;
+}
+
+void Loader::set_oriented_box(bool b)
+{
+    oriented_box = b;
+}
+
+void Loader::set_print_orientation(bool b)
+{
+    print_orientation = b;
+}
+
+void Loader::set_curvature(bool b)
+{
+    curvature = b;
+}
+
+void Loader::set_quality(bool b)
+{
+    quality = b;
+}
+
+void Loader::set_summary(bool b)
+{
+    summary = b;
+}
+
+void Loader::set_unchanged_fingerprint(quint64 f)
+{
+    unchanged_fingerprint = f;
+}
+
+bool Loader::is_unchanged() const
+{
+    return unchanged_fingerprint && content_hash.result() == unchanged_fingerprint;
+}
+
+FileSummary* Loader::summarize(const Mesh* mesh) const
+{
+    const QFileInfo info(filename);
+    FileSummary* s = new FileSummary;
+    s->path = info.absoluteFilePath();
+    s->size = info.size();
+    s->loaded = QDateTime::currentDateTime();
+    s->triangles = mesh->triCount();
+    s->lower = QVector3D(mesh->xmin(), mesh->ymin(), mesh->zmin());
+    s->upper = QVector3D(mesh->xmax(), mesh->ymax(), mesh->zmax());
+    s->fingerprint = mesh->fingerprint();
+    s->preview = mesh->preview(FileSummary::PREVIEW_SIZE);
+    return s;
+}
+
 void Loader::run()
 {
+    StartupProfile::mark("Loader started");
     Mesh* mesh = load_stl();
-    if (mesh)
+    StartupProfile::mark("Mesh loaded");
+    if (!mesh && is_unchanged())
     {
+        // Still reported, so that the file is watched again
+        emit loaded_file(filename);
+    }
+    else if (mesh)
+    {
+        mesh->content_fingerprint = content_hash.result();
+
         if (mesh->empty())
         {
             emit error_empty_mesh();
@@ -21,7 +131,40 @@ void Loader::run()
         }
         else
         {
-            emit got_mesh(mesh, is_reload);
+            // The receiver of got_mesh may delete the mesh at any time,
+            // so the box, grid, report and summary are built first
+            if (oriented_box)
+            {
+                mesh->measure_oriented_box();
+            }
+            if (print_orientation)
+            {
+                mesh->orient_for_printing();
+            }
+            if (curvature)
+            {
+                mesh->measure_curvature();
+            }
+            VoxelGrid* grid = voxel_resolution
+                ? new VoxelGrid(mesh, voxel_resolution, voxel_band) : nullptr;
+            QualityReport* report = quality
+                ? new QualityReport(mesh->quality()) : nullptr;
+            FileSummary* file_summary = summary ? summarize(mesh) : nullptr;
+            const quint64 fingerprint = mesh->fingerprint();
+            emit got_mesh(mesh, is_reload || emitted_partial);
+            if (grid)
+            {
+                emit got_voxels(grid);
+            }
+            if (report)
+            {
+                emit got_quality(report);
+            }
+            if (file_summary)
+            {
+                emit got_summary(file_summary);
+            }
+            emit loaded_fingerprint(fingerprint);
             emit loaded_file(filename);
         }
     }
@@ -55,8 +198,13 @@ void parallel_sort(Vertex* begin, Vertex* end, int threads)
     }
 }
 
-Mesh* mesh_from_verts(uint32_t tri_count, QVector<Vertex>& verts)
+Mesh* mesh_from_verts(uint32_t tri_count, QVector<Vertex>& verts,
+                      std::vector<GLuint>&& face_colors=std::vector<GLuint>(),
+                      std::vector<GLfloat>&& face_normals=std::vector<GLfloat>(),
+                      int repairs=0)
 {
+    StartupProfile::mark("File parsed");
+
     // Save indicies as the second element in the array
     // (so that we can reconstruct triangle order after sorting)
     for (size_t i=0; i < tri_count*3; ++i)
@@ -102,109 +250,292 @@ Mesh* mesh_from_verts(uint32_t tri_count, QVector<Vertex>& verts)
         flat_verts.push_back(v.z);
     }
 
-    return new Mesh(std::move(flat_verts), std::move(indices));
+    return new Mesh(std::move(flat_verts), std::move(indices),
+                    std::move(face_colors), std::move(face_normals),
+                    repairs);
+}
+
+/*  Decodes the attribute word of a binary stl facet into an RGBA8 colour
+ *  (or 0 if the facet has no colour of its own).  Both conventions store
+ *  5 bits per channel, in opposite orders:
+ *
+ *  VisCAM / SolidView: blue in bits 0-4, green 5-9, red 10-14, and bit 15
+ *  set if the colour is valid.
+ *
+ *  Materialise (marked by "COLOR=" in the header, followed by the RGBA
+ *  object colour): red in bits 0-4, green 5-9, blue 10-14, and bit 15 set
+ *  if the facet uses the object colour instead. */
+static GLuint decode_face_color(uint16_t a, bool materialise, GLuint object_color)
+{
+    auto expand = [](uint16_t c) { return GLuint((c << 3) | (c >> 2)); };
+    const GLuint low = expand(a & 31);
+    const GLuint mid = expand((a >> 5) & 31);
+    const GLuint high = expand((a >> 10) & 31);
+    if (materialise)
+    {
+        return (a & 0x8000) ? object_color
+                            : low | (mid << 8) | (high << 16) | 0xff000000;
+    }
+    return (a & 0x8000) ? high | (mid << 8) | (low << 16) | 0xff000000 : 0;
 }
 
 ////////////////////////////////////////////////////////////////////////////////
 
 Mesh* Loader::load_stl()
 {
-    QFile file(filename);
-    if (!file.open(QIODevice::ReadOnly))
+    QFile file;
+    if (filename == "-")
     {
-        emit error_missing_file();
-        return NULL;
+        // Read from standard input, e.g. "generator | fstl -"
+        if (!file.open(stdin, QIODevice::ReadOnly))
+        {
+            emit error_missing_file();
+            return NULL;
+        }
+    }
+    else
+    {
+        file.setFileName(filename);
+        if (!file.open(QIODevice::ReadOnly))
+        {
+            emit error_missing_file();
+            return NULL;
+        }
     }
 
-    // First, try to read the stl as an ASCII file
+    // Peek at the start of the file to tell ASCII and binary apart.  This
+    // uses a read transaction rather than seek(), since pipes and stdin
+    // can't be rewound.
+    bool ascii = false;
+    file.startTransaction();
     if (file.read(5) == "solid")
     {
         file.readLine(); // skip solid name
         const auto line = file.readLine().trimmed();
-        if (line.startsWith("facet") ||
-            line.startsWith("endsolid"))
-        {
-            file.seek(0);
-            return read_stl_ascii(file);
-        }
+        ascii = line.startsWith("facet") ||
+                line.startsWith("endsolid");
         // Otherwise, this STL is a binary stl but contains 'solid' as
         // the first five characters.  This is a bad life choice, but
         // we can gracefully handle it by falling through to the binary
         // STL reader below.
     }
+    file.rollbackTransaction();
 
-    file.seek(0);
-    return read_stl_binary(file);
+    return ascii ? read_stl_ascii(file) : read_stl_binary(file);
+}
+
+void Loader::emit_partial(uint32_t tri_count, const QVector<Vertex>& verts)
+{
+    // Deduplicate a copy of what has arrived so far, leaving the
+    // original array free to keep growing.
+    QVector<Vertex> partial(verts.mid(0, tri_count*3));
+    std::vector<GLuint> colors;
+    if (face_colors.size() >= tri_count &&
+        std::any_of(face_colors.begin(), face_colors.begin() + tri_count,
+                    [](GLuint c) { return c != 0; }))
+    {
+        colors.assign(face_colors.begin(), face_colors.begin() + tri_count);
+    }
+    std::vector<GLfloat> normals;
+    if (face_normals.size() >= size_t(tri_count) * 3)
+    {
+        normals.assign(face_normals.begin(), face_normals.begin() + tri_count * 3);
+    }
+    emit got_mesh(mesh_from_verts(tri_count, partial, std::move(colors),
+                                  std::move(normals)),
+                  is_reload || emitted_partial);
+    emitted_partial = true;
 }
 
 Mesh* Loader::read_stl_binary(QFile& file)
 {
-    QDataStream data(&file);
-    data.setByteOrder(QDataStream::LittleEndian);
-    data.setFloatingPointPrecision(QDataStream::SinglePrecision);
+    // Read through the header rather than seeking, which also works on
+    // pipes.  It may hold the object colour of a Materialise export.
+    const QByteArray header = file.read(80);
+    content_hash.add(header);
+    const int color_tag = header.indexOf("COLOR=");
+    const bool materialise = color_tag >= 0 && color_tag + 10 <= header.size();
+    const GLuint object_color = materialise
+        ? qFromLittleEndian<quint32>(header.constData() + color_tag + 6) : 0;
 
     // Load the triangle count from the .stl file
-    file.seek(80);
     uint32_t tri_count;
-    data >> tri_count;
+    if (file.read(reinterpret_cast<char*>(&tri_count), sizeof(tri_count))
+            != sizeof(tri_count))
+    {
+        emit error_bad_stl();
+        return NULL;
+    }
+    content_hash.add(reinterpret_cast<const char*>(&tri_count), sizeof(tri_count));
+    tri_count = qFromLittleEndian(tri_count);
 
-    // Verify that the file is the right size
-    if (file.size() != 84 + tri_count*50)
+    // Verify that the file is the right size.  Streams don't know their
+    // size, so for those we trust the header and check that enough data
+    // actually arrives.
+    const bool streaming = file.isSequential();
+    if (!streaming && file.size() != 84 + qint64(tri_count)*50)
     {
         emit error_bad_stl();
         return NULL;
     }
 
-    // Extract vertices into an array of xyz, unsigned pairs
-    QVector<Vertex> verts(tri_count*3);
+    // The vertex array is indexed by int, which limits the triangle count
+    if (tri_count > uint32_t(std::numeric_limits<int>::max() / 3))
+    {
+        emit error_bad_stl();
+        return NULL;
+    }
+
+    // Extract vertices into an array of xyz, unsigned pairs.  A stream's
+    // header is only an upper bound (it may be junk), so the arrays grow
+    // as triangles actually arrive rather than being sized from it.
+    QVector<Vertex> verts;
+    bool any_color = false;
+    auto grow_to = [&](uint32_t n)
+    {
+        verts.resize(int(n) * 3);
+        face_colors.resize(n, 0);
+        if (facet_normals)
+        {
+            face_normals.resize(size_t(n) * 3);
+        }
+    };
+    if (!streaming)
+    {
+        grow_to(tri_count);
+    }
+
+    // Regular files are read in one go; streams are read in chunks so
+    // that geometry can be shown while the rest is still arriving.
+    const uint32_t chunk = streaming ? STREAM_CHUNK_TRIANGLES : tri_count;
 
-    // Dummy array, because readRawData is faster than skipRawData
-    std::unique_ptr<uint8_t[]> buffer(new uint8_t[tri_count * 50]);
-    data.readRawData((char*)buffer.get(), tri_count * 50);
+    // Dummy array, because reading raw data is faster than skipping it
+    std::unique_ptr<uint8_t[]> buffer(new uint8_t[size_t(chunk) * 50]);
 
-    // Store vertices in the array, processing one triangle at a time.
-    auto b = buffer.get() + 3 * sizeof(float);
-    for (auto v=verts.begin(); v != verts.end(); v += 3)
+    QElapsedTimer timer;
+    timer.start();
+
+    for (uint32_t done=0; done < tri_count; )
     {
-        // Load vertex data from .stl file into vertices
-        for (unsigned i=0; i < 3; ++i)
+        const uint32_t n = std::min(chunk, tri_count - done);
+        if (file.read((char*)buffer.get(), qint64(n) * 50) != qint64(n) * 50)
+        {
+            emit error_bad_stl();
+            return NULL;
+        }
+        content_hash.add((const char*)buffer.get(), size_t(n) * 50);
+        if (streaming)
+        {
+            grow_to(done + n);
+        }
+        auto v = verts.begin() + int(done) * 3;
+
+        // Store vertices in the array, processing one triangle at a time.
+        auto b = buffer.get() + 3 * sizeof(float);
+        for (uint32_t t=0; t < n; ++t, v += 3)
         {
-            qFromLittleEndian<float>(b, 3, &v[i]);
-            b += 3 * sizeof(float);
+            // The facet normal comes just before the vertices
+            if (facet_normals)
+            {
+                qFromLittleEndian<float>(b - 3 * sizeof(float), 3,
+                                         &face_normals[size_t(done + t) * 3]);
+            }
+
+            // Load vertex data from .stl file into vertices
+            for (unsigned i=0; i < 3; ++i)
+            {
+                qFromLittleEndian<float>(b, 3, &v[i]);
+                b += 3 * sizeof(float);
+            }
+
+            // Decode the face attribute, which may hold a colour
+            const GLuint color = decode_face_color(
+                    qFromLittleEndian<quint16>(b), materialise, object_color);
+            face_colors[done + t] = color;
+            any_color |= color != 0;
+
+            // Skip face attribute and next face's normal vector
+            b += 3 * sizeof(float) + sizeof(uint16_t);
         }
+        done += n;
 
-        // Skip face attribute and next face's normal vector
-        b += 3 * sizeof(float) + sizeof(uint16_t);
+        if (streaming && done < tri_count &&
+            timer.elapsed() > STREAM_UPDATE_MS)
+        {
+            emit_partial(done, verts);
+            timer.restart();
+        }
     }
 
-    return mesh_from_verts(tri_count, verts);
+    // Most files leave the attribute at zero, so don't keep colours
+    // unless some facet actually has one
+    if (!any_color)
+    {
+        face_colors.clear();
+    }
+    if (is_unchanged())
+    {
+        return NULL;
+    }
+    return mesh_from_verts(tri_count, verts, std::move(face_colors),
+                           std::move(face_normals), repairs);
 }
 
 Mesh* Loader::read_stl_ascii(QFile& file)
 {
-    file.readLine();
+    // Every line read is also hashed
+    auto read_line = [&]()
+    {
+        const QByteArray line = file.readLine();
+        content_hash.add(line);
+        return line;
+    };
+
+    read_line();
     uint32_t tri_count = 0;
     QVector<Vertex> verts(tri_count*3);
 
+    QElapsedTimer timer;
+    timer.start();
+
     bool okay = true;
-    while (!file.atEnd() && okay)
+    while (okay)
     {
-        const auto line = file.readLine().simplified();
+        // readLine() only returns an empty array at the end of the file;
+        // atEnd() isn't reliable on pipes, where more data may be coming.
+        const auto raw = read_line();
+        if (raw.isEmpty())
+        {
+            break;
+        }
+
+        const auto line = raw.simplified();
         if (line.startsWith("endsolid"))
         {
             break;
         }
         else if (!line.startsWith("facet normal") ||
-                 !file.readLine().simplified().startsWith("outer loop"))
+                 !read_line().simplified().startsWith("outer loop"))
         {
             okay = false;
             break;
         }
 
+        if (facet_normals)
+        {
+            // A missing or malformed normal is kept as zero, which the
+            // mesh counts as missing rather than rejecting the file
+            const auto n = line.split(' ');
+            for (int i=0; i < 3; ++i)
+            {
+                face_normals.push_back(n.size() == 5 ? n[i + 2].toFloat() : 0);
+            }
+        }
+
         for (int i=0; i < 3; ++i)
         {
-            auto line = file.readLine().simplified().split(' ');
-            if (line[0] != "vertex")
+            auto line = read_line().simplified().split(' ');
+            if (line.size() != 4 || line[0] != "vertex")
             {
                 okay = false;
                 break;
@@ -214,18 +545,34 @@ Mesh* Loader::read_stl_ascii(QFile& file)
             const float z = line[3].toFloat(&okay);
             verts.push_back(Vertex(x, y, z));
         }
-        if (!file.readLine().trimmed().startsWith("endloop") ||
-            !file.readLine().trimmed().startsWith("endfacet"))
+        if (!read_line().trimmed().startsWith("endloop") ||
+            !read_line().trimmed().startsWith("endfacet"))
         {
             okay = false;
             break;
         }
         tri_count++;
+
+        if (file.isSequential() && timer.elapsed() > STREAM_UPDATE_MS)
+        {
+            emit_partial(tri_count, verts);
+            timer.restart();
+        }
     }
 
-    if (okay)
+    // Anything after the end of the solid still counts as contents
+    if (okay && !file.isSequential())
+    {
+        content_hash.add(file.readAll());
+    }
+    if (okay && is_unchanged())
     {
-        return mesh_from_verts(tri_count, verts);
+        return NULL;
+    }
+    else if (okay)
+    {
+        return mesh_from_verts(tri_count, verts, std::vector<GLuint>(),
+                               std::move(face_normals), repairs);
     }
     else
     {
@@ -233,4 +580,3 @@ Mesh* Loader::read_stl_ascii(QFile& file)
         return NULL;
     }
 }
-
@@ -3,26 +3,74 @@
 
 #include <QThread>
 
+#include "fingerprint.h"
 #include "mesh.h"
+#include "vertex.h"
+
+struct FileSummary;
+struct QualityReport;
+class VoxelGrid;
 
 class Loader : public QThread
 {
     Q_OBJECT
 public:
-    explicit Loader(QObject* parent, const QString& filename, bool is_reload);
+    explicit Loader(QObject* parent, const QString& filename, bool is_reload,
+                    bool facet_normals=false, int repairs=0);
     void run();
 
+    /*  Loads a mesh on the calling thread, for batch jobs.  On failure,
+     *  returns null and sets error. */
+    static Mesh* load_now(const QString& filename, QString* error);
+
+    /*  Also voxelizes the loaded mesh (see VoxelGrid) and emits the grid
+     *  through got_voxels, after got_mesh */
+    void set_voxelize(int resolution, int band);
+
+    /*  Also measures the minimum oriented box of the loaded mesh */
+    void set_oriented_box(bool b);
+
+    /*  Also searches for the best print orientation of the loaded mesh */
+    void set_print_orientation(bool b);
+
+    /*  Also estimates the curvature at each vertex of the loaded mesh */
+    void set_curvature(bool b);
+
+    /*  Also measures the element quality of the loaded mesh, and emits
+     *  the report through got_quality, after got_mesh */
+    void set_quality(bool b);
+
+    /*  Also summarizes the loaded file for the recent-files menu, and
+     *  emits the summary through got_summary, after got_mesh */
+    void set_summary(bool b);
+
+    /*  Skips building the mesh if the file's contents still hash to this
+     *  fingerprint (see ContentHash), for reloads of files that were
+     *  touched but not changed */
+    void set_unchanged_fingerprint(quint64 f);
+
 protected:
     Mesh* load_stl();
 
     /*  Reads an ASCII stl, starting from the start of the file*/
     Mesh* read_stl_ascii(QFile& file);
-    /*  Reads a binary stl, assuming we're at the end of the header */
+    /*  Reads a binary stl, starting from the start of the file.
+     *  Doesn't need seek() or size(), so this works on pipes too. */
     Mesh* read_stl_binary(QFile& file);
 
+    /*  Summary of the loaded file, for got_summary */
+    FileSummary* summarize(const Mesh* mesh) const;
+
+    /*  Emits the first tri_count triangles of a partially-read stream */
+    void emit_partial(uint32_t tri_count, const QVector<Vertex>& verts);
+
 signals:
     void loaded_file(QString filename);
+    void loaded_fingerprint(quint64 fingerprint);
     void got_mesh(Mesh* m, bool is_reload);
+    void got_voxels(VoxelGrid* grid);
+    void got_quality(QualityReport* report);
+    void got_summary(FileSummary* summary);
 
     void error_bad_stl();
     void error_empty_mesh();
@@ -31,6 +79,44 @@ signals:
 private:
     const QString filename;
     bool is_reload;
+
+    /*  If set, the facet normals stored in the file are kept (in
+     *  face_normals) rather than skipped */
+    const bool facet_normals;
+    std::vector<GLfloat> face_normals;
+
+    /*  Mesh::Repair flags, applied once the whole mesh is loaded (partial
+     *  meshes are shown as they are) */
+    const int repairs;
+
+    // Voxel grid resolution and band, or 0 to skip voxelizing
+    int voxel_resolution;
+    int voxel_band;
+
+    bool oriented_box;
+    bool print_orientation;
+    bool curvature;
+    bool quality;
+    bool summary;
+
+    /*  Hash of the bytes read so far, and the one that means the file
+     *  hasn't changed (0 if none) */
+    ContentHash content_hash;
+    quint64 unchanged_fingerprint;
+    bool is_unchanged() const;
+
+    /*  Set once part of a streamed mesh has been shown, so that later
+     *  updates don't reset the camera */
+    bool emitted_partial;
+
+    /*  RGBA8 colour per triangle, decoded from the attribute words of a
+     *  binary stl (empty if no facet has a colour) */
+    std::vector<GLuint> face_colors;
+
+    /*  Streams are read in chunks of this many triangles, and the
+     *  geometry received so far is shown at most this often */
+    const static uint32_t STREAM_CHUNK_TRIANGLES = 1 << 16;
+    const static int STREAM_UPDATE_MS = 500;
 };
 
 #endif // LOADER_H
@@ -0,0 +1,501 @@
+#include <QFile>
+#include <QFileInfo>
+#include <QTemporaryFile>
+#include <QVector3D>
+#include <QtEndian>
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstring>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+#include "lod.h"
+#include "parallel.h"
+
+// Triangles are binned on a grid of 2^LOD_DEPTH cells per axis, which is
+// also the deepest level of the octree
+static const int LOD_DEPTH = 7;
+
+// Nodes with more triangles than this are split (unless at LOD_DEPTH)
+static const uint64_t LOD_LEAF_TRIANGLES = 1 << 16;
+
+// Inner nodes are simplified by clustering their vertices on a grid
+// with this many cells per axis
+static const int LOD_GRID = 128;
+
+// Interleaves the bits of x, y and z, so that every octree node covers
+// a contiguous range of cells
+static uint32_t morton(uint32_t x, uint32_t y, uint32_t z)
+{
+    uint32_t m = 0;
+    for (int i=0; i < LOD_DEPTH; ++i)
+    {
+        m |= (((x >> i) & 1) << (3*i)) |
+             (((y >> i) & 1) << (3*i + 1)) |
+             (((z >> i) & 1) << (3*i + 2));
+    }
+    return m;
+}
+
+struct CellKey
+{
+    uint32_t x, y, z;
+    bool operator==(const CellKey& other) const
+    {
+        return x == other.x && y == other.y && z == other.z;
+    }
+};
+
+struct CellKeyHash
+{
+    size_t operator()(const CellKey& k) const
+    {
+        return (k.x * 73856093u) ^ (k.y * 19349663u) ^ (k.z * 83492791u);
+    }
+};
+
+struct LodMeshData
+{
+    std::vector<float> vertices;
+    std::vector<uint32_t> indices;
+};
+
+// Merges vertices that map to the same key, placing each merged vertex at
+// the average of its sources, and drops triangles that collapse.
+template <typename KeyFn>
+static LodMeshData merge_vertices(const LodMeshData& in, KeyFn key)
+{
+    std::unordered_map<CellKey, uint32_t, CellKeyHash> merged;
+    std::vector<uint32_t> remap(in.vertices.size() / 3);
+    std::vector<double> sums;
+    std::vector<uint32_t> counts;
+    for (size_t i=0; i < remap.size(); ++i)
+    {
+        const float* v = &in.vertices[3*i];
+        const auto inserted = merged.insert(
+                std::make_pair(key(v), uint32_t(counts.size())));
+        if (inserted.second)
+        {
+            sums.resize(sums.size() + 3, 0);
+            counts.push_back(0);
+        }
+        const uint32_t j = inserted.first->second;
+        for (int k=0; k < 3; ++k)
+        {
+            sums[3*j + k] += v[k];
+        }
+        counts[j]++;
+        remap[i] = j;
+    }
+
+    LodMeshData out;
+    out.vertices.resize(sums.size());
+    for (size_t j=0; j < counts.size(); ++j)
+    {
+        for (int k=0; k < 3; ++k)
+        {
+            out.vertices[3*j + k] = sums[3*j + k] / counts[j];
+        }
+    }
+    for (size_t t=0; t < in.indices.size(); t += 3)
+    {
+        const uint32_t a = remap[in.indices[t]];
+        const uint32_t b = remap[in.indices[t + 1]];
+        const uint32_t c = remap[in.indices[t + 2]];
+        if (a != b && b != c && a != c)
+        {
+            out.indices.push_back(a);
+            out.indices.push_back(b);
+            out.indices.push_back(c);
+        }
+    }
+    return out;
+}
+
+struct LodBuildNode
+{
+    int depth;
+    uint32_t x, y, z;       // Cell coordinates at this depth
+    uint64_t first, last;   // Range of triangles in the sorted file
+    uint32_t children[8];
+
+    QVector3D lower, upper; // Bounds of the node's mesh
+    QVector3D center;
+    float radius;
+    float error;
+    uint64_t offset;
+    uint32_t vertex_count;
+    uint32_t index_count;
+};
+
+bool build_lod(const QString& input, const QString& output, QString* error)
+{
+    QFile in(input);
+    if (!in.open(QIODevice::ReadOnly))
+    {
+        *error = "Could not open " + input;
+        return false;
+    }
+
+    // Map the input rather than reading it, so that the OS pages it in
+    // and out as needed; the mesh may be larger than RAM.
+    const qint64 size = in.size();
+    const uchar* data = size >= 84 ? in.map(0, size) : nullptr;
+    const uint32_t tri_count = data ? qFromLittleEndian<quint32>(data + 80) : 0;
+    if (!data || size != 84 + qint64(tri_count) * 50)
+    {
+        *error = input + " is not a binary .stl file";
+        return false;
+    }
+    if (tri_count == 0)
+    {
+        *error = input + " contains no triangles";
+        return false;
+    }
+
+    // Triangle t as nine floats (three xyz vertices)
+    auto read_triangle = [&](uint64_t t, float* v)
+    {
+        qFromLittleEndian<float>(data + 84 + t * 50 + 12, 9, v);
+    };
+
+    // Pass 1: find the bounds of the mesh
+    const unsigned workers = worker_count();
+    std::vector<QVector3D> lowers(workers, QVector3D(INFINITY, INFINITY, INFINITY));
+    std::vector<QVector3D> uppers(workers, -lowers[0]);
+    parallel_for(tri_count, [&](size_t begin, size_t end, size_t w)
+    {
+        float v[9];
+        QVector3D& lower = lowers[w];
+        QVector3D& upper = uppers[w];
+        for (size_t t=begin; t < end; ++t)
+        {
+            read_triangle(t, v);
+            for (int i=0; i < 9; ++i)
+            {
+                lower[i % 3] = fmin(lower[i % 3], v[i]);
+                upper[i % 3] = fmax(upper[i % 3], v[i]);
+            }
+        }
+    });
+    QVector3D lower = lowers[0];
+    QVector3D upper = uppers[0];
+    for (unsigned w=1; w < workers; ++w)
+    {
+        for (int i=0; i < 3; ++i)
+        {
+            lower[i] = fmin(lower[i], lowers[w][i]);
+            upper[i] = fmax(upper[i], uppers[w][i]);
+        }
+    }
+
+    // The octree covers a cube, slightly enlarged so that the upper
+    // bound falls inside the last cell.
+    const int grid = 1 << LOD_DEPTH;
+    const QVector3D extent = upper - lower;
+    const float cube = fmax(fmax(extent.x(), extent.y()), fmax(extent.z(), 1e-6f)) * 1.0001f;
+    auto cell_of = [&](const float* v)
+    {
+        uint32_t c[3];
+        for (int i=0; i < 3; ++i)
+        {
+            const float centroid = (v[i] + v[i + 3] + v[i + 6]) / 3;
+            const int n = int((centroid - lower[i]) / cube * grid);
+            c[i] = std::min(std::max(n, 0), grid - 1);
+        }
+        return morton(c[0], c[1], c[2]);
+    };
+
+    // Pass 2: count triangles per cell
+    const uint32_t cell_count = 1u << (3 * LOD_DEPTH);
+    std::vector<std::atomic<uint64_t>> cursors(cell_count);
+    parallel_for(tri_count, [&](size_t begin, size_t end, size_t)
+    {
+        float v[9];
+        for (size_t t=begin; t < end; ++t)
+        {
+            read_triangle(t, v);
+            cursors[cell_of(v)].fetch_add(1, std::memory_order_relaxed);
+        }
+    });
+
+    // Turn counts into the start of each cell's range (with one extra
+    // entry for the end of the last cell)
+    std::vector<uint64_t> offsets(cell_count + 1, 0);
+    for (uint32_t c=0; c < cell_count; ++c)
+    {
+        offsets[c + 1] = offsets[c] + cursors[c].load();
+        cursors[c].store(offsets[c]);
+    }
+
+    // Pass 3: sort triangles by cell (a counting sort) into a mapped
+    // temporary file, so that every node's triangles are contiguous.
+    QTemporaryFile sorted_file(QFileInfo(output).absolutePath() + "/fstl-lod-XXXXXX");
+    if (!sorted_file.open() || !sorted_file.resize(qint64(tri_count) * 36))
+    {
+        *error = "Could not create a temporary file next to " + output;
+        return false;
+    }
+    float* sorted = reinterpret_cast<float*>(sorted_file.map(0, sorted_file.size()));
+    if (!sorted)
+    {
+        *error = "Could not map a temporary file next to " + output;
+        return false;
+    }
+    parallel_for(tri_count, [&](size_t begin, size_t end, size_t)
+    {
+        float v[9];
+        for (size_t t=begin; t < end; ++t)
+        {
+            read_triangle(t, v);
+            const uint64_t i = cursors[cell_of(v)].fetch_add(1, std::memory_order_relaxed);
+            memcpy(&sorted[i * 9], v, sizeof(v));
+        }
+    });
+    in.unmap(const_cast<uchar*>(data));
+    in.close();
+
+    // Build the octree breadth-first, so that the root is node 0 and
+    // every node comes after its parent.
+    std::vector<LodBuildNode> nodes;
+    LodBuildNode root;
+    root.depth = 0;
+    root.x = root.y = root.z = 0;
+    root.first = 0;
+    root.last = tri_count;
+    nodes.push_back(root);
+    int max_depth = 0;
+    for (size_t i=0; i < nodes.size(); ++i)
+    {
+        std::fill(nodes[i].children, nodes[i].children + 8, LOD_NO_CHILD);
+        const LodBuildNode node = nodes[i];
+        max_depth = std::max(max_depth, node.depth);
+        if (node.last - node.first <= LOD_LEAF_TRIANGLES || node.depth == LOD_DEPTH)
+        {
+            continue;
+        }
+
+        const int shift = 3 * (LOD_DEPTH - node.depth - 1);
+        for (uint32_t c=0; c < 8; ++c)
+        {
+            LodBuildNode child;
+            child.depth = node.depth + 1;
+            child.x = node.x * 2 + (c & 1);
+            child.y = node.y * 2 + ((c >> 1) & 1);
+            child.z = node.z * 2 + ((c >> 2) & 1);
+            const uint32_t m = morton(child.x, child.y, child.z) << shift;
+            child.first = offsets[m];
+            child.last = offsets[m + (1u << shift)];
+            if (child.last > child.first)
+            {
+                nodes[i].children[c] = nodes.size();
+                nodes.push_back(child);
+            }
+        }
+    }
+
+    QFile out(output);
+    if (!out.open(QIODevice::ReadWrite | QIODevice::Truncate))
+    {
+        *error = "Could not write " + output;
+        return false;
+    }
+
+    // Leave room for the header and node table, which are filled in last
+    const qint64 table_size = sizeof(LodHeader) + nodes.size() * sizeof(LodNode);
+    out.write(QByteArray(table_size, 0));
+    std::mutex out_mutex;
+    bool write_failed = false;
+    bool read_failed = false;
+
+    // Builds and writes one node's mesh.  Children are always done before
+    // their parents (deepest level first), and are read back from the
+    // output file, so at most a few nodes' meshes are in memory at once.
+    auto build_node = [&](LodBuildNode& node)
+    {
+        LodMeshData mesh;
+        bool leaf = true;
+        float child_error = 0;
+        for (uint32_t c : node.children)
+        {
+            if (c == LOD_NO_CHILD)
+            {
+                continue;
+            }
+            leaf = false;
+            const LodBuildNode& child = nodes[c];
+            const uint32_t base = mesh.vertices.size() / 3;
+            mesh.vertices.resize(mesh.vertices.size() + child.vertex_count * 3);
+            const size_t first = mesh.indices.size();
+            mesh.indices.resize(first + child.index_count);
+            const qint64 vertex_bytes = qint64(child.vertex_count) * 3 * sizeof(float);
+            const qint64 index_bytes = qint64(child.index_count) * sizeof(uint32_t);
+            QFile file(output);
+            if (!file.open(QIODevice::ReadOnly) || !file.seek(child.offset) ||
+                file.read(reinterpret_cast<char*>(&mesh.vertices[base * 3]),
+                          vertex_bytes) != vertex_bytes ||
+                file.read(reinterpret_cast<char*>(&mesh.indices[first]),
+                          index_bytes) != index_bytes)
+            {
+                std::lock_guard<std::mutex> lock(out_mutex);
+                read_failed = true;
+                return;
+            }
+            for (size_t i=first; i < mesh.indices.size(); ++i)
+            {
+                mesh.indices[i] += base;
+            }
+            child_error = fmax(child_error, child.error);
+        }
+
+        if (leaf)
+        {
+            // Leaves keep the original triangles, with exact duplicate
+            // vertices welded together.
+            for (uint64_t t=node.first; t < node.last; ++t)
+            {
+                mesh.vertices.insert(mesh.vertices.end(), &sorted[t * 9], &sorted[t * 9 + 9]);
+            }
+            mesh.indices.resize(mesh.vertices.size() / 3);
+            for (size_t i=0; i < mesh.indices.size(); ++i)
+            {
+                mesh.indices[i] = i;
+            }
+            mesh = merge_vertices(mesh, [](const float* v)
+            {
+                CellKey k;
+                memcpy(&k, v, sizeof(k));
+                return k;
+            });
+            node.error = 0;
+        }
+        else
+        {
+            // Inner nodes cluster their children's vertices on a grid
+            // across the node's cube, so they get coarser towards the root.
+            const float cell = cube / (1 << node.depth) / LOD_GRID;
+            const QVector3D origin = lower + QVector3D(node.x, node.y, node.z) * (cube / (1 << node.depth));
+            mesh = merge_vertices(mesh, [&](const float* v)
+            {
+                CellKey k;
+                k.x = uint32_t(int(floor((v[0] - origin.x()) / cell)));
+                k.y = uint32_t(int(floor((v[1] - origin.y()) / cell)));
+                k.z = uint32_t(int(floor((v[2] - origin.z()) / cell)));
+                return k;
+            });
+            node.error = child_error + cell * sqrt(3.0f);
+        }
+
+        // Bounds include the children, so that culling a node also
+        // culls everything below it.
+        node.lower = QVector3D(mesh.vertices[0], mesh.vertices[1], mesh.vertices[2]);
+        node.upper = node.lower;
+        for (size_t i=0; i < mesh.vertices.size(); ++i)
+        {
+            node.lower[i % 3] = fmin(node.lower[i % 3], mesh.vertices[i]);
+            node.upper[i % 3] = fmax(node.upper[i % 3], mesh.vertices[i]);
+        }
+        for (uint32_t c : node.children)
+        {
+            if (c != LOD_NO_CHILD)
+            {
+                for (int i=0; i < 3; ++i)
+                {
+                    node.lower[i] = fmin(node.lower[i], nodes[c].lower[i]);
+                    node.upper[i] = fmax(node.upper[i], nodes[c].upper[i]);
+                }
+            }
+        }
+        node.center = (node.lower + node.upper) / 2;
+        node.radius = (node.upper - node.center).length();
+        for (uint32_t c : node.children)
+        {
+            if (c != LOD_NO_CHILD)
+            {
+                node.radius = fmax(node.radius,
+                        (nodes[c].center - node.center).length() + nodes[c].radius);
+            }
+        }
+
+        node.vertex_count = mesh.vertices.size() / 3;
+        node.index_count = mesh.indices.size();
+
+        std::lock_guard<std::mutex> lock(out_mutex);
+        node.offset = out.size();
+        out.seek(node.offset);
+        const qint64 vertex_bytes = mesh.vertices.size() * sizeof(float);
+        const qint64 index_bytes = mesh.indices.size() * sizeof(uint32_t);
+        if (out.write(reinterpret_cast<const char*>(mesh.vertices.data()), vertex_bytes) != vertex_bytes ||
+            out.write(reinterpret_cast<const char*>(mesh.indices.data()), index_bytes) != index_bytes ||
+            !out.flush())
+        {
+            write_failed = true;
+        }
+    };
+
+    for (int depth=max_depth; depth >= 0 && !write_failed && !read_failed; --depth)
+    {
+        std::vector<size_t> level;
+        for (size_t i=0; i < nodes.size(); ++i)
+        {
+            if (nodes[i].depth == depth)
+            {
+                level.push_back(i);
+            }
+        }
+        parallel_for(level.size(), [&](size_t begin, size_t end, size_t)
+        {
+            for (size_t i=begin; i < end; ++i)
+            {
+                build_node(nodes[level[i]]);
+            }
+        });
+    }
+
+    LodHeader header;
+    memcpy(header.magic, "FSTLLOD1", 8);
+    header.node_count = nodes.size();
+    header.tri_count = tri_count;
+    for (int i=0; i < 3; ++i)
+    {
+        header.lower[i] = nodes[0].lower[i];
+        header.upper[i] = nodes[0].upper[i];
+    }
+
+    std::vector<LodNode> table(nodes.size());
+    for (size_t i=0; i < nodes.size(); ++i)
+    {
+        const LodBuildNode& n = nodes[i];
+        LodNode& t = table[i];
+        t.offset = n.offset;
+        for (int j=0; j < 3; ++j)
+        {
+            t.center[j] = n.center[j];
+        }
+        t.radius = n.radius;
+        t.error = n.error;
+        t.vertex_count = n.vertex_count;
+        t.index_count = n.index_count;
+        std::copy(n.children, n.children + 8, t.children);
+        t.reserved = 0;
+    }
+
+    if (read_failed)
+    {
+        *error = "Could not read back nodes from " + output;
+        return false;
+    }
+    out.seek(0);
+    if (write_failed ||
+        out.write(reinterpret_cast<const char*>(&header), sizeof(header)) != sizeof(header) ||
+        out.write(reinterpret_cast<const char*>(table.data()), table.size() * sizeof(LodNode))
+            != qint64(table.size() * sizeof(LodNode)))
+    {
+        *error = "Could not write " + output;
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,47 @@
+#ifndef LOD_H
+#define LOD_H
+
+#include <QString>
+
+#include <cstdint>
+
+/*
+ *  On-disk level-of-detail structure for meshes that are too large to
+ *  load at once (built with --build-lod, rendered by LodMesh).
+ *
+ *  The file starts with a LodHeader, followed by node_count LodNodes.
+ *  Node 0 is the root of an octree; each node stores a simplified mesh
+ *  of its region, whose error (in model units) shrinks towards the
+ *  leaves, which hold the original triangles.  Each mesh is stored at
+ *  its node's offset as vertex_count xyz floats followed by index_count
+ *  uint32 indices.  Everything is in native (little-endian) byte order.
+ */
+struct LodHeader
+{
+    char magic[8];          // "FSTLLOD1"
+    uint32_t node_count;
+    uint32_t tri_count;     // Triangles in the original mesh
+    float lower[3];
+    float upper[3];
+};
+
+struct LodNode
+{
+    uint64_t offset;
+    float center[3];        // Bounding sphere, which contains the
+    float radius;           // spheres of all of the node's children
+    float error;
+    uint32_t vertex_count;
+    uint32_t index_count;
+    uint32_t children[8];   // LOD_NO_CHILD for missing children
+    uint32_t reserved;
+};
+
+const uint32_t LOD_NO_CHILD = 0xffffffff;
+
+/*  Builds a LOD file from a binary .stl, streaming through memory-mapped
+ *  files so that the mesh never has to fit in RAM.  On failure, returns
+ *  false and sets error. */
+bool build_lod(const QString& input, const QString& output, QString* error);
+
+#endif // LOD_H
@@ -0,0 +1,314 @@
+#include <QFile>
+
+#include <chrono>
+#include <cmath>
+#include <cstring>
+
+#include "lodmesh.h"
+#include "glmesh.h"
+
+const float LodMesh::PIXEL_ERROR = 1.5f;
+const size_t LodMesh::VRAM_BUDGET = size_t(512) << 20;
+const int LodMesh::MAX_LOADS = 4;
+
+// Deepest tree accepted from a file (build_lod stops well short of this),
+// which bounds how far traverse recurses
+static const uint8_t MAX_DEPTH = 32;
+const int LodMesh::MAX_UPLOADS_PER_FRAME = 8;
+
+LodMesh::LodMesh(const QString& filename)
+    : filename(filename), resident_bytes(0), frame(0), vertex_position(0),
+      frame_pixel_scale(1), drawn_nodes(0), drawn_triangles(0)
+{
+    memset(&header, 0, sizeof(header));
+}
+
+LodMesh::~LodMesh()
+{
+    // Loads can't be cancelled, so wait for any that are in flight
+    for (auto& load : loading)
+    {
+        load.second.wait();
+    }
+    for (auto& r : resident)
+    {
+        delete r.second.mesh;
+    }
+}
+
+bool LodMesh::load(QString* error)
+{
+    QFile file(filename);
+    if (!file.open(QIODevice::ReadOnly))
+    {
+        *error = "Could not open " + filename;
+        return false;
+    }
+
+    if (file.read(reinterpret_cast<char*>(&header), sizeof(header)) != sizeof(header) ||
+        memcmp(header.magic, "FSTLLOD1", 8) || header.node_count == 0)
+    {
+        *error = filename + " is not a LOD file";
+        return false;
+    }
+
+    // The node count is checked against the file before anything is
+    // allocated for it, so a junk header can't ask for gigabytes
+    const qint64 table_size = qint64(header.node_count) * sizeof(LodNode);
+    if (table_size > file.size() - qint64(sizeof(header)))
+    {
+        *error = filename + " is truncated";
+        return false;
+    }
+    nodes.resize(header.node_count);
+    if (file.read(reinterpret_cast<char*>(nodes.data()), table_size) != table_size)
+    {
+        *error = filename + " is truncated";
+        return false;
+    }
+
+    // Check the table up front, so that drawing never has to.  Nodes are
+    // written breadth-first, so children always come after their parent,
+    // which rules out cycles for traverse to get stuck in.  Each node must
+    // also have a single parent, and the tree at most MAX_DEPTH levels.
+    std::vector<uint8_t> depth(header.node_count, 0);
+    std::vector<bool> has_parent(header.node_count, false);
+    for (uint32_t i=0; i < header.node_count; ++i)
+    {
+        const LodNode& n = nodes[i];
+        const qint64 end = n.offset + qint64(n.vertex_count) * 3 * sizeof(GLfloat)
+                                    + qint64(n.index_count) * sizeof(GLuint);
+        bool valid = n.offset <= quint64(file.size()) && end <= file.size() &&
+                     n.index_count % 3 == 0 && (i == 0) != has_parent[i];
+        for (uint32_t c : n.children)
+        {
+            if (c == LOD_NO_CHILD)
+            {
+                continue;
+            }
+            valid &= c > i && c < header.node_count && !has_parent[c] &&
+                     depth[i] < MAX_DEPTH;
+            if (valid)
+            {
+                has_parent[c] = true;
+                depth[c] = depth[i] + 1;
+            }
+        }
+        if (!valid)
+        {
+            *error = filename + " is corrupt";
+            return false;
+        }
+    }
+    return true;
+}
+
+QVector3D LodMesh::lower() const
+{
+    return QVector3D(header.lower[0], header.lower[1], header.lower[2]);
+}
+
+QVector3D LodMesh::upper() const
+{
+    return QVector3D(header.upper[0], header.upper[1], header.upper[2]);
+}
+
+bool LodMesh::draw(GLuint vp, const QMatrix4x4& mvp, float pixel_scale)
+{
+    frame++;
+    vertex_position = vp;
+    frame_mvp = mvp;
+    frame_pixel_scale = pixel_scale;
+    drawn_nodes = 0;
+    drawn_triangles = 0;
+
+    // Same plane extraction as GLMesh::cull
+    for (int i=0; i < 3; ++i)
+    {
+        planes[2*i]     = mvp.row(3) + mvp.row(i);
+        planes[2*i + 1] = mvp.row(3) - mvp.row(i);
+    }
+    for (auto& p : planes)
+    {
+        p /= p.toVector3D().length();
+    }
+
+    finish_loads();
+
+    if (resident.count(0))
+    {
+        traverse(0);
+    }
+    else
+    {
+        request(0);
+    }
+
+    evict();
+    return !loading.empty();
+}
+
+bool LodMesh::visible(const LodNode& node) const
+{
+    for (const auto& p : planes)
+    {
+        if (p.x()*node.center[0] + p.y()*node.center[1] +
+            p.z()*node.center[2] + p.w() < -node.radius)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+float LodMesh::screen_error(const LodNode& node) const
+{
+    // Use the nearest point of the bounding sphere, and refine anything
+    // that reaches the eye plane
+    const QVector4D c = frame_mvp * QVector4D(node.center[0], node.center[1],
+                                              node.center[2], 1);
+    const float w = c.w() - node.radius * frame_mvp.row(3).toVector3D().length();
+    if (w <= 1e-3f)
+    {
+        return INFINITY;
+    }
+    return node.error * frame_pixel_scale / w;
+}
+
+void LodMesh::traverse(uint32_t i)
+{
+    const LodNode& node = nodes[i];
+    Resident& r = resident[i];
+    r.last_used = frame;
+
+    // Refine only once every visible child is on the GPU, so there are
+    // never holes while the finer level streams in.
+    bool refine = screen_error(node) > PIXEL_ERROR;
+    bool has_children = false;
+    if (refine)
+    {
+        for (uint32_t c : node.children)
+        {
+            if (c == LOD_NO_CHILD || !visible(nodes[c]))
+            {
+                continue;
+            }
+            has_children = true;
+            if (!resident.count(c))
+            {
+                request(c);
+                refine = false;
+            }
+        }
+    }
+
+    if (refine && has_children)
+    {
+        for (uint32_t c : node.children)
+        {
+            if (c != LOD_NO_CHILD && visible(nodes[c]))
+            {
+                traverse(c);
+            }
+        }
+    }
+    else
+    {
+        r.mesh->draw(vertex_position);
+        drawn_nodes++;
+        drawn_triangles += node.index_count / 3;
+    }
+}
+
+void LodMesh::request(uint32_t i)
+{
+    if (loading.count(i) || corrupt.count(i) || loading.size() >= size_t(MAX_LOADS))
+    {
+        return;
+    }
+
+    const LodNode node = nodes[i];
+    const QString path = filename;
+    loading[i] = std::async(std::launch::async, [node, path]()
+    {
+        NodeData data;
+        data.vertices.resize(size_t(node.vertex_count) * 3);
+        data.indices.resize(node.index_count);
+
+        const qint64 vertex_bytes = data.vertices.size() * sizeof(GLfloat);
+        const qint64 index_bytes = data.indices.size() * sizeof(GLuint);
+        QFile file(path);
+        data.valid = file.open(QIODevice::ReadOnly) && file.seek(node.offset) &&
+            file.read(reinterpret_cast<char*>(data.vertices.data()),
+                      vertex_bytes) == vertex_bytes &&
+            file.read(reinterpret_cast<char*>(data.indices.data()),
+                      index_bytes) == index_bytes;
+
+        // Indices go straight to the GPU, so they must stay in range
+        for (size_t j=0; data.valid && j < data.indices.size(); ++j)
+        {
+            data.valid = data.indices[j] < node.vertex_count;
+        }
+        return data;
+    });
+}
+
+void LodMesh::finish_loads()
+{
+    // Limit uploads per frame, so that streaming never causes a hitch
+    int uploads = 0;
+    for (auto itr = loading.begin(); itr != loading.end() &&
+                                     uploads < MAX_UPLOADS_PER_FRAME;)
+    {
+        if (itr->second.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+        {
+            ++itr;
+            continue;
+        }
+
+        const NodeData data = itr->second.get();
+        if (!data.valid)
+        {
+            corrupt.insert(itr->first);
+            itr = loading.erase(itr);
+            continue;
+        }
+        Resident r;
+        r.mesh = new GLMesh(data.vertices.data(), data.vertices.size() / 3,
+                            data.indices.data(), data.indices.size());
+        r.bytes = data.vertices.size() * sizeof(GLfloat) +
+                  data.indices.size() * sizeof(GLuint);
+        r.last_used = frame;
+        resident[itr->first] = r;
+        resident_bytes += r.bytes;
+
+        itr = loading.erase(itr);
+        uploads++;
+    }
+}
+
+void LodMesh::evict()
+{
+    // Drop least-recently-used nodes until under budget.  The root and
+    // anything drawn this frame always stay.
+    while (resident_bytes > VRAM_BUDGET)
+    {
+        auto oldest = resident.end();
+        for (auto itr = resident.begin(); itr != resident.end(); ++itr)
+        {
+            if (itr->first != 0 && itr->second.last_used != frame &&
+                (oldest == resident.end() ||
+                 itr->second.last_used < oldest->second.last_used))
+            {
+                oldest = itr;
+            }
+        }
+        if (oldest == resident.end())
+        {
+            break;
+        }
+        delete oldest->second.mesh;
+        resident_bytes -= oldest->second.bytes;
+        resident.erase(oldest);
+    }
+}
@@ -0,0 +1,99 @@
+#ifndef LODMESH_H
+#define LODMESH_H
+
+#include <QMatrix4x4>
+#include <QOpenGLFunctions>
+
+#include <future>
+#include <map>
+#include <set>
+#include <unordered_map>
+#include <vector>
+
+#include "lod.h"
+
+class GLMesh;
+
+/*
+ *  Draws a LOD file (see lod.h), streaming nodes in from disk as the
+ *  camera needs them and keeping at most VRAM_BUDGET bytes of them on
+ *  the GPU.  Nodes are loaded on worker threads; only the upload to GL
+ *  happens on the render thread.
+ */
+class LodMesh
+{
+public:
+    explicit LodMesh(const QString& filename);
+    ~LodMesh();
+
+    /*  Reads the header and node table.  On failure, returns false and
+     *  sets error. */
+    bool load(QString* error);
+
+    /*  Picks and draws the nodes whose error is below PIXEL_ERROR on
+     *  screen, falling back to coarser nodes while finer ones load.
+     *  pixel_scale converts model units at w = 1 to pixels.  Must be
+     *  called with a current GL context; returns true if nodes are still
+     *  loading, in which case the caller should draw again soon. */
+    bool draw(GLuint vp, const QMatrix4x4& mvp, float pixel_scale);
+
+    QVector3D lower() const;
+    QVector3D upper() const;
+    uint32_t triCount() const { return header.tri_count; }
+    uint32_t nodeCount() const { return header.node_count; }
+
+    // Number of nodes and triangles drawn in the last frame
+    int drawnNodes() const { return drawn_nodes; }
+    uint64_t drawnTriangles() const { return drawn_triangles; }
+
+    // Number of nodes that couldn't be read (or held out-of-range
+    // indices), which are never drawn
+    size_t corruptNodes() const { return corrupt.size(); }
+
+    const static float PIXEL_ERROR;
+    const static size_t VRAM_BUDGET;
+    const static int MAX_LOADS;
+    const static int MAX_UPLOADS_PER_FRAME;
+
+private:
+    struct NodeData
+    {
+        std::vector<GLfloat> vertices;
+        std::vector<GLuint> indices;
+        bool valid;
+    };
+    struct Resident
+    {
+        GLMesh* mesh;
+        size_t bytes;
+        uint64_t last_used;
+    };
+
+    void traverse(uint32_t i);
+    bool visible(const LodNode& node) const;
+    float screen_error(const LodNode& node) const;
+    void request(uint32_t i);
+    void finish_loads();
+    void evict();
+
+    const QString filename;
+    LodHeader header;
+    std::vector<LodNode> nodes;
+
+    std::unordered_map<uint32_t, Resident> resident;
+    std::map<uint32_t, std::future<NodeData>> loading;
+    std::set<uint32_t> corrupt;
+    size_t resident_bytes;
+
+    // State for the frame being drawn
+    uint64_t frame;
+    GLuint vertex_position;
+    QMatrix4x4 frame_mvp;
+    QVector4D planes[6];
+    float frame_pixel_scale;
+
+    int drawn_nodes;
+    uint64_t drawn_triangles;
+};
+
+#endif // LODMESH_H
@@ -1,13 +1,22 @@
 #include <QApplication>
 
 #include "app.h"
+#include "profile.h"
+#include "cli.h"
 
 int main(int argc, char *argv[])
 {
+    StartupProfile::start();
     QCoreApplication::setOrganizationName("fstl-app");
     QCoreApplication::setOrganizationDomain("https://github.com/fstl-app/fstl");
     QCoreApplication::setApplicationName("fstl");
     QCoreApplication::setApplicationVersion(FSTL_VERSION);
+
+    // Batch jobs (e.g. --build-lod) run without a window
+    const int batch_result = cli_run_batch(argc, argv);
+    if (batch_result >= 0)
+        return batch_result;
+
     App a(argc, argv);
     return a.exec();
 }
@@ -2,16 +2,234 @@
 #include <QDataStream>
 #include <QVector3D>
 
+#include <algorithm>
 #include <cmath>
 
 #include "mesh.h"
+#include "parallel.h"
 
 ////////////////////////////////////////////////////////////////////////////////
 
-Mesh::Mesh(std::vector<GLfloat>&& v, std::vector<GLuint>&& i)
-    : vertices(std::move(v)), indices(std::move(i))
+const GLuint Mesh::CLUSTER_TRIANGLES;
+const GLfloat Mesh::NO_CONE = 2;
+
+Mesh::Mesh(std::vector<GLfloat>&& v, std::vector<GLuint>&& i,
+           std::vector<GLuint>&& c, std::vector<GLfloat>&& n,
+           int repairs)
+    : vertices(std::move(v)), indices(std::move(i)),
+      has_facet_normals(false), flipped_normals(0), missing_normals(0),
+      checked_winding(repairs & FIX_WINDING), winding_report(),
+      filled_holes(repairs & FILL_HOLES), hole_report(),
+      has_oriented_box(false), oriented_box(),
+      has_print_orientation(false), print_orientation(),
+      curvature_field(), content_fingerprint(0),
+      face_colors(std::move(c))
+{
+    // Repairing first means that facet normals are checked against the
+    // corrected triangles
+    const size_t tri_count = indices.size() / 3;
+    if (checked_winding)
+    {
+        winding_report = orient_shells(vertices, indices);
+    }
+    if (filled_holes)
+    {
+        hole_report = fill_holes(vertices, indices);
+    }
+
+    // Patches get the default colour, and their own normals
+    if (!face_colors.empty())
+    {
+        face_colors.resize(indices.size() / 3, 0);
+    }
+    if (!n.empty() && n.size() == tri_count * 3)
+    {
+        for (size_t t=tri_count; t < indices.size() / 3; ++t)
+        {
+            const GLfloat* p0 = &vertices[indices[t*3] * 3];
+            const GLfloat* p1 = &vertices[indices[t*3 + 1] * 3];
+            const GLfloat* p2 = &vertices[indices[t*3 + 2] * 3];
+            const QVector3D normal = QVector3D::normal(
+                    QVector3D(p0[0], p0[1], p0[2]),
+                    QVector3D(p1[0], p1[1], p1[2]),
+                    QVector3D(p2[0], p2[1], p2[2]));
+            n.insert(n.end(), {normal.x(), normal.y(), normal.z()});
+        }
+    }
+    build_cluster_bounds();
+    if (!n.empty() && n.size() == indices.size())
+    {
+        check_facet_normals(n);
+    }
+}
+
+void Mesh::check_facet_normals(const std::vector<GLfloat>& face_normals)
+{
+    const size_t tri_count = indices.size() / 3;
+    const size_t cluster_count = (tri_count + CLUSTER_TRIANGLES - 1) / CLUSTER_TRIANGLES;
+    cluster_cones.resize(cluster_count * 4);
+
+    const unsigned workers = worker_count();
+    std::vector<size_t> flipped(workers, 0), missing(workers, 0);
+
+    parallel_for(cluster_count, [&](size_t begin, size_t end, size_t w)
+    {
+        // Triangles are gathered into structure-of-arrays blocks, so that
+        // the arithmetic below is a straight, branch-free loop that the
+        // compiler can vectorize for whatever the target's SIMD width is.
+        GLfloat ax[CLUSTER_TRIANGLES], ay[CLUSTER_TRIANGLES], az[CLUSTER_TRIANGLES];
+        GLfloat bx[CLUSTER_TRIANGLES], by[CLUSTER_TRIANGLES], bz[CLUSTER_TRIANGLES];
+        GLfloat nx[CLUSTER_TRIANGLES], ny[CLUSTER_TRIANGLES], nz[CLUSTER_TRIANGLES];
+        GLfloat winding[CLUSTER_TRIANGLES], length2[CLUSTER_TRIANGLES];
+
+        for (size_t c=begin; c < end; ++c)
+        {
+            const size_t first = c * CLUSTER_TRIANGLES;
+            const size_t n = std::min<size_t>(CLUSTER_TRIANGLES, tri_count - first);
+            for (size_t t=0; t < n; ++t)
+            {
+                const GLuint* tri = &indices[(first + t) * 3];
+                const GLfloat* p0 = &vertices[tri[0] * 3];
+                const GLfloat* p1 = &vertices[tri[1] * 3];
+                const GLfloat* p2 = &vertices[tri[2] * 3];
+                ax[t] = p1[0] - p0[0]; ay[t] = p1[1] - p0[1]; az[t] = p1[2] - p0[2];
+                bx[t] = p2[0] - p0[0]; by[t] = p2[1] - p0[1]; bz[t] = p2[2] - p0[2];
+                const GLfloat* f = &face_normals[(first + t) * 3];
+                nx[t] = f[0]; ny[t] = f[1]; nz[t] = f[2];
+            }
+
+            // Sign of the file normal against the winding's cross product
+            for (size_t t=0; t < n; ++t)
+            {
+                const GLfloat cx = ay[t]*bz[t] - az[t]*by[t];
+                const GLfloat cy = az[t]*bx[t] - ax[t]*bz[t];
+                const GLfloat cz = ax[t]*by[t] - ay[t]*bx[t];
+                winding[t] = nx[t]*cx + ny[t]*cy + nz[t]*cz;
+                length2[t] = nx[t]*nx[t] + ny[t]*ny[t] + nz[t]*nz[t];
+            }
+
+            // Count problems, and build the cone around the normals of
+            // clusters that have none
+            bool trusted = true;
+            QVector3D axis;
+            for (size_t t=0; t < n; ++t)
+            {
+                // Written so that NaN normals count as missing
+                if (!(length2[t] > 1e-12f))
+                {
+                    missing[w]++;
+                    trusted = false;
+                }
+                else if (winding[t] < 0)
+                {
+                    flipped[w]++;
+                    trusted = false;
+                }
+                else
+                {
+                    axis += QVector3D(nx[t], ny[t], nz[t]) / sqrt(length2[t]);
+                }
+            }
+
+            GLfloat* cone = &cluster_cones[c * 4];
+            cone[3] = NO_CONE;
+            if (!trusted || axis.length() < 1e-6f)
+            {
+                continue;
+            }
+            axis.normalize();
+            GLfloat min_cos = 1;
+            for (size_t t=0; t < n; ++t)
+            {
+                min_cos = fmin(min_cos, (nx[t]*axis.x() + ny[t]*axis.y() + nz[t]*axis.z())
+                                        / sqrt(length2[t]));
+            }
+            cone[0] = axis.x();
+            cone[1] = axis.y();
+            cone[2] = axis.z();
+            if (min_cos > 0)
+            {
+                cone[3] = sqrt(1 - min_cos*min_cos);
+            }
+        }
+    });
+
+    for (unsigned w=0; w < workers; ++w)
+    {
+        flipped_normals += flipped[w];
+        missing_normals += missing[w];
+    }
+    has_facet_normals = true;
+}
+
+void Mesh::measure_oriented_box()
 {
-    // Nothing to do here
+    oriented_box = min_oriented_box(vertices, convex_hull(vertices));
+    has_oriented_box = true;
+}
+
+void Mesh::orient_for_printing(int candidates)
+{
+    print_orientation = find_print_orientation(vertices, indices, candidates);
+    has_print_orientation = true;
+}
+
+void Mesh::measure_curvature()
+{
+    curvature_field = estimate_curvature(vertices, indices);
+}
+
+ShapeSignature Mesh::signature() const
+{
+    return shape_signature(vertices, indices);
+}
+
+QualityReport Mesh::quality() const
+{
+    return measure_quality(vertices, indices);
+}
+
+QImage Mesh::preview(int size) const
+{
+    return render_preview(vertices, indices, face_colors, size);
+}
+
+void Mesh::build_cluster_bounds()
+{
+    const size_t tri_count = indices.size() / 3;
+    const size_t cluster_count = (tri_count + CLUSTER_TRIANGLES - 1) / CLUSTER_TRIANGLES;
+    cluster_bounds.resize(cluster_count * 4);
+
+    // Each cluster gets the sphere around its bounding box, which is
+    // cheap and tight enough for culling.
+    parallel_for(cluster_count, [&](size_t begin, size_t end, size_t)
+    {
+        for (size_t c=begin; c < end; ++c)
+        {
+            const size_t first = c * CLUSTER_TRIANGLES * 3;
+            const size_t last = std::min(first + CLUSTER_TRIANGLES * 3, indices.size());
+
+            const GLfloat* p = &vertices[indices[first] * 3];
+            QVector3D lower(p[0], p[1], p[2]);
+            QVector3D upper = lower;
+            for (size_t i=first; i < last; ++i)
+            {
+                p = &vertices[indices[i] * 3];
+                for (int j=0; j < 3; ++j)
+                {
+                    lower[j] = fmin(lower[j], p[j]);
+                    upper[j] = fmax(upper[j], p[j]);
+                }
+            }
+
+            const QVector3D center = (lower + upper) / 2;
+            GLfloat* b = &cluster_bounds[c * 4];
+            b[0] = center.x();
+            b[1] = center.y();
+            b[2] = center.z();
+            b[3] = (upper - center).length();
+        }
+    });
 }
 
 float Mesh::min(size_t start) const
@@ -6,10 +6,24 @@
 
 #include <vector>
 
+#include "curvature.h"
+#include "hull.h"
+#include "orient.h"
+#include "preview.h"
+#include "quality.h"
+#include "signature.h"
+#include "topology.h"
+
 class Mesh
 {
 public:
-    Mesh(std::vector<GLfloat>&& vertices, std::vector<GLuint>&& indices);
+    Mesh(std::vector<GLfloat>&& vertices, std::vector<GLuint>&& indices,
+         std::vector<GLuint>&& face_colors=std::vector<GLuint>(),
+         std::vector<GLfloat>&& face_normals=std::vector<GLfloat>(),
+         int repairs=0);
+
+    // Repairs that can be applied (in this order) when building a mesh
+    enum Repair { FIX_WINDING = 1, FILL_HOLES = 2 };
 
     float min(size_t start) const;
     float max(size_t start) const;
@@ -23,12 +37,97 @@ public:
 
     int triCount() const;
     bool empty() const;
+    bool hasColors() const { return !face_colors.empty(); }
+
+    // Raw geometry: xyz per vertex, three indices per triangle, and the
+    // per-triangle colours (empty without hasColors)
+    const std::vector<GLfloat>& vertexData() const { return vertices; }
+    const std::vector<GLuint>& indexData() const { return indices; }
+    const std::vector<GLuint>& faceColors() const { return face_colors; }
+
+    // Results of checking the facet normals from the file (if they were
+    // loaded) against the winding of each triangle
+    bool hasFacetNormals() const { return has_facet_normals; }
+    size_t flippedNormals() const { return flipped_normals; }
+    size_t missingNormals() const { return missing_normals; }
+
+    // Result of making the winding consistent (if it was requested)
+    bool checkedWinding() const { return checked_winding; }
+    const WindingReport& winding() const { return winding_report; }
+    bool filledHoles() const { return filled_holes; }
+    const HoleReport& holes() const { return hole_report; }
+
+    /*  Finds a minimum-volume box around the mesh (see hull.h) */
+    void measure_oriented_box();
+    bool hasOrientedBox() const { return has_oriented_box; }
+    const OrientedBox& orientedBox() const { return oriented_box; }
+
+    /*  Searches for the best direction to print in (see orient.h) */
+    void orient_for_printing(int candidates=512);
+    bool hasPrintOrientation() const { return has_print_orientation; }
+    const PrintOrientation& printOrientation() const { return print_orientation; }
+
+    /*  Estimates the curvature at each vertex (see curvature.h) */
+    void measure_curvature();
+    bool hasCurvature() const { return !curvature_field.values.empty(); }
+    const CurvatureField& curvature() const { return curvature_field; }
+
+    /*  Hash of the file the mesh was loaded from (see ContentHash), or 0
+     *  for meshes that aren't a whole file */
+    quint64 fingerprint() const { return content_fingerprint; }
+
+    /*  Pose-invariant summary of the shape (see signature.h) */
+    ShapeSignature signature() const;
+
+    /*  Histograms of edge lengths, aspect ratios and dihedral angles
+     *  (see quality.h) */
+    QualityReport quality() const;
+
+    /*  Small shaded picture of the mesh (see preview.h) */
+    QImage preview(int size) const;
+
+    // Triangles are grouped into clusters of this size for culling
+    const static GLuint CLUSTER_TRIANGLES = 256;
+
+    // Sine of the half-angle stored for clusters whose normals can't be
+    // trusted, which no backface test can pass
+    const static GLfloat NO_CONE;
 
 private:
+    void build_cluster_bounds();
+    void check_facet_normals(const std::vector<GLfloat>& face_normals);
+
     std::vector<GLfloat> vertices;
     std::vector<GLuint> indices;
 
+    // Bounding sphere (x, y, z, radius) of each cluster
+    std::vector<GLfloat> cluster_bounds;
+
+    // Cone (axis xyz, sine of half-angle) containing the facet normals
+    // of each cluster, for backface culling; empty without facet normals
+    std::vector<GLfloat> cluster_cones;
+    bool has_facet_normals;
+    size_t flipped_normals;
+    size_t missing_normals;
+
+    bool checked_winding;
+    WindingReport winding_report;
+    bool filled_holes;
+    HoleReport hole_report;
+    bool has_oriented_box;
+    OrientedBox oriented_box;
+    bool has_print_orientation;
+    PrintOrientation print_orientation;
+    CurvatureField curvature_field;
+    quint64 content_fingerprint;
+
+    // RGBA8 colour of each triangle (alpha 0 for the default colour),
+    // or empty if the file has no colours
+    std::vector<GLuint> face_colors;
+
     friend class GLMesh;
+    friend class Loader;
+    friend class VoxelGrid;
 };
 
 #endif // MESH_H
@@ -0,0 +1,220 @@
+#include <algorithm>
+#include <cmath>
+
+#include "orient.h"
+#include "hull.h"
+#include "parallel.h"
+
+// Triangles are scored in blocks of this size, with running sums split
+// over this many lanes so that the inner loop vectorizes
+static const size_t BLOCK_TRIANGLES = 256;
+static const size_t LANES = 8;
+
+// Largest hull faces that are tried as the base
+static const size_t HULL_CANDIDATES = 64;
+
+// Faces this close to the plate (relative to the mesh's size) rest on it
+static const float PLATE_TOLERANCE = 1e-3f;
+
+// Weights of overhang area (relative to total area), support volume
+// (relative to total area times size) and height (relative to size)
+static const float OVERHANG_WEIGHT = 1;
+static const float SUPPORT_WEIGHT = 1;
+static const float HEIGHT_WEIGHT = 0.25f;
+
+PrintOrientation find_print_orientation(const std::vector<GLfloat>& vertices,
+                                        const std::vector<GLuint>& indices,
+                                        int candidates)
+{
+    auto point = [&](GLuint i)
+    {
+        return QVector3D(vertices[i*3], vertices[i*3 + 1], vertices[i*3 + 2]);
+    };
+
+    // Directions spread evenly over the sphere on a Fibonacci spiral, plus
+    // the axes, so that a part that is already square gets tried as it is
+    std::vector<QVector3D> ups;
+    const float golden = M_PI * (3 - sqrt(5));
+    for (int i=0; i < candidates; ++i)
+    {
+        const float z = 1 - (2 * i + 1) / float(candidates);
+        const float r = sqrt(1 - z * z);
+        ups.push_back(QVector3D(r * cos(golden * i), r * sin(golden * i), z));
+    }
+    for (int j=0; j < 3; ++j)
+    {
+        QVector3D axis;
+        axis[j] = 1;
+        ups.push_back(axis);
+        ups.push_back(-axis);
+    }
+
+    // Parts tend to print best resting on a large flat face, and the
+    // hull's faces are the ones that they can rest on
+    const std::vector<GLuint> hull = convex_hull(vertices);
+    std::vector<std::pair<float, QVector3D>> faces;
+    for (size_t t=0; t < hull.size(); t += 3)
+    {
+        const QVector3D a = point(hull[t]);
+        const QVector3D cross = QVector3D::crossProduct(point(hull[t + 1]) - a,
+                                                        point(hull[t + 2]) - a);
+        const float area = cross.length();
+        if (area > 0)
+        {
+            faces.push_back({area, -cross / area});
+        }
+    }
+    const size_t hull_candidates = std::min(faces.size(), HULL_CANDIDATES);
+    std::partial_sort(faces.begin(), faces.begin() + hull_candidates, faces.end(),
+        [](const std::pair<float, QVector3D>& a, const std::pair<float, QVector3D>& b)
+        {
+            return a.first > b.first;
+        });
+    for (size_t i=0; i < hull_candidates; ++i)
+    {
+        ups.push_back(faces[i].second);
+    }
+
+    // The plate and the top of the build are found from the hull's corners
+    // (or every vertex, for flat meshes that have no hull)
+    std::vector<GLuint> corners(hull);
+    if (corners.empty())
+    {
+        corners.resize(vertices.size() / 3);
+        for (size_t i=0; i < corners.size(); ++i)
+        {
+            corners[i] = i;
+        }
+    }
+    std::sort(corners.begin(), corners.end());
+    corners.erase(std::unique(corners.begin(), corners.end()), corners.end());
+
+    const size_t count = ups.size();
+    std::vector<float> base(count), top(count);
+    parallel_for(count, [&](size_t begin, size_t end, size_t)
+    {
+        for (size_t k=begin; k < end; ++k)
+        {
+            base[k] = INFINITY;
+            top[k] = -INFINITY;
+            for (GLuint c : corners)
+            {
+                const float d = QVector3D::dotProduct(point(c), ups[k]);
+                base[k] = fmin(base[k], d);
+                top[k] = fmax(top[k], d);
+            }
+        }
+    });
+    float size = 0;
+    for (size_t k=0; k < count; ++k)
+    {
+        size = fmax(size, top[k] - base[k]);
+    }
+
+    // Each worker sums overhang area and support volume per candidate over
+    // its share of the triangles
+    const size_t tri_count = indices.size() / 3;
+    const size_t block_count = (tri_count + BLOCK_TRIANGLES - 1) / BLOCK_TRIANGLES;
+    const unsigned workers = worker_count();
+    std::vector<std::vector<double>> overhang(workers, std::vector<double>(count));
+    std::vector<std::vector<double>> support(workers, std::vector<double>(count));
+    std::vector<double> total_area(workers, 0);
+
+    const float threshold = -cos(OVERHANG_ANGLE * M_PI / 180);
+    const float plate = PLATE_TOLERANCE * size;
+    parallel_for(block_count, [&](size_t begin, size_t end, size_t w)
+    {
+        // Structure-of-arrays block, padded with zero-area triangles
+        GLfloat nx[BLOCK_TRIANGLES], ny[BLOCK_TRIANGLES], nz[BLOCK_TRIANGLES];
+        GLfloat cx[BLOCK_TRIANGLES], cy[BLOCK_TRIANGLES], cz[BLOCK_TRIANGLES];
+        GLfloat area[BLOCK_TRIANGLES];
+
+        for (size_t b=begin; b < end; ++b)
+        {
+            const size_t first = b * BLOCK_TRIANGLES;
+            const size_t n = std::min(BLOCK_TRIANGLES, tri_count - first);
+            for (size_t t=0; t < BLOCK_TRIANGLES; ++t)
+            {
+                area[t] = 0;
+                nx[t] = ny[t] = nz[t] = cx[t] = cy[t] = cz[t] = 0;
+                if (t >= n)
+                {
+                    continue;
+                }
+                const GLuint* tri = &indices[(first + t) * 3];
+                const QVector3D p0 = point(tri[0]);
+                const QVector3D p1 = point(tri[1]);
+                const QVector3D p2 = point(tri[2]);
+                const QVector3D cross = QVector3D::crossProduct(p1 - p0, p2 - p0);
+                const float length = cross.length();
+                if (length > 0)
+                {
+                    const QVector3D centroid = (p0 + p1 + p2) / 3;
+                    area[t] = length / 2;
+                    nx[t] = cross.x() / length;
+                    ny[t] = cross.y() / length;
+                    nz[t] = cross.z() / length;
+                    cx[t] = centroid.x();
+                    cy[t] = centroid.y();
+                    cz[t] = centroid.z();
+                    total_area[w] += area[t];
+                }
+            }
+
+            for (size_t k=0; k < count; ++k)
+            {
+                const float ux = ups[k].x(), uy = ups[k].y(), uz = ups[k].z();
+                const float floor = base[k] + plate;
+                float o[LANES] = {0}, s[LANES] = {0};
+                for (size_t t=0; t < BLOCK_TRIANGLES; t += LANES)
+                {
+                    for (size_t l=0; l < LANES; ++l)
+                    {
+                        const float dn = nx[t + l]*ux + ny[t + l]*uy + nz[t + l]*uz;
+                        const float h = cx[t + l]*ux + cy[t + l]*uy + cz[t + l]*uz;
+                        const float a = (dn < threshold) * (h > floor) * area[t + l];
+                        o[l] += a;
+                        s[l] -= a * dn * (h - base[k]);
+                    }
+                }
+                for (size_t l=0; l < LANES; ++l)
+                {
+                    overhang[w][k] += o[l];
+                    support[w][k] += s[l];
+                }
+            }
+        }
+    });
+
+    double area = 0;
+    for (unsigned w=0; w < workers; ++w)
+    {
+        area += total_area[w];
+    }
+
+    PrintOrientation best;
+    best.score = INFINITY;
+    for (size_t k=0; k < count; ++k)
+    {
+        double o = 0, s = 0;
+        for (unsigned w=0; w < workers; ++w)
+        {
+            o += overhang[w][k];
+            s += support[w][k];
+        }
+        const float height = top[k] - base[k];
+        const float score = area > 0 && size > 0
+            ? OVERHANG_WEIGHT * o / area + SUPPORT_WEIGHT * s / (area * size) +
+              HEIGHT_WEIGHT * height / size
+            : height;
+        if (score < best.score)
+        {
+            best.up = ups[k];
+            best.overhang_area = o;
+            best.support_volume = s;
+            best.height = height;
+            best.score = score;
+        }
+    }
+    return best;
+}
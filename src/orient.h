@@ -0,0 +1,42 @@
+#ifndef ORIENT_H
+#define ORIENT_H
+
+#include <QQuaternion>
+#include <QVector3D>
+#include <QtOpenGL/QtOpenGL>
+
+#include <vector>
+
+/*  A build direction for printing, and how it scores */
+struct PrintOrientation
+{
+    QVector3D up;           // Model-space direction that points up the build
+
+    float overhang_area;    // Area of faces that need support
+    float support_volume;   // Volume between those faces and the plate
+    float height;           // Build height
+    float score;            // Weighted sum of the above (lower is better)
+
+    /*  Rotation that turns up to +z */
+    QQuaternion rotation() const
+    {
+        return QQuaternion::rotationTo(up, QVector3D(0, 0, 1));
+    }
+};
+
+/*  Scores candidate build directions (spread over the sphere, plus the
+ *  largest faces of the convex hull turned down onto the plate) and
+ *  returns the best.  Downward faces tilted less than OVERHANG_ANGLE from
+ *  horizontal need support, unless they lie on the plate; support
+ *  volume is estimated as each such face's projected area times its
+ *  height above the plate.  Triangles are gathered in blocks, and every
+ *  candidate is scored against each block while it is in cache, with
+ *  blocks split between threads. */
+PrintOrientation find_print_orientation(const std::vector<GLfloat>& vertices,
+                                        const std::vector<GLuint>& indices,
+                                        int candidates=512);
+
+// Steepest overhang that needs support, in degrees from horizontal
+const float OVERHANG_ANGLE = 45;
+
+#endif // ORIENT_H
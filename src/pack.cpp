@@ -0,0 +1,279 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+
+#include "pack.h"
+#include "hull.h"
+#include "parallel.h"
+
+namespace {
+
+struct Bounds
+{
+    QVector2D lower, upper;
+};
+
+/*  Convex hull of points in the plane (Andrew's monotone chain) */
+Footprint convex_polygon(std::vector<QVector2D> points)
+{
+    std::sort(points.begin(), points.end(), [](const QVector2D& a, const QVector2D& b)
+    {
+        return a.x() < b.x() || (a.x() == b.x() && a.y() < b.y());
+    });
+    points.erase(std::unique(points.begin(), points.end()), points.end());
+    if (points.size() < 3)
+    {
+        return points;
+    }
+
+    auto cross = [](const QVector2D& o, const QVector2D& a, const QVector2D& b)
+    {
+        return (a.x() - o.x()) * (b.y() - o.y()) - (a.y() - o.y()) * (b.x() - o.x());
+    };
+    Footprint hull(2 * points.size());
+    size_t k = 0;
+    for (size_t i=0; i < points.size(); ++i)
+    {
+        while (k >= 2 && cross(hull[k - 2], hull[k - 1], points[i]) <= 0) k--;
+        hull[k++] = points[i];
+    }
+    for (size_t i=points.size() - 1, t=k + 1; i > 0; --i)
+    {
+        while (k >= t && cross(hull[k - 2], hull[k - 1], points[i - 1]) <= 0) k--;
+        hull[k++] = points[i - 1];
+    }
+    hull.resize(k - 1);
+    return hull;
+}
+
+Bounds bounds(const Footprint& f)
+{
+    Bounds b = {QVector2D(INFINITY, INFINITY), QVector2D(-INFINITY, -INFINITY)};
+    for (const auto& p : f)
+    {
+        b.lower = QVector2D(fmin(b.lower.x(), p.x()), fmin(b.lower.y(), p.y()));
+        b.upper = QVector2D(fmax(b.upper.x(), p.x()), fmax(b.upper.y(), p.y()));
+    }
+    return b;
+}
+
+float area(const Footprint& f)
+{
+    float a = 0;
+    for (size_t i=0; i < f.size(); ++i)
+    {
+        const QVector2D& p = f[i];
+        const QVector2D& q = f[(i + 1) % f.size()];
+        a += p.x() * q.y() - q.x() * p.y();
+    }
+    return a / 2;
+}
+
+Footprint turned(const Footprint& f, float degrees)
+{
+    const float c = cos(degrees * M_PI / 180);
+    const float s = sin(degrees * M_PI / 180);
+    Footprint out;
+    for (const auto& p : f)
+    {
+        out.push_back(QVector2D(c * p.x() - s * p.y(), s * p.x() + c * p.y()));
+    }
+    return out;
+}
+
+/*  Separating axis test: whether a (moved by offset) and b are at least
+ *  gap apart along the normal of one of their edges */
+bool separated(const Footprint& a, const QVector2D& offset,
+               const Footprint& b, float gap)
+{
+    for (int pass=0; pass < 2; ++pass)
+    {
+        const Footprint& f = pass ? b : a;
+        for (size_t i=0; i < f.size(); ++i)
+        {
+            const QVector2D edge = f[(i + 1) % f.size()] - f[i];
+            const QVector2D normal = QVector2D(edge.y(), -edge.x()).normalized();
+            float a_lo = INFINITY, a_hi = -INFINITY, b_lo = INFINITY, b_hi = -INFINITY;
+            for (const auto& p : a)
+            {
+                const float d = QVector2D::dotProduct(p + offset, normal);
+                a_lo = fmin(a_lo, d);
+                a_hi = fmax(a_hi, d);
+            }
+            for (const auto& p : b)
+            {
+                const float d = QVector2D::dotProduct(p, normal);
+                b_lo = fmin(b_lo, d);
+                b_hi = fmax(b_hi, d);
+            }
+            if (b_lo - a_hi >= gap || a_lo - b_hi >= gap)
+            {
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+}   // anonymous namespace
+
+////////////////////////////////////////////////////////////////////////////////
+
+Footprint footprint(const std::vector<GLfloat>& vertices)
+{
+    // Only the hull's corners can be on the outline (but flat meshes have
+    // no hull, so use every vertex)
+    std::vector<GLuint> corners = convex_hull(vertices);
+    if (corners.empty())
+    {
+        corners.resize(vertices.size() / 3);
+        for (size_t i=0; i < corners.size(); ++i)
+        {
+            corners[i] = i;
+        }
+    }
+    std::vector<QVector2D> points;
+    points.reserve(corners.size());
+    for (GLuint c : corners)
+    {
+        points.push_back(QVector2D(vertices[c*3], vertices[c*3 + 1]));
+    }
+    return convex_polygon(points);
+}
+
+std::vector<Placement> pack_footprints(const std::vector<Footprint>& parts,
+                                       float width, float spacing,
+                                       QVector2D* size)
+{
+    const size_t count = parts.size();
+    std::vector<Placement> placements(count);
+
+    // Each part's outline at each turn, and where its bounds start
+    std::vector<std::vector<Footprint>> shapes(count);
+    std::vector<std::vector<QVector2D>> origins(count);
+    std::vector<int> narrowest_turn(count, 0);
+    float total_area = 0, min_width = 0;
+    for (size_t i=0; i < count; ++i)
+    {
+        float narrowest = INFINITY;
+        for (int r=0; r < PACK_ROTATIONS; ++r)
+        {
+            Footprint f = turned(parts[i], r * 360.0f / PACK_ROTATIONS);
+            const Bounds b = bounds(f);
+            for (auto& p : f)
+            {
+                p -= b.lower;
+            }
+            shapes[i].push_back(f);
+            origins[i].push_back(b.lower);
+            if (b.upper.x() - b.lower.x() < narrowest)
+            {
+                narrowest = b.upper.x() - b.lower.x();
+                narrowest_turn[i] = r;
+            }
+        }
+        total_area += area(parts[i]) + spacing * spacing;
+        min_width = fmax(min_width, narrowest);
+    }
+    if (width <= 0)
+    {
+        width = sqrt(total_area * 1.5f);
+    }
+    width = fmax(width, min_width);
+
+    std::vector<size_t> order(count);
+    for (size_t i=0; i < count; ++i)
+    {
+        order[i] = i;
+    }
+    std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b)
+    {
+        return area(parts[a]) > area(parts[b]);
+    });
+
+    // Placed outlines, and the spots next to them where a part can go
+    std::vector<Footprint> placed;
+    std::vector<Bounds> boxes;
+    std::vector<QVector2D> spots = {QVector2D(0, 0)};
+    QVector2D used(0, 0);
+
+    const unsigned workers = worker_count();
+    for (size_t i : order)
+    {
+        // Each worker keeps its lowest, then leftmost, fit
+        std::vector<std::pair<float, float>> best(workers, {INFINITY, INFINITY});
+        std::vector<size_t> choice(workers, SIZE_MAX);
+        parallel_for(spots.size() * PACK_ROTATIONS, [&](size_t begin, size_t end, size_t w)
+        {
+            for (size_t t=begin; t < end; ++t)
+            {
+                const QVector2D spot = spots[t / PACK_ROTATIONS];
+                const Footprint& shape = shapes[i][t % PACK_ROTATIONS];
+                const Bounds b = bounds(shape);
+                const Bounds box = {spot, spot + b.upper};
+                const std::pair<float, float> score(box.upper.y(), box.upper.x());
+                if (box.upper.x() > width || !(score < best[w]))
+                {
+                    continue;
+                }
+
+                bool fits = true;
+                for (size_t j=0; j < placed.size() && fits; ++j)
+                {
+                    const Bounds& p = boxes[j];
+                    if (box.lower.x() < p.upper.x() + spacing &&
+                        p.lower.x() < box.upper.x() + spacing &&
+                        box.lower.y() < p.upper.y() + spacing &&
+                        p.lower.y() < box.upper.y() + spacing)
+                    {
+                        fits = separated(shape, spot, placed[j], spacing);
+                    }
+                }
+                if (fits)
+                {
+                    best[w] = score;
+                    choice[w] = t;
+                }
+            }
+        });
+
+        // There's always room at the left edge above everything else, for
+        // the part's narrowest turn (which the width was made to fit)
+        const size_t w = std::min_element(best.begin(), best.end()) - best.begin();
+        const size_t t = choice[w] != SIZE_MAX ? choice[w] : narrowest_turn[i];
+        const QVector2D spot = choice[w] != SIZE_MAX
+            ? spots[t / PACK_ROTATIONS]
+            : QVector2D(0, boxes.empty() ? 0 : used.y() + spacing);
+        const int r = t % PACK_ROTATIONS;
+
+        placements[i].angle = r * 360.0f / PACK_ROTATIONS;
+        placements[i].offset = spot - origins[i][r];
+
+        Footprint f = shapes[i][r];
+        for (auto& p : f)
+        {
+            p += spot;
+        }
+        const Bounds box = bounds(f);
+        placed.push_back(f);
+        boxes.push_back(box);
+        used = QVector2D(fmax(used.x(), box.upper.x()), fmax(used.y(), box.upper.y()));
+
+        // New spots to the right of and above the part, and past the left
+        // edge above it; spots now under the part are dropped
+        spots.erase(std::remove_if(spots.begin(), spots.end(), [&](const QVector2D& s)
+        {
+            return s.x() >= box.lower.x() && s.x() < box.upper.x() &&
+                   s.y() >= box.lower.y() && s.y() < box.upper.y();
+        }), spots.end());
+        spots.push_back(QVector2D(box.upper.x() + spacing, box.lower.y()));
+        spots.push_back(QVector2D(box.lower.x(), box.upper.y() + spacing));
+        spots.push_back(QVector2D(0, box.upper.y() + spacing));
+    }
+
+    if (size)
+    {
+        *size = used;
+    }
+    return placements;
+}
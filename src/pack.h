@@ -0,0 +1,37 @@
+#ifndef PACK_H
+#define PACK_H
+
+#include <QVector2D>
+#include <QtOpenGL/QtOpenGL>
+
+#include <vector>
+
+/*  Outline of a part seen from above, as a convex polygon in xy with its
+ *  corners counter-clockwise */
+typedef std::vector<QVector2D> Footprint;
+
+/*  Footprint of a point set, from the shadow of its convex hull */
+Footprint footprint(const std::vector<GLfloat>& vertices);
+
+/*  Where a part goes on the plate: turned by angle (in degrees, about the
+ *  z axis), then moved by offset */
+struct Placement
+{
+    float angle;
+    QVector2D offset;
+};
+
+/*  Packs footprints onto a plate that is width wide (or about square, if
+ *  width is 0) and as short in y as it can manage, leaving spacing between
+ *  parts.  Parts go in largest first, each at the lowest (then leftmost)
+ *  free spot next to the parts already placed, trying PACK_ROTATIONS turns;
+ *  the spots are tried in parallel.  Returns a placement per footprint,
+ *  and sets size to the area of the plate that was used. */
+std::vector<Placement> pack_footprints(const std::vector<Footprint>& parts,
+                                       float width, float spacing,
+                                       QVector2D* size=nullptr);
+
+// Turns (evenly spaced through a full circle) tried for each part
+const int PACK_ROTATIONS = 8;
+
+#endif // PACK_H
@@ -0,0 +1,44 @@
+#ifndef PARALLEL_H
+#define PARALLEL_H
+
+#include <algorithm>
+#include <future>
+#include <thread>
+#include <vector>
+
+/*  Returns the number of threads to split parallel work between */
+inline unsigned worker_count()
+{
+    // Check how many threads the hardware can safely support. This may
+    // return 0 if the property can't be read so we should check for that too.
+    const unsigned threads = std::thread::hardware_concurrency();
+    return threads ? threads : 8;
+}
+
+/*  Splits [0, n) into one contiguous range per worker and calls
+ *  f(begin, end, worker) on each range in parallel, returning once
+ *  all of them are done.  If any call throws, the first exception is
+ *  rethrown (after every range has finished). */
+template <typename F>
+void parallel_for(size_t n, F f)
+{
+    const size_t per_worker = (n + worker_count() - 1) / worker_count();
+    std::vector<std::future<void>> futures;
+    size_t worker = 0;
+    for (size_t begin=0; begin < n; begin += per_worker)
+    {
+        futures.push_back(std::async(std::launch::async, f, begin,
+                                     std::min(begin + per_worker, n),
+                                     worker++));
+    }
+    for (auto& future : futures)
+    {
+        future.wait();
+    }
+    for (auto& future : futures)
+    {
+        future.get();
+    }
+}
+
+#endif // PARALLEL_H
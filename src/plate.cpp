@@ -0,0 +1,140 @@
+#include <QHash>
+
+#include <cmath>
+
+#include "plate.h"
+#include "loader.h"
+#include "mesh.h"
+#include "pack.h"
+#include "parallel.h"
+
+const float PlateLoader::SPACING = 0.1f;
+
+PlateLoader::PlateLoader(QObject* parent, const QStringList& filenames)
+    : QThread(parent), filenames(filenames)
+{
+    // Nothing to do here
+}
+
+Plate::~Plate()
+{
+    for (Mesh* m : parts)
+    {
+        delete m;
+    }
+}
+
+void PlateLoader::run()
+{
+    // Files are loaded one at a time, since loading is itself parallel.
+    // A file given more than once is loaded once and placed repeatedly.
+    Plate* plate = new Plate;
+    std::vector<size_t> copies;
+    QHash<QString, size_t> loaded;
+    QStringList errors;
+    for (const auto& filename : filenames)
+    {
+        const auto found = loaded.find(filename);
+        if (found != loaded.end())
+        {
+            copies.push_back(found.value());
+            continue;
+        }
+        QString error;
+        Mesh* m = Loader::load_now(filename, &error);
+        if (m)
+        {
+            loaded.insert(filename, plate->parts.size());
+            copies.push_back(plate->parts.size());
+            plate->parts.push_back(m);
+        }
+        else
+        {
+            errors << error;
+        }
+    }
+    if (copies.empty())
+    {
+        delete plate;
+        emit error_parts(errors.join("\n"));
+        return;
+    }
+
+    const std::vector<Mesh*>& parts = plate->parts;
+    std::vector<Footprint> footprints(parts.size());
+    parallel_for(parts.size(), [&](size_t begin, size_t end, size_t)
+    {
+        for (size_t i=begin; i < end; ++i)
+        {
+            footprints[i] = footprint(parts[i]->vertexData());
+        }
+    });
+
+    const size_t count = copies.size();
+    std::vector<Footprint> placed(count);
+    float area = 0;
+    for (size_t i=0; i < count; ++i)
+    {
+        const Footprint& f = footprints[copies[i]];
+        for (size_t j=0; j < f.size(); ++j)
+        {
+            const QVector2D& p = f[j];
+            const QVector2D& q = f[(j + 1) % f.size()];
+            area += (p.x() * q.y() - q.x() * p.y()) / 2;
+        }
+        placed[i] = f;
+    }
+    const std::vector<Placement> placements =
+        pack_footprints(placed, 0, SPACING * sqrt(area / count));
+
+    // Each copy is turned about z, moved into place and rested on z = 0
+    // by its own matrix; the geometry is left as loaded
+    plate->tri_count = 0;
+    for (size_t i=0; i < count; ++i)
+    {
+        const Mesh* m = parts[copies[i]];
+        QMatrix4x4 matrix;
+        matrix.translate(placements[i].offset.x(), placements[i].offset.y(), -m->zmin());
+        matrix.rotate(placements[i].angle, 0, 0, 1);
+        plate->placements.push_back({copies[i], matrix});
+        plate->tri_count += m->triCount();
+    }
+
+    // Bounds of the placed vertices, found in parallel
+    const unsigned workers = worker_count();
+    std::vector<QVector3D> lowers(workers, QVector3D(INFINITY, INFINITY, INFINITY));
+    std::vector<QVector3D> uppers(workers, -lowers[0]);
+    parallel_for(count, [&](size_t begin, size_t end, size_t w)
+    {
+        for (size_t i=begin; i < end; ++i)
+        {
+            const QMatrix4x4& matrix = plate->placements[i].second;
+            const std::vector<GLfloat>& v = parts[copies[i]]->vertexData();
+            for (size_t j=0; j < v.size(); j += 3)
+            {
+                const QVector3D p = matrix.map(QVector3D(v[j], v[j + 1], v[j + 2]));
+                for (int k=0; k < 3; ++k)
+                {
+                    lowers[w][k] = fmin(lowers[w][k], p[k]);
+                    uppers[w][k] = fmax(uppers[w][k], p[k]);
+                }
+            }
+        }
+    });
+    plate->lower = lowers[0];
+    plate->upper = uppers[0];
+    for (unsigned w=1; w < workers; ++w)
+    {
+        for (int k=0; k < 3; ++k)
+        {
+            plate->lower[k] = fmin(plate->lower[k], lowers[w][k]);
+            plate->upper[k] = fmax(plate->upper[k], uppers[w][k]);
+        }
+    }
+
+    emit got_plate(plate);
+    if (!errors.isEmpty())
+    {
+        emit error_parts(errors.join("\n"));
+    }
+}
@@ -0,0 +1,58 @@
+#ifndef PLATE_H
+#define PLATE_H
+
+#include <QThread>
+#include <QStringList>
+#include <QMatrix4x4>
+#include <QVector3D>
+
+#include <vector>
+
+class Mesh;
+
+/*
+ *  Parts packed onto a build plate.  Each distinct file is loaded once,
+ *  and placed (by a matrix that turns it, moves it into place and rests
+ *  it on z = 0) once for every time that it was given, so that the
+ *  parts are never merged into one copy of the geometry.
+ */
+struct Plate
+{
+    ~Plate();
+
+    std::vector<Mesh*> parts;
+    // Index into parts, and the matrix that places that copy of it
+    std::vector<std::pair<size_t, QMatrix4x4>> placements;
+    // Bounds of the placed parts, and their total triangle count
+    QVector3D lower;
+    QVector3D upper;
+    int tri_count;
+};
+
+/*
+ *  Loads several files as parts and packs them onto a build plate by
+ *  their footprints (see pack.h).
+ */
+class PlateLoader : public QThread
+{
+    Q_OBJECT
+public:
+    explicit PlateLoader(QObject* parent, const QStringList& filenames);
+    void run();
+
+    // Gap between parts, relative to the average part's footprint size
+    const static float SPACING;
+
+signals:
+    /*  The receiver takes ownership of the plate */
+    void got_plate(Plate* p);
+
+    /*  Emitted with the reasons that parts couldn't be loaded (the rest
+     *  are still packed) */
+    void error_parts(const QString& message);
+
+private:
+    const QStringList filenames;
+};
+
+#endif // PLATE_H
@@ -0,0 +1,190 @@
+#include <QMatrix4x4>
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#include "preview.h"
+#include "parallel.h"
+
+namespace {
+
+// Pictures are drawn this many times larger, then scaled down smoothly
+const int SUPERSAMPLE = 2;
+
+struct Target
+{
+    std::vector<float> depth;
+    std::vector<QRgb> color;
+};
+
+/*  Colour of a face with the given view-space normal and RGBA8 colour,
+ *  as in mesh.frag and mesh_color.frag */
+QRgb shade(QVector3D n, GLuint face)
+{
+    n.normalize();
+    if (n.z() < 0)
+    {
+        n = -n;
+    }
+    const float a = n.z();
+    const float b = QVector3D::dotProduct(n, QVector3D(-0.57f, -0.57f, 0.57f));
+    QVector3D base3(0.99f, 0.96f, 0.89f);
+    QVector3D base2(0.92f, 0.91f, 0.83f);
+    QVector3D base00(0.40f, 0.48f, 0.51f);
+
+    // Faces with a colour of their own replace the default palette
+    if (face >> 24)
+    {
+        const QVector3D rgb((face & 0xff) / 255.0f, ((face >> 8) & 0xff) / 255.0f,
+                            ((face >> 16) & 0xff) / 255.0f);
+        base3 = rgb * 0.8f + QVector3D(0.2f, 0.2f, 0.2f);
+        base2 = rgb;
+        base00 = rgb * 0.4f;
+    }
+    const QVector3D c = (a*base2 + (1 - a)*base00) * 0.5f +
+                        (b*base3 + (1 - b)*base00) * 0.5f;
+    auto channel = [](float v) { return std::min(255, std::max(0, int(v * 255 + 0.5f))); };
+    return qRgba(channel(c.x()), channel(c.y()), channel(c.z()), 255);
+}
+
+}   // anonymous namespace
+
+QMatrix4x4 starting_turn()
+{
+    QMatrix4x4 m;
+    m.rotate(-90.0, QVector3D(1, 0, 0));
+    m.rotate(180.0 + 15.0, QVector3D(0, 0, 1));
+    m.rotate(15.0, QVector3D(1, -sin(M_PI/12), 0));
+    return m;
+}
+
+QMatrix4x4 starting_view(const QVector3D& lower, const QVector3D& upper)
+{
+    QMatrix4x4 m = starting_turn();
+    m.scale(2 / std::max((upper - lower).length(), 1e-6f));
+    m.translate(-(lower + upper) / 2);
+    return m;
+}
+
+QImage render_preview(const std::vector<GLfloat>& vertices,
+                      const std::vector<GLuint>& indices,
+                      const std::vector<GLuint>& face_colors, int size)
+{
+    if (vertices.empty() || indices.empty() || size <= 0)
+    {
+        QImage image(std::max(size, 1), std::max(size, 1),
+                     QImage::Format_ARGB32_Premultiplied);
+        image.fill(Qt::transparent);
+        return image;
+    }
+
+    // Same starting view as the canvas
+    QVector3D lower(vertices[0], vertices[1], vertices[2]), upper = lower;
+    for (size_t i=0; i < vertices.size(); i += 3)
+    {
+        const QVector3D v(vertices[i], vertices[i + 1], vertices[i + 2]);
+        for (int k=0; k < 3; ++k)
+        {
+            lower[k] = fmin(lower[k], v[k]);
+            upper[k] = fmax(upper[k], v[k]);
+        }
+    }
+    QMatrix4x4 m;
+    m.scale(-1, 1, 0.5);
+    m *= starting_view(lower, upper);
+
+    // Clip space [-1, 1] maps onto the pixels, with y pointing down
+    const int n = size * SUPERSAMPLE;
+    auto project = [&](GLuint i)
+    {
+        const QVector3D p = m.map(QVector3D(vertices[i*3], vertices[i*3 + 1],
+                                            vertices[i*3 + 2]));
+        return QVector3D((p.x() + 1) * n / 2, (1 - p.y()) * n / 2, p.z());
+    };
+
+    const size_t triangles = indices.size() / 3;
+    std::vector<Target> targets(worker_count());
+    parallel_for(triangles, [&](size_t begin, size_t end, size_t w)
+    {
+        Target& t = targets[w];
+        t.depth.assign(n * n, std::numeric_limits<float>::infinity());
+        t.color.assign(n * n, 0);
+        for (size_t f=begin; f < end; ++f)
+        {
+            const QVector3D a = project(indices[f*3]);
+            const QVector3D b = project(indices[f*3 + 1]);
+            const QVector3D c = project(indices[f*3 + 2]);
+            const float area = (b.x() - a.x()) * (c.y() - a.y()) -
+                               (b.y() - a.y()) * (c.x() - a.x());
+            if (area == 0)
+            {
+                continue;
+            }
+
+            const int x0 = std::max(0, int(floor(std::min({a.x(), b.x(), c.x()}))));
+            const int x1 = std::min(n - 1, int(ceil(std::max({a.x(), b.x(), c.x()}))));
+            const int y0 = std::max(0, int(floor(std::min({a.y(), b.y(), c.y()}))));
+            const int y1 = std::min(n - 1, int(ceil(std::max({a.y(), b.y(), c.y()}))));
+            if (x0 > x1 || y0 > y1)
+            {
+                continue;
+            }
+
+            // The normal is taken in clip space, as in the shader, so y
+            // is unflipped and depth scaled up to match pixels
+            const float s = n / 2.0f;
+            const QRgb color = shade(QVector3D::crossProduct(
+                    QVector3D(b.x() - a.x(), a.y() - b.y(), (b.z() - a.z()) * s),
+                    QVector3D(c.x() - a.x(), a.y() - c.y(), (c.z() - a.z()) * s)),
+                    f < face_colors.size() ? face_colors[f] : 0);
+
+            // Barycentric coordinates at pixel centres
+            for (int y=y0; y <= y1; ++y)
+            {
+                for (int x=x0; x <= x1; ++x)
+                {
+                    const float px = x + 0.5f, py = y + 0.5f;
+                    const float wa = ((b.x() - px) * (c.y() - py) -
+                                      (b.y() - py) * (c.x() - px)) / area;
+                    const float wb = ((c.x() - px) * (a.y() - py) -
+                                      (c.y() - py) * (a.x() - px)) / area;
+                    const float wc = 1 - wa - wb;
+                    if (wa < 0 || wb < 0 || wc < 0)
+                    {
+                        continue;
+                    }
+                    const float z = wa * a.z() + wb * b.z() + wc * c.z();
+                    float& d = t.depth[y * n + x];
+                    if (z < d)
+                    {
+                        d = z;
+                        t.color[y * n + x] = color;
+                    }
+                }
+            }
+        }
+    });
+
+    // Nearest surface over every worker's picture
+    QImage full(n, n, QImage::Format_ARGB32_Premultiplied);
+    for (int y=0; y < n; ++y)
+    {
+        QRgb* line = reinterpret_cast<QRgb*>(full.scanLine(y));
+        for (int x=0; x < n; ++x)
+        {
+            float nearest = std::numeric_limits<float>::infinity();
+            QRgb color = 0;
+            for (const auto& t : targets)
+            {
+                if (!t.depth.empty() && t.depth[y * n + x] < nearest)
+                {
+                    nearest = t.depth[y * n + x];
+                    color = t.color[y * n + x];
+                }
+            }
+            line[x] = color;
+        }
+    }
+    return full.scaled(size, size, Qt::IgnoreAspectRatio, Qt::SmoothTransformation);
+}
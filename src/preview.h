@@ -0,0 +1,29 @@
+#ifndef PREVIEW_H
+#define PREVIEW_H
+
+#include <QImage>
+#include <QMatrix4x4>
+#include <QVector3D>
+#include <QtOpenGL/QtOpenGL>
+
+#include <vector>
+
+/*  Turn of the canvas's starting view, before any zoom or panning */
+QMatrix4x4 starting_turn();
+
+/*  Starting view of a mesh with the given bounds: turned as above, then
+ *  scaled and centred so that the mesh fits in clip space.  Shared by
+ *  previews and thumbnails so that they match what the canvas shows. */
+QMatrix4x4 starting_view(const QVector3D& lower, const QVector3D& upper);
+
+/*  Draws a small shaded picture of a mesh on the CPU, from the canvas's
+ *  starting view, on a transparent background.  Faces are coloured as
+ *  on the canvas from face_colors (RGBA8 per triangle, with alpha 0 for
+ *  the default colour), which may be empty.  Triangles are split between
+ *  workers, each with its own depth buffer, so this is quick enough to
+ *  run on every load. */
+QImage render_preview(const std::vector<GLfloat>& vertices,
+                      const std::vector<GLuint>& indices,
+                      const std::vector<GLuint>& face_colors, int size);
+
+#endif // PREVIEW_H
@@ -0,0 +1,58 @@
+#include <QElapsedTimer>
+#include <QMutex>
+#include <QVector>
+#include <QPair>
+#include <QDebug>
+
+#include "profile.h"
+
+static QMutex mutex;
+static QElapsedTimer timer;
+static QVector<QPair<QString, qint64>> marks;
+static bool enabled = false;
+static bool finished = false;
+
+void StartupProfile::start()
+{
+    timer.start();
+}
+
+void StartupProfile::enable()
+{
+    QMutexLocker lock(&mutex);
+    enabled = true;
+}
+
+void StartupProfile::mark(const QString& phase)
+{
+    QMutexLocker lock(&mutex);
+    if (enabled && !finished && timer.isValid())
+    {
+        marks.push_back(qMakePair(phase, timer.nsecsElapsed()));
+    }
+}
+
+void StartupProfile::finish()
+{
+    mark("First frame");
+
+    QMutexLocker lock(&mutex);
+    if (finished)
+    {
+        return;
+    }
+    finished = true;
+
+    if (enabled)
+    {
+        qInfo("Startup profile (ms since launch, +ms since previous phase):");
+        qint64 prev = 0;
+        for (const auto& m : marks)
+        {
+            qInfo("%9.1f  %+8.1f  %s", m.second / 1e6, (m.second - prev) / 1e6,
+                  qPrintable(m.first));
+            prev = m.second;
+        }
+    }
+    marks.clear();
+}
@@ -0,0 +1,23 @@
+#ifndef PROFILE_H
+#define PROFILE_H
+
+#include <QString>
+
+/*
+ *  Records how long each phase of startup takes, measured from the
+ *  start of main().  Marks (from any thread) are only recorded once
+ *  enabled by --startup-profile, and stop at the first frame, so batch
+ *  jobs and ordinary runs keep nothing.
+ */
+class StartupProfile
+{
+public:
+    static void start();
+    static void enable();
+    static void mark(const QString& phase);
+
+    /*  Marks the first frame with a mesh and prints the breakdown */
+    static void finish();
+};
+
+#endif // PROFILE_H
@@ -0,0 +1,208 @@
+#include <QVector3D>
+
+#include <algorithm>
+#include <cmath>
+
+#include "quality.h"
+#include "parallel.h"
+#include "topology.h"
+
+const size_t QualityReport::BINS;
+
+Histogram::Histogram(float lower, float upper, size_t bins, bool logarithmic)
+    : lower(lower), upper(upper), logarithmic(logarithmic), counts(bins, 0),
+      total(0), min(INFINITY), max(-INFINITY), sum(0)
+{
+    // Nothing to do here
+}
+
+void Histogram::add(float v)
+{
+    const float t = logarithmic ? log(v / lower) / log(upper / lower)
+                                : (v - lower) / (upper - lower);
+    const float bin = t * counts.size();
+    counts[bin <= 0 ? 0 : std::min<size_t>(bin, counts.size() - 1)]++;
+    total++;
+    min = fmin(min, v);
+    max = fmax(max, v);
+    sum += v;
+}
+
+void Histogram::merge(const Histogram& other)
+{
+    for (size_t i=0; i < counts.size(); ++i)
+    {
+        counts[i] += other.counts[i];
+    }
+    total += other.total;
+    min = fmin(min, other.min);
+    max = fmax(max, other.max);
+    sum += other.sum;
+}
+
+float Histogram::edge(size_t i) const
+{
+    const float t = float(i) / counts.size();
+    return logarithmic ? lower * pow(upper / lower, t)
+                       : lower + (upper - lower) * t;
+}
+
+float Histogram::percentile(float p) const
+{
+    if (!total)
+    {
+        return 0;
+    }
+    const double target = p * total;
+    quint64 below = 0;
+    for (size_t i=0; i < counts.size(); ++i)
+    {
+        if (counts[i] && below + counts[i] >= target)
+        {
+            const float f = (target - below) / counts[i];
+            const float v = edge(i) + (edge(i + 1) - edge(i)) * f;
+            return fmax(min, fmin(max, v));
+        }
+        below += counts[i];
+    }
+    return max;
+}
+
+Histogram Histogram::coarsened(size_t n) const
+{
+    Histogram out(lower, upper, n, logarithmic);
+    const size_t group = counts.size() / n;
+    for (size_t i=0; i < counts.size(); ++i)
+    {
+        out.counts[i / group] += counts[i];
+    }
+    out.total = total;
+    out.min = min;
+    out.max = max;
+    out.sum = sum;
+    return out;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+QualityReport measure_quality(const std::vector<GLfloat>& vertices,
+                              const std::vector<GLuint>& indices)
+{
+    const size_t vertex_count = vertices.size() / 3;
+    const size_t tri_count = indices.size() / 3;
+
+    // Edge lengths are binned logarithmically, down to a millionth of the
+    // mesh's size
+    QVector3D lower(INFINITY, INFINITY, INFINITY), upper(-INFINITY, -INFINITY, -INFINITY);
+    for (size_t v=0; v < vertex_count; ++v)
+    {
+        const QVector3D p(vertices[v*3], vertices[v*3 + 1], vertices[v*3 + 2]);
+        for (int k=0; k < 3; ++k)
+        {
+            lower[k] = fmin(lower[k], p[k]);
+            upper[k] = fmax(upper[k], p[k]);
+        }
+    }
+    const float size = vertex_count ? fmax((upper - lower).length(), 1e-30f) : 1;
+
+    QualityReport report = {
+        Histogram(size * 1e-6f, size, QualityReport::BINS, true),
+        Histogram(1, 1e4f, QualityReport::BINS, true),
+        Histogram(0, 360, QualityReport::BINS),
+        0};
+
+    const VertexTriangles around = vertex_triangles(vertex_count, indices);
+    std::vector<QualityReport> partial(worker_count(), report);
+
+    auto position = [&](GLuint v)
+    {
+        return QVector3D(vertices[v*3], vertices[v*3 + 1], vertices[v*3 + 2]);
+    };
+
+    parallel_for(tri_count, [&](size_t begin, size_t end, size_t w)
+    {
+        QualityReport& r = partial[w];
+        for (size_t t=begin; t < end; ++t)
+        {
+            const GLuint* tri = &indices[t * 3];
+            if (tri[0] == tri[1] || tri[1] == tri[2] || tri[2] == tri[0])
+            {
+                r.degenerate++;
+                continue;
+            }
+            const QVector3D p[3] = {position(tri[0]), position(tri[1]), position(tri[2])};
+            const QVector3D normal = QVector3D::crossProduct(p[1] - p[0], p[2] - p[0]);
+            const float twice_area = normal.length();
+
+            float longest = 0;
+            for (int k=0; k < 3; ++k)
+            {
+                const GLuint a = tri[k], b = tri[(k + 1) % 3];
+                const float length = (p[(k + 1) % 3] - p[k]).length();
+                longest = fmax(longest, length);
+
+                // Each edge is measured by the lowest-numbered triangle
+                // on it, and dihedrals only across manifold edges
+                GLuint other = GLuint(-1);
+                bool first = true;
+                int sharing = 0;
+                for (GLuint i=around.offsets[a]; i < around.offsets[a + 1]; ++i)
+                {
+                    const GLuint u = around.incident[i];
+                    const GLuint* o = &indices[size_t(u) * 3];
+                    if (u != t && (o[0] == b || o[1] == b || o[2] == b) &&
+                        o[0] != o[1] && o[1] != o[2] && o[2] != o[0])
+                    {
+                        other = u;
+                        first &= u > t;
+                        sharing++;
+                    }
+                }
+                if (!first)
+                {
+                    continue;
+                }
+                r.edge_length.add(length);
+
+                if (sharing == 1 && twice_area > 0)
+                {
+                    const GLuint* o = &indices[size_t(other) * 3];
+                    const QVector3D q[3] = {position(o[0]), position(o[1]), position(o[2])};
+                    const QVector3D n = QVector3D::crossProduct(q[1] - q[0], q[2] - q[0]);
+                    const float n_length = n.length();
+                    if (n_length > 0)
+                    {
+                        // The normals turn about the edge (a to b in this
+                        // triangle) one way over a convex edge and the
+                        // other way over a concave one
+                        const QVector3D m = normal / twice_area;
+                        const QVector3D m2 = n / n_length;
+                        const float turn = atan2(
+                            QVector3D::dotProduct(QVector3D::crossProduct(m, m2),
+                                                  (p[(k + 1) % 3] - p[k]) / length),
+                            QVector3D::dotProduct(m, m2));
+                        r.dihedral.add(180 - turn * 180 / M_PI);
+                    }
+                }
+            }
+
+            if (twice_area > 0)
+            {
+                r.aspect_ratio.add(sqrt(3.0f) / 2 * longest * longest / twice_area);
+            }
+            else
+            {
+                r.degenerate++;
+            }
+        }
+    });
+
+    for (const auto& r : partial)
+    {
+        report.edge_length.merge(r.edge_length);
+        report.aspect_ratio.merge(r.aspect_ratio);
+        report.dihedral.merge(r.dihedral);
+        report.degenerate += r.degenerate;
+    }
+    return report;
+}
@@ -0,0 +1,62 @@
+#ifndef QUALITY_H
+#define QUALITY_H
+
+#include <QtOpenGL/QtOpenGL>
+
+#include <vector>
+
+/*  Histogram over a fixed range, with evenly or logarithmically spaced
+ *  bins.  Values outside the range go in the end bins, and the exact
+ *  minimum, maximum and mean are kept alongside. */
+struct Histogram
+{
+    Histogram(float lower=0, float upper=1, size_t bins=1, bool logarithmic=false);
+
+    void add(float v);
+    void merge(const Histogram& other);
+
+    /*  Value that fraction p of the samples are below, interpolated
+     *  within its bin (and clamped to the exact extremes) */
+    float percentile(float p) const;
+
+    /*  Lower edge of bin i (or the upper edge of the range, for i equal
+     *  to the number of bins) */
+    float edge(size_t i) const;
+
+    /*  Same samples in n bins (which must divide the bin count) */
+    Histogram coarsened(size_t n) const;
+
+    float lower, upper;
+    bool logarithmic;
+    std::vector<quint64> counts;
+    quint64 total;
+    float min, max;
+    double sum;
+};
+
+/*  Element quality of a welded triangle mesh, from measure_quality */
+struct QualityReport
+{
+    // Length of each edge, counted once however many triangles share it
+    Histogram edge_length;
+
+    // Longest edge over shortest altitude, scaled so that an equilateral
+    // triangle scores 1 (degenerate triangles are counted separately)
+    Histogram aspect_ratio;
+
+    // Angle in degrees between the two triangles at each manifold edge,
+    // measured through the material: below 180 at convex edges, 180
+    // where the surface is flat and above 180 at concave edges
+    Histogram dihedral;
+
+    quint64 degenerate;
+
+    const static size_t BINS = 1024;
+};
+
+/*  Measures every triangle and edge in one parallel pass, each worker
+ *  filling its own histograms, which are then merged */
+QualityReport measure_quality(const std::vector<GLfloat>& vertices,
+                              const std::vector<GLuint>& indices);
+
+#endif // QUALITY_H
@@ -0,0 +1,107 @@
+#include <QPainter>
+
+#include <algorithm>
+
+#include "qualitypanel.h"
+#include "quality.h"
+
+const int QualityPanel::BARS;
+
+QualityPanel::QualityPanel(QWidget* parent)
+    : QWidget(parent), report(nullptr)
+{
+    // Nothing to do here
+}
+
+QualityPanel::~QualityPanel()
+{
+    delete report;
+}
+
+QSize QualityPanel::sizeHint() const
+{
+    return QSize(280, 480);
+}
+
+void QualityPanel::set_report(QualityReport* r)
+{
+    delete report;
+    report = r;
+    update();
+}
+
+void QualityPanel::paintEvent(QPaintEvent* event)
+{
+    Q_UNUSED(event);
+    QPainter painter(this);
+    painter.fillRect(rect(), palette().window());
+    if (!report)
+    {
+        painter.drawText(rect(), Qt::AlignCenter, "No mesh measured");
+        return;
+    }
+
+    const int line = fontMetrics().height();
+    painter.drawText(QRect(4, 0, width() - 8, line), Qt::AlignLeft,
+                     QString("Degenerate triangles: %1").arg(report->degenerate));
+
+    const int h = (height() - line) / 3;
+    draw_histogram(painter, QRect(0, line, width(), h),
+                   "Edge length", report->edge_length);
+    draw_histogram(painter, QRect(0, line + h, width(), h),
+                   "Aspect ratio", report->aspect_ratio);
+    draw_histogram(painter, QRect(0, line + 2 * h, width(), h),
+                   "Dihedral angle", report->dihedral);
+}
+
+void QualityPanel::draw_histogram(QPainter& painter, const QRect& area,
+                                  const QString& title, const Histogram& h)
+{
+    const int line = fontMetrics().height();
+    const QRect text = area.adjusted(4, 4, -4, 0);
+    painter.setPen(palette().windowText().color());
+    painter.drawText(text, Qt::AlignLeft | Qt::AlignTop, title);
+    if (!h.total)
+    {
+        return;
+    }
+    painter.drawText(text.translated(0, line), Qt::AlignLeft | Qt::AlignTop,
+                     QString("min %1  max %2  mean %3")
+                        .arg(h.min, 0, 'g', 4).arg(h.max, 0, 'g', 4)
+                        .arg(h.sum / h.total, 0, 'g', 4));
+    painter.drawText(text.translated(0, 2 * line), Qt::AlignLeft | Qt::AlignTop,
+                     QString("1%: %1  50%: %2  99%: %3")
+                        .arg(h.percentile(0.01f), 0, 'g', 4)
+                        .arg(h.percentile(0.5f), 0, 'g', 4)
+                        .arg(h.percentile(0.99f), 0, 'g', 4));
+
+    // Bars over the occupied bins only, so that narrow distributions
+    // don't collapse into a single bar
+    size_t first = 0, last = h.counts.size();
+    while (first < last && !h.counts[first]) first++;
+    while (last > first && !h.counts[last - 1]) last--;
+    const QRect chart = area.adjusted(4, 3 * line + 8, -4, -line - 4);
+    if (chart.height() <= 0 || first == last)
+    {
+        return;
+    }
+
+    std::vector<quint64> bars(BARS, 0);
+    for (size_t i=first; i < last; ++i)
+    {
+        bars[(i - first) * BARS / (last - first)] += h.counts[i];
+    }
+    const quint64 tallest = *std::max_element(bars.begin(), bars.end());
+    const double width = chart.width() / double(BARS);
+    for (int i=0; i < BARS; ++i)
+    {
+        const int height = chart.height() * bars[i] / double(tallest);
+        painter.fillRect(QRectF(chart.left() + i * width, chart.bottom() - height,
+                                width - 1, height),
+                         palette().highlight());
+    }
+    painter.drawText(QRect(chart.left(), chart.bottom() + 2, chart.width(), line),
+                     Qt::AlignLeft, QString::number(h.edge(first), 'g', 4));
+    painter.drawText(QRect(chart.left(), chart.bottom() + 2, chart.width(), line),
+                     Qt::AlignRight, QString::number(h.edge(last), 'g', 4));
+}
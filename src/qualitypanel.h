@@ -0,0 +1,40 @@
+#ifndef QUALITYPANEL_H
+#define QUALITYPANEL_H
+
+#include <QWidget>
+
+struct Histogram;
+struct QualityReport;
+
+/*
+ *  Panel that draws the histograms of a QualityReport, with their
+ *  extremes and percentiles
+ */
+class QualityPanel : public QWidget
+{
+    Q_OBJECT
+public:
+    explicit QualityPanel(QWidget* parent=0);
+    ~QualityPanel();
+
+    QSize sizeHint() const override;
+
+public slots:
+    /*  Takes ownership of the report, replacing the one shown (or
+     *  clearing the panel, if report is null) */
+    void set_report(QualityReport* report);
+
+protected:
+    void paintEvent(QPaintEvent* event) override;
+
+private:
+    void draw_histogram(QPainter& painter, const QRect& area,
+                        const QString& title, const Histogram& h);
+
+    QualityReport* report;
+
+    // Bins drawn for each histogram
+    const static int BARS = 64;
+};
+
+#endif // QUALITYPANEL_H
@@ -0,0 +1,114 @@
+#include <QDataStream>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QProxyStyle>
+#include <QSaveFile>
+#include <QStandardPaths>
+
+#include "recent.h"
+
+const int FileSummary::PREVIEW_SIZE;
+const quint32 RecentCache::MAGIC;
+const quint32 RecentCache::VERSION;
+
+RecentCache::RecentCache()
+    : filename(QStandardPaths::writableLocation(QStandardPaths::CacheLocation) +
+               "/recent.dat")
+{
+    QFile file(filename);
+    if (!file.open(QIODevice::ReadOnly))
+    {
+        return;
+    }
+
+    QDataStream in(&file);
+    in.setVersion(QDataStream::Qt_5_0);
+    quint32 magic, version, count;
+    in >> magic >> version >> count;
+    if (magic != MAGIC || version != VERSION)
+    {
+        return;
+    }
+    for (quint32 i=0; i < count && in.status() == QDataStream::Ok; ++i)
+    {
+        FileSummary s;
+        qint32 triangles;
+        in >> s.path >> s.size >> s.loaded >> triangles
+           >> s.lower >> s.upper >> s.fingerprint >> s.preview;
+        s.triangles = triangles;
+        if (in.status() == QDataStream::Ok)
+        {
+            summaries[s.path] = s;
+        }
+    }
+}
+
+const FileSummary* RecentCache::find(const QString& path) const
+{
+    auto it = summaries.find(path);
+    return it == summaries.end() ? nullptr : &it.value();
+}
+
+void RecentCache::store(const FileSummary& summary)
+{
+    summaries[summary.path] = summary;
+}
+
+void RecentCache::retain(const QStringList& paths)
+{
+    for (auto it = summaries.begin(); it != summaries.end();)
+    {
+        if (paths.contains(it.key()))
+        {
+            ++it;
+        }
+        else
+        {
+            it = summaries.erase(it);
+        }
+    }
+    save();
+}
+
+bool RecentCache::save() const
+{
+    QDir().mkpath(QFileInfo(filename).path());
+    QSaveFile file(filename);
+    if (!file.open(QIODevice::WriteOnly))
+    {
+        return false;
+    }
+
+    QDataStream out(&file);
+    out.setVersion(QDataStream::Qt_5_0);
+    out << MAGIC << VERSION << quint32(summaries.size());
+    for (const auto& s : summaries)
+    {
+        // Previews are written as PNGs, a few kilobytes each
+        out << s.path << s.size << s.loaded << qint32(s.triangles)
+            << s.lower << s.upper << s.fingerprint << s.preview;
+    }
+    return file.commit();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+class PreviewMenuStyle : public QProxyStyle
+{
+public:
+    int pixelMetric(PixelMetric metric, const QStyleOption* option=nullptr,
+                    const QWidget* widget=nullptr) const override
+    {
+        return metric == PM_SmallIconSize
+            ? FileSummary::PREVIEW_SIZE
+            : QProxyStyle::pixelMetric(metric, option, widget);
+    }
+};
+
+QStyle* preview_menu_style(QObject* menu)
+{
+    QStyle* style = new PreviewMenuStyle;
+    style->setParent(menu);
+    return style;
+}
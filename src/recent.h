@@ -0,0 +1,57 @@
+#ifndef RECENT_H
+#define RECENT_H
+
+#include <QDateTime>
+#include <QHash>
+#include <QImage>
+#include <QVector3D>
+
+class QStyle;
+
+/*  What the recent-files menu shows about a file, recorded as it loads */
+struct FileSummary
+{
+    QString path;           // Absolute path
+    qint64 size;            // Bytes on disk
+    QDateTime loaded;       // When it was last loaded
+    int triangles;
+    QVector3D lower, upper; // Bounds
+    quint64 fingerprint;    // See ContentHash
+    QImage preview;         // See render_preview
+
+    const static int PREVIEW_SIZE = 48;
+};
+
+/*
+ *  Summaries of the recent files, kept in one small file in the user's
+ *  cache folder, so that the menu can show them without opening (or even
+ *  checking) the files themselves.
+ */
+class RecentCache
+{
+public:
+    /*  Reads the cache file, ignoring it if it's missing or unreadable */
+    RecentCache();
+
+    const FileSummary* find(const QString& path) const;
+    void store(const FileSummary& summary);
+
+    /*  Drops every summary that isn't for one of paths, then saves */
+    void retain(const QStringList& paths);
+
+private:
+    bool save() const;
+
+    const QString filename;
+    QHash<QString, FileSummary> summaries;
+
+    // Written at the start of the file, and bumped when the format changes
+    const static quint32 MAGIC = 0x66737263;   // "fsrc"
+    const static quint32 VERSION = 1;
+};
+
+/*  Returns a style for menus whose icons are previews (of PREVIEW_SIZE),
+ *  owned by the given menu */
+QStyle* preview_menu_style(QObject* menu);
+
+#endif // RECENT_H
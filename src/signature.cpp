@@ -0,0 +1,430 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <map>
+#include <random>
+
+#include "signature.h"
+#include "hull.h"
+#include "parallel.h"
+
+namespace {
+
+// Point pairs sampled for the distance distribution, drawn in fixed blocks
+// (each with its own seed) so the result doesn't depend on the worker count
+const int SAMPLE_BLOCKS = 64;
+const int SAMPLES_PER_BLOCK = 4096;
+
+struct Moments
+{
+    double area;
+    double first[3];
+    double second[6];   // In the order of PAIRS
+};
+
+// Axes of the six distinct entries of a symmetric 3x3 matrix
+const int PAIRS[6][2] = {{0, 0}, {1, 1}, {2, 2}, {0, 1}, {0, 2}, {1, 2}};
+
+/*  Eigenvalues of a symmetric 3x3 matrix, largest first */
+void eigenvalues(const double m[6], double out[3])
+{
+    const double off = m[3]*m[3] + m[4]*m[4] + m[5]*m[5];
+    const double q = (m[0] + m[1] + m[2]) / 3;
+    const double p2 = (m[0] - q)*(m[0] - q) + (m[1] - q)*(m[1] - q) +
+                      (m[2] - q)*(m[2] - q) + 2 * off;
+    if (p2 <= 0)
+    {
+        out[0] = out[1] = out[2] = q;
+        return;
+    }
+    const double p = sqrt(p2 / 6);
+    const double b00 = (m[0] - q) / p, b11 = (m[1] - q) / p, b22 = (m[2] - q) / p;
+    const double b01 = m[3] / p, b02 = m[4] / p, b12 = m[5] / p;
+    const double det = b00 * (b11*b22 - b12*b12) - b01 * (b01*b22 - b12*b02) +
+                       b02 * (b01*b12 - b11*b02);
+    const double phi = acos(std::max(-1.0, std::min(1.0, det / 2))) / 3;
+    out[0] = q + 2 * p * cos(phi);
+    out[2] = q + 2 * p * cos(phi + 2 * M_PI / 3);
+    out[1] = 3 * q - out[0] - out[2];
+}
+
+/*  Unit eigenvector of a symmetric 3x3 matrix for one of its eigenvalues,
+ *  as the longest cross product of two rows of (m - value I) */
+void eigenvector(const double m[6], double value, double out[3])
+{
+    const double rows[3][3] = {{m[0] - value, m[3], m[4]},
+                               {m[3], m[1] - value, m[5]},
+                               {m[4], m[5], m[2] - value}};
+    double best = 0;
+    out[0] = 1;
+    out[1] = out[2] = 0;
+    for (int i=0; i < 3; ++i)
+    {
+        const double* r = rows[i];
+        const double* q = rows[(i + 1) % 3];
+        const double c[3] = {r[1]*q[2] - r[2]*q[1], r[2]*q[0] - r[0]*q[2],
+                             r[0]*q[1] - r[1]*q[0]};
+        const double length = c[0]*c[0] + c[1]*c[1] + c[2]*c[2];
+        if (length > best)
+        {
+            best = length;
+            for (int k=0; k < 3; ++k)
+            {
+                out[k] = c[k] / sqrt(length);
+            }
+        }
+    }
+}
+
+float relative(float a, float b)
+{
+    const float scale = fmax(fabs(a), fabs(b));
+    return scale > 0 ? fabs(a - b) / scale : 0;
+}
+
+}   // anonymous namespace
+
+////////////////////////////////////////////////////////////////////////////////
+
+float ShapeSignature::difference(const ShapeSignature& other) const
+{
+    float d = fmax(relative(area, other.area),
+                   relative(hull_volume, other.hull_volume));
+    for (int i=0; i < 3; ++i)
+    {
+        d = fmax(d, relative(moments[i], other.moments[i]));
+    }
+    d = fmax(d, fabs(handedness - other.handedness));
+    for (int i=0; i < BINS; ++i)
+    {
+        d = fmax(d, fabs(distances[i] - other.distances[i]));
+    }
+    return d;
+}
+
+ShapeSignature shape_signature(const std::vector<GLfloat>& vertices,
+                               const std::vector<GLuint>& indices)
+{
+    ShapeSignature s = {};
+    const size_t triangles = indices.size() / 3;
+    if (triangles == 0)
+    {
+        return s;
+    }
+
+    // Moments are taken relative to one of the vertices, so that parts far
+    // from the origin don't lose precision
+    const double origin[3] = {vertices[0], vertices[1], vertices[2]};
+    auto corner = [&](GLuint i, double out[3])
+    {
+        for (int k=0; k < 3; ++k)
+        {
+            out[k] = vertices[i*3 + k] - origin[k];
+        }
+    };
+
+    // Area of every triangle (for sampling), and per-worker area moments
+    std::vector<double> areas(triangles);
+    std::vector<Moments> partial(worker_count(), Moments());
+    parallel_for(triangles, [&](size_t begin, size_t end, size_t w)
+    {
+        Moments& m = partial[w];
+        for (size_t t=begin; t < end; ++t)
+        {
+            double a[3], b[3], c[3];
+            corner(indices[t*3], a);
+            corner(indices[t*3 + 1], b);
+            corner(indices[t*3 + 2], c);
+
+            const double u[3] = {b[0] - a[0], b[1] - a[1], b[2] - a[2]};
+            const double v[3] = {c[0] - a[0], c[1] - a[1], c[2] - a[2]};
+            const double n[3] = {u[1]*v[2] - u[2]*v[1], u[2]*v[0] - u[0]*v[2],
+                                 u[0]*v[1] - u[1]*v[0]};
+            const double area = sqrt(n[0]*n[0] + n[1]*n[1] + n[2]*n[2]) / 2;
+            areas[t] = area;
+
+            // Integrals of x and x x^T over the triangle
+            const double sum[3] = {a[0] + b[0] + c[0], a[1] + b[1] + c[1],
+                                   a[2] + b[2] + c[2]};
+            m.area += area;
+            for (int k=0; k < 3; ++k)
+            {
+                m.first[k] += area * sum[k] / 3;
+            }
+            for (int k=0; k < 6; ++k)
+            {
+                const int i = PAIRS[k][0], j = PAIRS[k][1];
+                m.second[k] += area / 12 * (a[i]*a[j] + b[i]*b[j] + c[i]*c[j] +
+                                            sum[i]*sum[j]);
+            }
+        }
+    });
+
+    Moments total = {};
+    for (const auto& m : partial)
+    {
+        total.area += m.area;
+        for (int k=0; k < 3; ++k)
+        {
+            total.first[k] += m.first[k];
+        }
+        for (int k=0; k < 6; ++k)
+        {
+            total.second[k] += m.second[k];
+        }
+    }
+    s.area = total.area;
+    if (total.area <= 0)
+    {
+        return s;
+    }
+
+    // Covariance about the centroid
+    const double centroid[3] = {total.first[0] / total.area,
+                                total.first[1] / total.area,
+                                total.first[2] / total.area};
+    double covariance[6];
+    for (int k=0; k < 6; ++k)
+    {
+        covariance[k] = total.second[k] / total.area -
+                        centroid[PAIRS[k][0]] * centroid[PAIRS[k][1]];
+    }
+    double principal[3];
+    eigenvalues(covariance, principal);
+    for (int k=0; k < 3; ++k)
+    {
+        s.moments[k] = principal[k];
+    }
+
+    // Principal axes as a right-handed frame (the third is the cross
+    // product of the first two), for the handedness below
+    double axes[3][3];
+    eigenvector(covariance, principal[0], axes[0]);
+    eigenvector(covariance, principal[2], axes[2]);
+    const double along = axes[2][0]*axes[0][0] + axes[2][1]*axes[0][1] +
+                         axes[2][2]*axes[0][2];
+    for (int k=0; k < 3; ++k)
+    {
+        axes[2][k] -= along * axes[0][k];
+    }
+    const double length = sqrt(axes[2][0]*axes[2][0] + axes[2][1]*axes[2][1] +
+                               axes[2][2]*axes[2][2]);
+    for (int k=0; k < 3; ++k)
+    {
+        axes[2][k] = length > 0 ? axes[2][k] / length : (k == 1);
+    }
+    for (int k=0; k < 3; ++k)
+    {
+        const int i = (k + 1) % 3, j = (k + 2) % 3;
+        axes[1][k] = axes[2][i]*axes[0][j] - axes[2][j]*axes[0][i];
+    }
+
+    // Mean of x y z about the centroid, in those axes.  For functions f,
+    // g and h that are linear over a triangle, the integral of f g h is
+    // its area times the sum of f[i] g[j] h[k] over all corners i, j and
+    // k, weighted 6/60 where all three are equal, 2/60 where two of them
+    // are and 1/60 otherwise.
+    std::vector<double> mixed(worker_count(), 0);
+    parallel_for(triangles, [&](size_t begin, size_t end, size_t w)
+    {
+        for (size_t t=begin; t < end; ++t)
+        {
+            double p[3][3];
+            for (int v=0; v < 3; ++v)
+            {
+                double c[3];
+                corner(indices[t*3 + v], c);
+                for (int k=0; k < 3; ++k)
+                {
+                    c[k] -= centroid[k];
+                }
+                for (int k=0; k < 3; ++k)
+                {
+                    p[v][k] = c[0]*axes[k][0] + c[1]*axes[k][1] + c[2]*axes[k][2];
+                }
+            }
+            double sum = 0;
+            for (int i=0; i < 3; ++i)
+            {
+                for (int j=0; j < 3; ++j)
+                {
+                    for (int k=0; k < 3; ++k)
+                    {
+                        const int weight = (i == j && j == k) ? 6
+                                         : (i == j || j == k || i == k) ? 2 : 1;
+                        sum += weight * p[i][0] * p[j][1] * p[k][2];
+                    }
+                }
+            }
+            mixed[w] += areas[t] * sum / 60;
+        }
+    });
+
+    // Reversing two axes (to stay right-handed) leaves the mean of x y z
+    // alone, but a mirror image changes its sign.  The axes aren't well
+    // defined where principal moments are nearly equal, so it is faded
+    // out there.
+    double handedness = 0;
+    for (double m : mixed)
+    {
+        handedness += m;
+    }
+    const double spread = principal[0] * principal[1] * principal[2];
+    const double gap = std::min(principal[0] - principal[1],
+                                principal[1] - principal[2]);
+    s.handedness = spread > 0
+        ? handedness / total.area / sqrt(spread) * gap / principal[1] : 0;
+
+    // Volume of the convex hull, as tetrahedra from one of its corners
+    const std::vector<GLuint> hull = convex_hull(vertices);
+    double volume = 0;
+    for (size_t t=0; t < hull.size(); t += 3)
+    {
+        double a[3], b[3], c[3], o[3];
+        corner(hull[0], o);
+        corner(hull[t], a);
+        corner(hull[t + 1], b);
+        corner(hull[t + 2], c);
+        for (int k=0; k < 3; ++k)
+        {
+            a[k] -= o[k];
+            b[k] -= o[k];
+            c[k] -= o[k];
+        }
+        volume += (a[0] * (b[1]*c[2] - b[2]*c[1]) - a[1] * (b[0]*c[2] - b[2]*c[0]) +
+                   a[2] * (b[0]*c[1] - b[1]*c[0])) / 6;
+    }
+    s.hull_volume = fabs(volume);
+
+    // Distances between random surface points, in units of the RMS radius
+    for (size_t t=1; t < triangles; ++t)
+    {
+        areas[t] += areas[t - 1];
+    }
+    const double radius = sqrt(principal[0] + principal[1] + principal[2]);
+    const double scale = radius > 0 ? ShapeSignature::BINS / (4 * radius) : 0;
+
+    std::vector<std::vector<uint32_t>> counts(
+            SAMPLE_BLOCKS, std::vector<uint32_t>(ShapeSignature::BINS, 0));
+    parallel_for(SAMPLE_BLOCKS, [&](size_t begin, size_t end, size_t)
+    {
+        for (size_t block=begin; block < end; ++block)
+        {
+            std::mt19937 rng(block);
+            std::uniform_real_distribution<double> uniform(0, 1);
+            auto sample = [&](double out[3])
+            {
+                const double r = uniform(rng) * areas.back();
+                const size_t t = std::min<size_t>(
+                        std::upper_bound(areas.begin(), areas.end(), r) - areas.begin(),
+                        triangles - 1);
+                double a[3], b[3], c[3];
+                corner(indices[t*3], a);
+                corner(indices[t*3 + 1], b);
+                corner(indices[t*3 + 2], c);
+                const double r1 = sqrt(uniform(rng)), r2 = uniform(rng);
+                for (int k=0; k < 3; ++k)
+                {
+                    out[k] = (1 - r1) * a[k] + r1 * (1 - r2) * b[k] + r1 * r2 * c[k];
+                }
+            };
+            for (int i=0; i < SAMPLES_PER_BLOCK; ++i)
+            {
+                double p[3], q[3];
+                sample(p);
+                sample(q);
+                const double d = sqrt((p[0] - q[0])*(p[0] - q[0]) +
+                                      (p[1] - q[1])*(p[1] - q[1]) +
+                                      (p[2] - q[2])*(p[2] - q[2]));
+                counts[block][std::min<int>(d * scale, ShapeSignature::BINS - 1)]++;
+            }
+        }
+    });
+
+    uint64_t below = 0;
+    for (int i=0; i < ShapeSignature::BINS; ++i)
+    {
+        for (const auto& c : counts)
+        {
+            below += c[i];
+        }
+        s.distances[i] = below / double(SAMPLE_BLOCKS * SAMPLES_PER_BLOCK);
+    }
+    return s;
+}
+
+std::vector<std::vector<size_t>> group_signatures(
+        const std::vector<ShapeSignature>& signatures, float tolerance)
+{
+    const size_t count = signatures.size();
+    std::vector<size_t> order(count);
+    for (size_t i=0; i < count; ++i)
+    {
+        order[i] = i;
+    }
+    std::sort(order.begin(), order.end(), [&](size_t a, size_t b)
+    {
+        return signatures[a].area < signatures[b].area;
+    });
+
+    // Matching parts have nearly the same area, so each part only needs
+    // comparing with the ones just after it in area order
+    std::vector<std::vector<std::pair<size_t, size_t>>> matches(worker_count());
+    parallel_for(count, [&](size_t begin, size_t end, size_t w)
+    {
+        for (size_t i=begin; i < end; ++i)
+        {
+            const ShapeSignature& a = signatures[order[i]];
+            for (size_t j=i + 1; j < count; ++j)
+            {
+                const ShapeSignature& b = signatures[order[j]];
+                if (b.area * (1 - tolerance) > a.area)
+                {
+                    break;
+                }
+                if (a.difference(b) <= tolerance)
+                {
+                    matches[w].push_back({order[i], order[j]});
+                }
+            }
+        }
+    });
+
+    // Union-find over the matching pairs
+    std::vector<size_t> parent(count);
+    for (size_t i=0; i < count; ++i)
+    {
+        parent[i] = i;
+    }
+    auto root = [&](size_t i)
+    {
+        while (parent[i] != i)
+        {
+            i = parent[i] = parent[parent[i]];
+        }
+        return i;
+    };
+    for (const auto& m : matches)
+    {
+        for (const auto& p : m)
+        {
+            const size_t a = root(p.first), b = root(p.second);
+            parent[std::max(a, b)] = std::min(a, b);
+        }
+    }
+
+    std::map<size_t, std::vector<size_t>> groups;
+    for (size_t i=0; i < count; ++i)
+    {
+        groups[root(i)].push_back(i);
+    }
+    std::vector<std::vector<size_t>> out;
+    for (auto& g : groups)
+    {
+        if (g.second.size() > 1)
+        {
+            out.push_back(std::move(g.second));
+        }
+    }
+    return out;
+}
@@ -0,0 +1,45 @@
+#ifndef SIGNATURE_H
+#define SIGNATURE_H
+
+#include <QtOpenGL/QtOpenGL>
+
+#include <vector>
+
+/*
+ *  Summary of a mesh's shape that doesn't change when the mesh is moved
+ *  or turned (or its triangles are reordered), for finding copies of the
+ *  same part saved in different poses.  Mirror images differ in their
+ *  handedness.
+ */
+struct ShapeSignature
+{
+    float area;             // Surface area
+    float hull_volume;      // Volume of the convex hull
+    float moments[3];       // Principal second moments of the surface,
+                            // per unit area, largest first
+    float handedness;       // Scale-free mean of x y z along the principal
+                            // axes, which changes sign in a mirror image
+
+    // Cumulative D2 shape distribution: the fraction of random pairs of
+    // surface points that are closer than (i + 1) / BINS times four
+    // times the surface's RMS radius
+    const static int BINS = 64;
+    float distances[BINS];
+
+    /*  Largest relative difference between the scalar measures, absolute
+     *  difference in handedness, or difference between the distance
+     *  distributions (by their Kolmogorov-Smirnov statistic), so 0.01
+     *  means about 1% different */
+    float difference(const ShapeSignature& other) const;
+};
+
+ShapeSignature shape_signature(const std::vector<GLfloat>& vertices,
+                               const std::vector<GLuint>& indices);
+
+/*  Groups signatures that differ by at most tolerance from another one
+ *  in the group, and returns the groups with more than one member (as
+ *  indices into signatures) */
+std::vector<std::vector<size_t>> group_signatures(
+        const std::vector<ShapeSignature>& signatures, float tolerance);
+
+#endif // SIGNATURE_H
@@ -0,0 +1,142 @@
+#include <algorithm>
+#include <cmath>
+
+#include "slice.h"
+#include "voxel.h"
+#include "glcore.h"
+
+VoxelSlice::VoxelSlice()
+    : texture(0), grid(nullptr), current_layer(0), dirty(false)
+{
+    initializeOpenGLFunctions();
+
+    shader.addCacheableShaderFromSourceFile(QOpenGLShader::Vertex, gl_shader_path("slice.vert"));
+    shader.addCacheableShaderFromSourceFile(QOpenGLShader::Fragment, gl_shader_path("slice.frag"));
+    // Linked in draw(), since most meshes are never voxelized
+
+    vertices.create();
+    glGenTextures(1, &texture);
+    glBindTexture(GL_TEXTURE_2D, texture);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glBindTexture(GL_TEXTURE_2D, 0);
+}
+
+VoxelSlice::~VoxelSlice()
+{
+    glDeleteTextures(1, &texture);
+}
+
+void VoxelSlice::set_grid(const VoxelGrid* g)
+{
+    grid = g;
+    current_layer = g ? g->dimension(2) / 2 : 0;
+    dirty = true;
+}
+
+void VoxelSlice::move(int steps)
+{
+    if (grid)
+    {
+        current_layer = std::min(std::max(current_layer + steps, 0),
+                                 grid->dimension(2) - 1);
+        dirty = true;
+    }
+}
+
+void VoxelSlice::upload()
+{
+    const int nx = grid->dimension(0);
+    const int ny = grid->dimension(1);
+    const int z = current_layer;
+    const float limit = grid->bandWidth() * grid->size();
+
+    std::vector<GLuint> pixels(size_t(nx) * ny);
+    for (int y=0; y < ny; ++y)
+    {
+        for (int x=0; x < nx; ++x)
+        {
+            // RGBA8, with red in the lowest byte
+            GLuint c = 0;
+            if (grid->inside(x, y, z))
+            {
+                c = 0xb0ff7828;
+            }
+            else if (grid->hasDistance())
+            {
+                const float t = 1 - grid->distance(x, y, z) / limit;
+                c = (GLuint(std::max(t, 0.0f) * 0xb0) << 24) | 0x208cff;
+            }
+            pixels[x + size_t(nx) * y] = c;
+        }
+    }
+    glBindTexture(GL_TEXTURE_2D, texture);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, nx, ny, 0, GL_RGBA,
+                 GL_UNSIGNED_BYTE, pixels.data());
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    // The quad spans the grid's outer faces, at the centre of the layer
+    const QVector3D lo = grid->lower();
+    const QVector3D hi = lo + QVector3D(nx, ny, 0) * grid->size();
+    const float h = lo.z() + (z + 0.5f) * grid->size();
+    const float vbuf[] = {
+        lo.x(), lo.y(), h, 0, 0,
+        hi.x(), lo.y(), h, 1, 0,
+        lo.x(), hi.y(), h, 0, 1,
+        hi.x(), hi.y(), h, 1, 1};
+    vertices.bind();
+    vertices.allocate(vbuf, sizeof(vbuf));
+    vertices.release();
+    dirty = false;
+}
+
+void VoxelSlice::draw(const QMatrix4x4& transform, const QMatrix4x4& view)
+{
+    if (!grid)
+    {
+        return;
+    }
+    if (!shader.isLinked())
+    {
+        shader.link();
+    }
+    if (dirty)
+    {
+        upload();
+    }
+
+    // Drawn over the mesh, since the layer is usually inside it
+    glDisable(GL_DEPTH_TEST);
+    glEnable(GL_BLEND);
+    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+
+    shader.bind();
+    glUniformMatrix4fv(shader.uniformLocation("transform_matrix"),
+                       1, GL_FALSE, transform.data());
+    glUniformMatrix4fv(shader.uniformLocation("view_matrix"),
+                       1, GL_FALSE, view.data());
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, texture);
+    shader.setUniformValue("slice", 0);
+
+    vertices.bind();
+    const GLuint vp = shader.attributeLocation("vertex_position");
+    const GLuint vt = shader.attributeLocation("vertex_texcoord");
+    glEnableVertexAttribArray(vp);
+    glEnableVertexAttribArray(vt);
+    glVertexAttribPointer(vp, 3, GL_FLOAT, false, 5 * sizeof(GLfloat), 0);
+    glVertexAttribPointer(vt, 2, GL_FLOAT, false, 5 * sizeof(GLfloat),
+                          (GLvoid*)(3 * sizeof(GLfloat)));
+    glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+    glDisableVertexAttribArray(vp);
+    glDisableVertexAttribArray(vt);
+    vertices.release();
+
+    glBindTexture(GL_TEXTURE_2D, 0);
+    shader.release();
+    glDisable(GL_BLEND);
+    glEnable(GL_DEPTH_TEST);
+}
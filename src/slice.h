@@ -0,0 +1,43 @@
+#ifndef SLICE_H
+#define SLICE_H
+
+#include <QOpenGLBuffer>
+#include <QOpenGLShaderProgram>
+#include <QOpenGLFunctions>
+
+class VoxelGrid;
+
+/*
+ *  Overlay that shows one z layer of a VoxelGrid as a textured quad in
+ *  model space.  Inside voxels are blue; with a distance field, the band
+ *  outside the surface fades out from orange.
+ */
+class VoxelSlice : protected QOpenGLFunctions
+{
+public:
+    VoxelSlice();
+    ~VoxelSlice();
+
+    /*  Shows the middle layer of the grid, which isn't owned and must
+     *  stay alive until it is replaced (null hides the overlay) */
+    void set_grid(const VoxelGrid* grid);
+
+    /*  Moves up (or down, for negative steps) by whole layers */
+    void move(int steps);
+    int layer() const { return current_layer; }
+
+    void draw(const QMatrix4x4& transform, const QMatrix4x4& view);
+
+private:
+    void upload();
+
+    QOpenGLShaderProgram shader;
+    QOpenGLBuffer vertices;
+    GLuint texture;
+
+    const VoxelGrid* grid;
+    int current_layer;
+    bool dirty;
+};
+
+#endif // SLICE_H
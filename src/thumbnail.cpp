@@ -0,0 +1,280 @@
+#include <QDateTime>
+#include <QDir>
+#include <QMatrix4x4>
+#include <QOffscreenSurface>
+#include <QOpenGLBuffer>
+#include <QOpenGLContext>
+#include <QOpenGLFramebufferObject>
+#include <QOpenGLFunctions>
+#include <QOpenGLShaderProgram>
+#include <QStandardPaths>
+
+#include <algorithm>
+#include <cmath>
+#include <future>
+
+#include "thumbnail.h"
+#include "fingerprint.h"
+#include "glcore.h"
+#include "loader.h"
+#include "parallel.h"
+#include "preview.h"
+
+const int ThumbnailRenderer::SIZE;
+const size_t Thumbnailer::MAX_PENDING;
+
+QString thumbnail_cache_path(const QString& filename)
+{
+    const QFileInfo info(filename);
+    if (!info.exists())
+    {
+        return QString();
+    }
+
+    QByteArray key = info.absoluteFilePath().toUtf8();
+    const qint64 stamp[2] = {info.size(), info.lastModified().toMSecsSinceEpoch()};
+    key.append(reinterpret_cast<const char*>(stamp), sizeof(stamp));
+    return QString("%1/thumbnails/%2.png")
+        .arg(QStandardPaths::writableLocation(QStandardPaths::CacheLocation))
+        .arg(xxh64(key.constData(), key.size()), 16, 16, QChar('0'));
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+struct ThumbnailRenderer::Job
+{
+    const Mesh* mesh;
+    std::promise<QImage> result;
+};
+
+ThumbnailRenderer::ThumbnailRenderer(QObject* parent)
+    : QThread(parent), surface(new QOffscreenSurface), stopping(false)
+{
+    surface->setFormat(gl_surface_format(false));
+    surface->create();
+}
+
+ThumbnailRenderer::~ThumbnailRenderer()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    wake.notify_all();
+    wait();
+    delete surface;
+}
+
+QImage ThumbnailRenderer::render(const Mesh* mesh)
+{
+    Job job;
+    job.mesh = mesh;
+    auto result = job.result.get_future();
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        jobs.push_back(&job);
+    }
+    wake.notify_one();
+    return result.get();
+}
+
+void ThumbnailRenderer::run()
+{
+    // The context lives on this thread, so it's made here; if that
+    // fails, every job gets a null image
+    QOpenGLContext context;
+    context.setFormat(surface->format());
+    const bool ok = QOpenGLContext::supportsThreadedOpenGL() &&
+                    context.create() && context.makeCurrent(surface);
+
+    QOpenGLShaderProgram* shader = nullptr;
+    QOpenGLFramebufferObject* fbo = nullptr;
+    if (ok)
+    {
+        // The context is always OpenGL 2.1, even with --gl-core
+        shader = new QOpenGLShaderProgram;
+        shader->addShaderFromSourceFile(QOpenGLShader::Vertex, ":/gl/mesh.vert");
+        shader->addShaderFromSourceFile(QOpenGLShader::Fragment, ":/gl/mesh.frag");
+        shader->link();
+
+        QOpenGLFramebufferObjectFormat format;
+        format.setAttachment(QOpenGLFramebufferObject::Depth);
+        format.setSamples(4);
+        fbo = new QOpenGLFramebufferObject(SIZE, SIZE, format);
+    }
+
+    while (true)
+    {
+        Job* job;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            wake.wait(lock, [&]() { return stopping || !jobs.empty(); });
+            if (jobs.empty())
+            {
+                break;
+            }
+            job = jobs.front();
+            jobs.pop_front();
+        }
+
+        QImage image;
+        if (ok)
+        {
+            fbo->bind();
+            draw(*shader, *job->mesh);
+            image = fbo->toImage();
+            fbo->release();
+        }
+        job->result.set_value(image);
+    }
+
+    if (ok)
+    {
+        delete fbo;
+        delete shader;
+        context.doneCurrent();
+    }
+}
+
+void ThumbnailRenderer::draw(QOpenGLShaderProgram& shader, const Mesh& mesh)
+{
+    QOpenGLFunctions* gl = QOpenGLContext::currentContext()->functions();
+    gl->glViewport(0, 0, SIZE, SIZE);
+    gl->glClearColor(0, 0, 0, 0);
+    gl->glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+    gl->glEnable(GL_DEPTH_TEST);
+
+    // Same starting view as the canvas, fitted to the thumbnail
+    const QVector3D lower(mesh.xmin(), mesh.ymin(), mesh.zmin());
+    const QVector3D upper(mesh.xmax(), mesh.ymax(), mesh.zmax());
+    const QMatrix4x4 transform = starting_view(lower, upper);
+    QMatrix4x4 view;
+    view.scale(-1, 1, 0.5);
+
+    QOpenGLBuffer vertices(QOpenGLBuffer::VertexBuffer);
+    QOpenGLBuffer indices(QOpenGLBuffer::IndexBuffer);
+    vertices.create();
+    vertices.bind();
+    vertices.allocate(mesh.vertexData().data(), mesh.vertexData().size() * sizeof(GLfloat));
+    indices.create();
+    indices.bind();
+    indices.allocate(mesh.indexData().data(), mesh.indexData().size() * sizeof(GLuint));
+
+    shader.bind();
+    shader.setUniformValue("transform_matrix", transform);
+    shader.setUniformValue("view_matrix", view);
+    shader.setUniformValue("zoom", 1.0f);
+    const int position = shader.attributeLocation("vertex_position");
+    shader.enableAttributeArray(position);
+    shader.setAttributeBuffer(position, GL_FLOAT, 0, 3);
+    gl->glDrawElements(GL_TRIANGLES, mesh.indexData().size(), GL_UNSIGNED_INT, 0);
+    shader.disableAttributeArray(position);
+    shader.release();
+
+    vertices.release();
+    indices.release();
+    vertices.destroy();
+    indices.destroy();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+class ThumbnailJob : public QRunnable
+{
+public:
+    explicit ThumbnailJob(Thumbnailer* thumbnailer) : thumbnailer(thumbnailer) {}
+    void run() override { thumbnailer->work(); }
+private:
+    Thumbnailer* const thumbnailer;
+};
+
+Thumbnailer::Thumbnailer(QObject* parent)
+    : QObject(parent), renderer(nullptr)
+{
+    // Loading is itself partly parallel, so half the cores are enough
+    pool.setMaxThreadCount(std::max(1u, worker_count() / 2));
+}
+
+Thumbnailer::~Thumbnailer()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        pending.clear();
+    }
+    pool.waitForDone();
+}
+
+void Thumbnailer::request(const QString& filename)
+{
+    // The renderer (and its context) is only made once it's needed
+    if (!renderer)
+    {
+        renderer = new ThumbnailRenderer(this);
+        renderer->start();
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (queued.contains(filename))
+        {
+            // Moved to the back if it's still waiting
+            auto it = std::find(pending.begin(), pending.end(), filename);
+            if (it != pending.end())
+            {
+                pending.erase(it);
+                pending.push_back(filename);
+            }
+            return;
+        }
+        pending.push_back(filename);
+        queued.insert(filename);
+        if (pending.size() > MAX_PENDING)
+        {
+            queued.remove(pending.front());
+            pending.pop_front();
+        }
+    }
+
+    // Each job takes whichever file is newest when it starts, and
+    // there's one job per request, so dropped requests leave idle jobs
+    // rather than unserved files
+    pool.start(new ThumbnailJob(this));
+}
+
+void Thumbnailer::work()
+{
+    QString filename;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (pending.empty())
+        {
+            return;
+        }
+        filename = pending.back();
+        pending.pop_back();
+    }
+
+    const QString cached = thumbnail_cache_path(filename);
+    QImage image;
+    if (cached.isEmpty() || !image.load(cached))
+    {
+        QString error;
+        Mesh* mesh = Loader::load_now(filename, &error);
+        if (mesh)
+        {
+            image = renderer->render(mesh);
+            delete mesh;
+        }
+        if (!image.isNull() && !cached.isEmpty())
+        {
+            QDir().mkpath(QFileInfo(cached).path());
+            image.save(cached);
+        }
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        queued.remove(filename);
+    }
+    emit rendered(filename, image);
+}
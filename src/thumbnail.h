@@ -0,0 +1,92 @@
+#ifndef THUMBNAIL_H
+#define THUMBNAIL_H
+
+#include <QImage>
+#include <QSet>
+#include <QThread>
+#include <QThreadPool>
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+
+class Mesh;
+class QOffscreenSurface;
+class QOpenGLShaderProgram;
+
+/*  Returns where the thumbnail of a file is cached on disk (or an empty
+ *  string if the file doesn't exist).  The name hashes the file's path,
+ *  size and modification time, so edited files get new thumbnails. */
+QString thumbnail_cache_path(const QString& filename);
+
+/*
+ *  Thread that owns an offscreen OpenGL context and draws meshes into
+ *  thumbnails for any thread that asks.
+ */
+class ThumbnailRenderer : public QThread
+{
+    Q_OBJECT
+public:
+    explicit ThumbnailRenderer(QObject* parent);
+    ~ThumbnailRenderer();
+    void run();
+
+    /*  Draws the mesh on the renderer's thread and returns the image,
+     *  which is null if OpenGL isn't available off the GUI thread */
+    QImage render(const Mesh* mesh);
+
+    // Width and height of the thumbnails, in pixels
+    const static int SIZE = 128;
+
+private:
+    struct Job;
+    void draw(QOpenGLShaderProgram& shader, const Mesh& mesh);
+
+    // Created on the GUI thread, as Qt requires
+    QOffscreenSurface* const surface;
+
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::deque<Job*> jobs;
+    bool stopping;
+};
+
+/*
+ *  Makes thumbnails of .stl files on a pool of threads, reading them
+ *  from the disk cache where possible.  Each worker loads a file on its
+ *  own, then hands the mesh to the shared renderer.
+ */
+class Thumbnailer : public QObject
+{
+    Q_OBJECT
+public:
+    explicit Thumbnailer(QObject* parent);
+    ~Thumbnailer();
+
+    /*  Queues a thumbnail of the file ahead of earlier requests (so the
+     *  cells on screen now come before ones scrolled past), dropping
+     *  the oldest requests once there are too many.  The image (null
+     *  for unreadable files) arrives through rendered. */
+    void request(const QString& filename);
+
+signals:
+    void rendered(const QString& filename, const QImage& image);
+
+private:
+    void work();
+
+    QThreadPool pool;
+    ThumbnailRenderer* renderer;
+
+    // Files waiting for a worker (newest at the back), and every file
+    // that is waiting or being worked on
+    std::mutex mutex;
+    std::deque<QString> pending;
+    QSet<QString> queued;
+
+    const static size_t MAX_PENDING = 256;
+
+    friend class ThumbnailJob;
+};
+
+#endif // THUMBNAIL_H
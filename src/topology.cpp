@@ -0,0 +1,734 @@
+#include <QVector2D>
+#include <QVector3D>
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+
+#include "topology.h"
+#include "parallel.h"
+
+// Mark edges used by one triangle, and edges with no single triangle
+// across them (non-manifold edges, and the edges of degenerate triangles)
+static const GLuint OPEN_EDGE = 0xfffffffe;
+static const GLuint NO_TRIANGLE = 0xffffffff;
+
+// Shells with at least this many triangles are oriented by all workers
+// together, and frontiers narrower than this are expanded serially
+static const size_t LARGE_SHELL = 1 << 16;
+static const size_t PARALLEL_FRONTIER = 1 << 13;
+
+static bool degenerate(const GLuint* tri)
+{
+    return tri[0] == tri[1] || tri[1] == tri[2] || tri[2] == tri[0];
+}
+
+VertexTriangles vertex_triangles(size_t vertex_count,
+                                 const std::vector<GLuint>& indices)
+{
+    const size_t tri_count = indices.size() / 3;
+    std::vector<std::atomic<GLuint>> cursors(vertex_count);
+    parallel_for(tri_count, [&](size_t begin, size_t end, size_t)
+    {
+        for (size_t i=begin * 3; i < end * 3; ++i)
+        {
+            cursors[indices[i]].fetch_add(1, std::memory_order_relaxed);
+        }
+    });
+
+    VertexTriangles out;
+    out.offsets.assign(vertex_count + 1, 0);
+    for (size_t v=0; v < vertex_count; ++v)
+    {
+        out.offsets[v + 1] = out.offsets[v] + cursors[v].load();
+        cursors[v].store(out.offsets[v]);
+    }
+    out.incident.resize(tri_count * 3);
+    parallel_for(tri_count, [&](size_t begin, size_t end, size_t)
+    {
+        for (size_t t=begin; t < end; ++t)
+        {
+            for (int k=0; k < 3; ++k)
+            {
+                const GLuint i = cursors[indices[t*3 + k]].fetch_add(
+                        1, std::memory_order_relaxed);
+                out.incident[i] = t;
+            }
+        }
+    });
+    return out;
+}
+
+/*  Returns the triangle across each edge (from corner k to corner k + 1
+ *  of each triangle), or OPEN_EDGE or NO_TRIANGLE where there isn't one.
+ *  The edges of each kind are counted into open_edges and
+ *  nonmanifold_edges. */
+static std::vector<GLuint> build_neighbors(size_t vertex_count,
+                                           const std::vector<GLuint>& indices,
+                                           size_t* open_edges,
+                                           size_t* nonmanifold_edges)
+{
+    const size_t tri_count = indices.size() / 3;
+    const unsigned workers = worker_count();
+    const VertexTriangles around = vertex_triangles(vertex_count, indices);
+    const std::vector<GLuint>& offsets = around.offsets;
+    const std::vector<GLuint>& incident = around.incident;
+
+    // The triangle across each edge (from corner k to corner k + 1), found
+    // by searching the triangles around the edge's first vertex
+    std::vector<GLuint> neighbors(indices.size());
+    std::vector<size_t> open(workers, 0), nonmanifold(workers, 0);
+    parallel_for(tri_count, [&](size_t begin, size_t end, size_t w)
+    {
+        for (size_t t=begin; t < end; ++t)
+        {
+            const GLuint* tri = &indices[t * 3];
+            for (int k=0; k < 3; ++k)
+            {
+                neighbors[t*3 + k] = NO_TRIANGLE;
+            }
+            if (degenerate(tri))
+            {
+                continue;
+            }
+
+            for (int k=0; k < 3; ++k)
+            {
+                const GLuint a = tri[k];
+                const GLuint b = tri[(k + 1) % 3];
+                GLuint found = NO_TRIANGLE;
+                GLuint lowest = t;
+                int count = 0;
+                for (GLuint i=offsets[a]; i < offsets[a + 1]; ++i)
+                {
+                    const GLuint u = incident[i];
+                    const GLuint* other = &indices[size_t(u) * 3];
+                    if (u != t && !degenerate(other) &&
+                        (other[0] == b || other[1] == b || other[2] == b))
+                    {
+                        found = u;
+                        lowest = std::min(lowest, u);
+                        count++;
+                    }
+                }
+
+                if (count == 1)
+                {
+                    neighbors[t*3 + k] = found;
+                }
+                else if (count == 0)
+                {
+                    neighbors[t*3 + k] = OPEN_EDGE;
+                    open[w]++;
+                }
+                else if (lowest == t)
+                {
+                    nonmanifold[w]++;
+                }
+            }
+        }
+    });
+
+    *open_edges = 0;
+    *nonmanifold_edges = 0;
+    for (unsigned w=0; w < workers; ++w)
+    {
+        *open_edges += open[w];
+        *nonmanifold_edges += nonmanifold[w];
+    }
+    return neighbors;
+}
+
+WindingReport orient_shells(const std::vector<GLfloat>& vertices,
+                            std::vector<GLuint>& indices)
+{
+    WindingReport report = {0, 0, 0, 0, 0};
+    const size_t tri_count = indices.size() / 3;
+    const unsigned workers = worker_count();
+
+    const std::vector<GLuint> neighbors = build_neighbors(
+            vertices.size() / 3, indices,
+            &report.open_edges, &report.nonmanifold_edges);
+
+    // Find shells with a lock-free union-find.  Roots are always linked
+    // under the lower-numbered root, so each shell's root ends up being
+    // its first triangle.
+    std::vector<std::atomic<GLuint>> parent(tri_count);
+    parallel_for(tri_count, [&](size_t begin, size_t end, size_t)
+    {
+        for (size_t t=begin; t < end; ++t)
+        {
+            parent[t].store(t, std::memory_order_relaxed);
+        }
+    });
+    auto find = [&](GLuint t) -> GLuint
+    {
+        while (true)
+        {
+            GLuint p = parent[t].load();
+            if (p == t)
+            {
+                return t;
+            }
+            // Path halving: only ever moves a link closer to the root
+            const GLuint g = parent[p].load();
+            if (g != p)
+            {
+                parent[t].compare_exchange_weak(p, g);
+            }
+            t = g;
+        }
+    };
+    parallel_for(tri_count, [&](size_t begin, size_t end, size_t)
+    {
+        for (size_t t=begin; t < end; ++t)
+        {
+            for (int k=0; k < 3; ++k)
+            {
+                GLuint a = t;
+                GLuint b = neighbors[t*3 + k];
+                if (b >= OPEN_EDGE || b < a)
+                {
+                    continue;
+                }
+                while (true)
+                {
+                    a = find(a);
+                    b = find(b);
+                    if (a == b)
+                    {
+                        break;
+                    }
+                    if (a < b)
+                    {
+                        std::swap(a, b);
+                    }
+                    GLuint expected = a;
+                    if (parent[a].compare_exchange_strong(expected, b))
+                    {
+                        break;
+                    }
+                }
+            }
+        }
+    });
+
+    // Size each shell, then orient the largest ones first, so that one
+    // big shell doesn't leave the other workers idle at the end.
+    std::vector<std::atomic<GLuint>> sizes(tri_count);
+    parallel_for(tri_count, [&](size_t begin, size_t end, size_t)
+    {
+        for (size_t t=begin; t < end; ++t)
+        {
+            sizes[find(t)].fetch_add(1, std::memory_order_relaxed);
+        }
+    });
+    std::vector<std::atomic<GLuint>>().swap(parent);
+    std::vector<GLuint> roots;
+    for (size_t t=0; t < tri_count; ++t)
+    {
+        if (sizes[t].load(std::memory_order_relaxed))
+        {
+            roots.push_back(t);
+        }
+    }
+    std::sort(roots.begin(), roots.end(), [&](GLuint a, GLuint b)
+    {
+        return sizes[a].load(std::memory_order_relaxed) >
+               sizes[b].load(std::memory_order_relaxed);
+    });
+    // Shells this big are searched one at a time with every worker on
+    // the same frontier; the rest are shared out one shell per worker.
+    size_t large = 0;
+    while (large < roots.size() &&
+           sizes[roots[large]].load(std::memory_order_relaxed) >= LARGE_SHELL)
+    {
+        large++;
+    }
+    std::vector<std::atomic<GLuint>>().swap(sizes);
+    report.shells = roots.size();
+
+    // States are claimed with a compare-and-swap, so two workers reaching
+    // the same triangle agree on who set it (and on any disagreement).
+    enum : uint8_t { UNVISITED, KEEP, FLIP };
+    std::vector<std::atomic<uint8_t>> state(tri_count);
+    parallel_for(tri_count, [&](size_t begin, size_t end, size_t)
+    {
+        for (size_t t=begin; t < end; ++t)
+        {
+            state[t].store(UNVISITED, std::memory_order_relaxed);
+        }
+    });
+    std::vector<size_t> flipped(workers, 0), nonorientable(workers, 0);
+
+    struct Scan
+    {
+        bool consistent;
+        bool closed;
+        size_t flips;
+        double volume;
+    };
+    const Scan EMPTY_SCAN = {true, true, 0, 0};
+
+    // Visits triangle t, whose state is already set, appending the
+    // neighbours it claims to next
+    auto expand = [&](GLuint t, Scan& scan, std::vector<GLuint>& next)
+    {
+        const GLuint* tri = &indices[size_t(t) * 3];
+        const bool flip = state[t].load(std::memory_order_relaxed) == FLIP;
+        scan.flips += flip;
+
+        // Six times the signed volume of the tetrahedron from the
+        // origin, with the triangle as it will be wound
+        const GLfloat* p = &vertices[tri[0] * 3];
+        const GLfloat* q = &vertices[tri[1] * 3];
+        const GLfloat* s = &vertices[tri[2] * 3];
+        const double v = p[0] * (double(q[1])*s[2] - double(q[2])*s[1])
+                       + p[1] * (double(q[2])*s[0] - double(q[0])*s[2])
+                       + p[2] * (double(q[0])*s[1] - double(q[1])*s[0]);
+        scan.volume += flip ? -v : v;
+
+        for (int k=0; k < 3; ++k)
+        {
+            const GLuint n = neighbors[size_t(t)*3 + k];
+            if (n >= OPEN_EDGE)
+            {
+                scan.closed = false;
+                continue;
+            }
+
+            // The neighbour agrees if it runs the shared edge the
+            // other way, i.e. if b doesn't follow a in it
+            const GLuint a = tri[k];
+            const GLuint b = tri[(k + 1) % 3];
+            const GLuint* other = &indices[size_t(n) * 3];
+            const int j = other[0] == a ? 0 : (other[1] == a ? 1 : 2);
+            const bool same = other[(j + 1) % 3] == b;
+            const uint8_t wanted = (flip != same) ? FLIP : KEEP;
+
+            // Most neighbours are already claimed, so check before
+            // paying for the compare-and-swap
+            uint8_t current = state[n].load(std::memory_order_relaxed);
+            if (current == UNVISITED &&
+                state[n].compare_exchange_strong(current, wanted,
+                                                 std::memory_order_relaxed))
+            {
+                next.push_back(n);
+            }
+            else if (current != wanted)
+            {
+                scan.consistent = false;
+            }
+        }
+    };
+
+    // Closed shells face outwards; open ones keep the majority winding.
+    // Non-orientable shells (e.g. Mobius strips) can't be fixed, so they
+    // are left as they were.  Returns the number of triangles flipped.
+    auto settle = [&](const GLuint* shell, size_t count, Scan scan) -> size_t
+    {
+        bool invert;
+        if (!scan.consistent)
+        {
+            for (size_t i=0; i < count; ++i)
+            {
+                state[shell[i]].store(KEEP, std::memory_order_relaxed);
+            }
+            return 0;
+        }
+        else if (scan.closed)
+        {
+            invert = scan.volume < 0;
+        }
+        else
+        {
+            invert = scan.flips * 2 > count;
+        }
+
+        if (invert)
+        {
+            for (size_t i=0; i < count; ++i)
+            {
+                std::atomic<uint8_t>& s = state[shell[i]];
+                s.store(s.load(std::memory_order_relaxed) == FLIP ? KEEP : FLIP,
+                        std::memory_order_relaxed);
+            }
+            return count - scan.flips;
+        }
+        return scan.flips;
+    };
+
+    // Large shells: a level-synchronous breadth-first search, expanding
+    // each frontier in parallel.  Narrow frontiers (e.g. near the root)
+    // aren't worth starting threads for, so they are expanded here.
+    {
+        std::vector<GLuint> shell;
+        std::vector<std::vector<GLuint>> found(workers);
+        std::vector<Scan> scans(workers);
+        for (size_t r=0; r < large; ++r)
+        {
+            shell.clear();
+            shell.push_back(roots[r]);
+            state[roots[r]].store(KEEP, std::memory_order_relaxed);
+
+            Scan scan = EMPTY_SCAN;
+            size_t level = 0;
+            while (level < shell.size())
+            {
+                const size_t level_end = shell.size();
+                if (level_end - level < PARALLEL_FRONTIER)
+                {
+                    for (size_t i=level; i < level_end; ++i)
+                    {
+                        expand(shell[i], scan, shell);
+                    }
+                }
+                else
+                {
+                    parallel_for(level_end - level,
+                                 [&](size_t begin, size_t end, size_t w)
+                    {
+                        found[w].clear();
+                        scans[w] = EMPTY_SCAN;
+                        for (size_t i=begin; i < end; ++i)
+                        {
+                            expand(shell[level + i], scans[w], found[w]);
+                        }
+                    });
+                    for (unsigned w=0; w < workers; ++w)
+                    {
+                        shell.insert(shell.end(), found[w].begin(),
+                                     found[w].end());
+                        found[w].clear();
+                        scan.consistent &= scans[w].consistent;
+                        scan.closed &= scans[w].closed;
+                        scan.flips += scans[w].flips;
+                        scan.volume += scans[w].volume;
+                        scans[w] = EMPTY_SCAN;
+                    }
+                }
+                level = level_end;
+            }
+
+            if (!scan.consistent)
+            {
+                nonorientable[0]++;
+            }
+            flipped[0] += settle(shell.data(), shell.size(), scan);
+        }
+    }
+
+    // Small shells: one breadth-first search per worker at a time.
+    // Shells share no triangles, so this needs no coordination.
+    std::atomic<size_t> next_root(large);
+    parallel_for(workers, [&](size_t, size_t, size_t w)
+    {
+        std::vector<GLuint> queue;
+        while (true)
+        {
+            const size_t r = next_root.fetch_add(1);
+            if (r >= roots.size())
+            {
+                break;
+            }
+            queue.clear();
+            queue.push_back(roots[r]);
+            state[roots[r]].store(KEEP, std::memory_order_relaxed);
+
+            Scan scan = EMPTY_SCAN;
+            for (size_t head=0; head < queue.size(); ++head)
+            {
+                expand(queue[head], scan, queue);
+            }
+
+            if (!scan.consistent)
+            {
+                nonorientable[w]++;
+            }
+            flipped[w] += settle(queue.data(), queue.size(), scan);
+        }
+    });
+
+    parallel_for(tri_count, [&](size_t begin, size_t end, size_t)
+    {
+        for (size_t t=begin; t < end; ++t)
+        {
+            if (state[t].load(std::memory_order_relaxed) == FLIP)
+            {
+                std::swap(indices[t*3 + 1], indices[t*3 + 2]);
+            }
+        }
+    });
+
+    for (unsigned w=0; w < workers; ++w)
+    {
+        report.flipped += flipped[w];
+        report.nonorientable += nonorientable[w];
+    }
+    return report;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+// Holes up to this size get the minimum-area fill, and holes beyond the
+// larger one (e.g. the open base of a scan) aren't filled at all
+static const size_t MIN_AREA_EDGES = 24;
+static const size_t MAX_HOLE_EDGES = 1024;
+
+/*  Fills a hole with the triangulation of least total area, by dynamic
+ *  programming over the loop (cubic in its length, so only used for
+ *  small holes).  Triangles are appended to out in loop order. */
+static void fill_min_area(const std::vector<GLfloat>& vertices,
+                          const std::vector<GLuint>& loop,
+                          std::vector<GLuint>& out)
+{
+    const size_t n = loop.size();
+    auto point = [&](size_t i)
+    {
+        const GLfloat* p = &vertices[loop[i] * 3];
+        return QVector3D(p[0], p[1], p[2]);
+    };
+
+    // cost[i][j] is the least area of the polygon i, i + 1, ... j, closed
+    // by the edge from j back to i, and split[i][j] the third corner of
+    // the triangle on that edge.
+    std::vector<float> cost(n * n, 0);
+    std::vector<size_t> split(n * n, 0);
+    for (size_t span=2; span < n; ++span)
+    {
+        for (size_t i=0; i + span < n; ++i)
+        {
+            const size_t j = i + span;
+            float best = INFINITY;
+            for (size_t m=i + 1; m < j; ++m)
+            {
+                const float area = QVector3D::crossProduct(
+                        point(m) - point(i), point(j) - point(i)).length();
+                const float c = cost[i*n + m] + cost[m*n + j] + area;
+                if (c < best)
+                {
+                    best = c;
+                    split[i*n + j] = m;
+                }
+            }
+            cost[i*n + j] = best;
+        }
+    }
+
+    std::vector<std::pair<size_t, size_t>> todo = {{0, n - 1}};
+    while (!todo.empty())
+    {
+        const auto span = todo.back();
+        todo.pop_back();
+        if (span.second - span.first < 2)
+        {
+            continue;
+        }
+        const size_t m = split[span.first*n + span.second];
+        out.insert(out.end(), {loop[span.first], loop[m], loop[span.second]});
+        todo.push_back({span.first, m});
+        todo.push_back({m, span.second});
+    }
+}
+
+/*  Fills a hole by ear clipping, in the plane of its Newell normal (in
+ *  which the loop runs counter-clockwise).  Triangles are appended to out
+ *  in loop order. */
+static void fill_ear_clipping(const std::vector<GLfloat>& vertices,
+                              const std::vector<GLuint>& loop,
+                              std::vector<GLuint>& out)
+{
+    const size_t n = loop.size();
+    std::vector<QVector3D> points(n);
+    QVector3D normal;
+    for (size_t i=0; i < n; ++i)
+    {
+        const GLfloat* p = &vertices[loop[i] * 3];
+        points[i] = QVector3D(p[0], p[1], p[2]);
+    }
+    for (size_t i=0; i < n; ++i)
+    {
+        normal += QVector3D::crossProduct(points[i], points[(i + 1) % n]);
+    }
+    normal.normalize();
+
+    // Any basis of the plane with u x v along the normal
+    const QVector3D axis = fabs(normal.x()) < 0.9f ? QVector3D(1, 0, 0)
+                                                   : QVector3D(0, 1, 0);
+    const QVector3D u = QVector3D::crossProduct(axis, normal).normalized();
+    const QVector3D v = QVector3D::crossProduct(normal, u);
+    std::vector<QVector2D> flat(n);
+    for (size_t i=0; i < n; ++i)
+    {
+        flat[i] = QVector2D(QVector3D::dotProduct(points[i], u),
+                            QVector3D::dotProduct(points[i], v));
+    }
+
+    auto cross = [&](size_t a, size_t b, size_t c)
+    {
+        const QVector2D ab = flat[b] - flat[a];
+        const QVector2D ac = flat[c] - flat[a];
+        return ab.x() * ac.y() - ab.y() * ac.x();
+    };
+
+    std::vector<size_t> prev(n), next(n);
+    for (size_t i=0; i < n; ++i)
+    {
+        prev[i] = (i + n - 1) % n;
+        next[i] = (i + 1) % n;
+    }
+
+    size_t remaining = n;
+    size_t i = 0;
+    size_t misses = 0;
+    while (remaining > 3)
+    {
+        const size_t p = prev[i];
+        const size_t q = next[i];
+
+        // An ear is convex with no other corner inside it.  If a whole
+        // lap finds none (which a non-planar hole can cause), clip the
+        // next corner anyway so that the hole still closes.
+        bool ear = cross(p, i, q) > 0;
+        for (size_t j=next[q]; ear && j != p; j = next[j])
+        {
+            ear = !(cross(p, i, j) > 0 && cross(i, q, j) > 0 && cross(q, p, j) > 0);
+        }
+
+        if (ear || misses > remaining)
+        {
+            out.insert(out.end(), {loop[p], loop[i], loop[q]});
+            next[p] = q;
+            prev[q] = p;
+            remaining--;
+            misses = 0;
+            i = q;
+        }
+        else
+        {
+            misses++;
+            i = q;
+        }
+    }
+    out.insert(out.end(), {loop[prev[i]], loop[i], loop[next[i]]});
+}
+
+HoleReport fill_holes(const std::vector<GLfloat>& vertices,
+                      std::vector<GLuint>& indices)
+{
+    HoleReport report = {0, 0, 0};
+    const size_t tri_count = indices.size() / 3;
+
+    size_t open_edges, nonmanifold_edges;
+    const std::vector<GLuint> neighbors = build_neighbors(
+            vertices.size() / 3, indices, &open_edges, &nonmanifold_edges);
+
+    // Each open edge a -> b becomes b -> a on the boundary of its hole,
+    // which is the way round that the patch's triangles have to run.
+    // Edges are keyed by their start, so that each loop can be walked.
+    std::vector<uint64_t> edges;
+    edges.reserve(open_edges);
+    for (size_t t=0; t < tri_count; ++t)
+    {
+        for (int k=0; k < 3; ++k)
+        {
+            if (neighbors[t*3 + k] == OPEN_EDGE)
+            {
+                const uint64_t a = indices[t*3 + k];
+                const uint64_t b = indices[t*3 + (k + 1) % 3];
+                edges.push_back((b << 32) | a);
+            }
+        }
+    }
+    std::sort(edges.begin(), edges.end());
+
+    // Walk the loops.  Where several loops touch at a vertex, a walk can
+    // pass through it more than once; whenever it comes back to a vertex
+    // already on its path, the part since then is split off as a simple
+    // loop, so that no patch is built around a figure of eight.
+    std::vector<std::vector<GLuint>> loops;
+    std::vector<bool> used(edges.size(), false);
+    const GLuint OFF_PATH = 0xffffffff;
+    std::vector<GLuint> position(vertices.size() / 3, OFF_PATH);
+    std::vector<GLuint> path;
+    auto add_loop = [&](std::vector<GLuint> loop)
+    {
+        report.holes++;
+        if (loop.size() >= 3 && loop.size() <= MAX_HOLE_EDGES)
+        {
+            loops.push_back(std::move(loop));
+        }
+    };
+    for (size_t e=0; e < edges.size(); ++e)
+    {
+        if (used[e])
+        {
+            continue;
+        }
+        size_t edge = e;
+        while (true)
+        {
+            used[edge] = true;
+            const GLuint from = edges[edge] >> 32;
+            const GLuint to = edges[edge] & 0xffffffff;
+            position[from] = path.size();
+            path.push_back(from);
+
+            if (position[to] != OFF_PATH)
+            {
+                const size_t i = position[to];
+                for (size_t j=i; j < path.size(); ++j)
+                {
+                    position[path[j]] = OFF_PATH;
+                }
+                add_loop(std::vector<GLuint>(path.begin() + i, path.end()));
+                path.resize(i);
+                if (path.empty())
+                {
+                    break;
+                }
+            }
+
+            edge = std::lower_bound(edges.begin(), edges.end(),
+                                    uint64_t(to) << 32) - edges.begin();
+            while (edge < edges.size() && (edges[edge] >> 32) == to && used[edge])
+            {
+                edge++;
+            }
+            if (edge == edges.size() || (edges[edge] >> 32) != to)
+            {
+                // Broken chain, which can't be filled
+                for (GLuint v : path)
+                {
+                    position[v] = OFF_PATH;
+                }
+                path.clear();
+                break;
+            }
+        }
+    }
+
+    // Triangulate the holes in parallel, then append the patches
+    std::vector<std::vector<GLuint>> patches(loops.size());
+    parallel_for(loops.size(), [&](size_t begin, size_t end, size_t)
+    {
+        for (size_t i=begin; i < end; ++i)
+        {
+            if (loops[i].size() <= MIN_AREA_EDGES)
+            {
+                fill_min_area(vertices, loops[i], patches[i]);
+            }
+            else
+            {
+                fill_ear_clipping(vertices, loops[i], patches[i]);
+            }
+        }
+    });
+    for (const auto& patch : patches)
+    {
+        indices.insert(indices.end(), patch.begin(), patch.end());
+        report.triangles += patch.size() / 3;
+    }
+    report.filled = loops.size();
+    return report;
+}
@@ -0,0 +1,54 @@
+#ifndef TOPOLOGY_H
+#define TOPOLOGY_H
+
+#include <QtOpenGL/QtOpenGL>
+
+#include <vector>
+
+/*  Triangles around each vertex of an indexed mesh, as a compressed array
+ *  built with a parallel counting sort: the triangles around vertex v are
+ *  incident[offsets[v]] up to incident[offsets[v + 1]], in no particular
+ *  order. */
+struct VertexTriangles
+{
+    std::vector<GLuint> offsets;
+    std::vector<GLuint> incident;
+};
+VertexTriangles vertex_triangles(size_t vertex_count,
+                                 const std::vector<GLuint>& indices);
+
+/*  Counts from orient_shells.  Edges are counted once each. */
+struct WindingReport
+{
+    size_t shells;              // Groups of triangles joined by manifold edges
+    size_t flipped;             // Triangles whose winding was reversed
+    size_t open_edges;          // Edges used by a single triangle
+    size_t nonmanifold_edges;   // Edges used by more than two triangles
+    size_t nonorientable;       // Shells with no consistent winding (left as-is)
+};
+
+/*  Makes the winding of a welded, indexed mesh consistent, flipping
+ *  triangles in place.  Orientation is propagated across edges shared by
+ *  exactly two triangles; each closed shell then faces outwards, and each
+ *  open one keeps the winding of most of its triangles.  Triangles keep
+ *  their order, so per-face data stays valid. */
+WindingReport orient_shells(const std::vector<GLfloat>& vertices,
+                            std::vector<GLuint>& indices);
+
+/*  Counts from fill_holes */
+struct HoleReport
+{
+    size_t holes;               // Boundary loops found
+    size_t filled;              // Loops that were filled
+    size_t triangles;           // Triangles added
+};
+
+/*  Closes the holes in a welded, indexed mesh, appending triangles to the
+ *  end of indices (so existing triangles keep their order).  Small holes
+ *  get the triangulation of least area and larger ones are ear-clipped;
+ *  holes are triangulated in parallel.  The patches follow the winding
+ *  around each hole, so run orient_shells first if that is inconsistent. */
+HoleReport fill_holes(const std::vector<GLfloat>& vertices,
+                      std::vector<GLuint>& indices);
+
+#endif // TOPOLOGY_H
@@ -0,0 +1,414 @@
+#include <QFile>
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+
+#include "voxel.h"
+#include "mesh.h"
+#include "parallel.h"
+
+const int VoxelGrid::BRICK;
+const int VoxelGrid::MAX_RESOLUTION;
+const int VoxelGrid::MAX_BAND;
+
+/*  Counting-sorts triangles into a grid of cells.  range(t, lo, hi) sets
+ *  the inclusive box of cells that triangle t touches (leaving lo above
+ *  hi if it touches none).  On return, the triangles in cell c are
+ *  triangles[offsets[c]] up to triangles[offsets[c + 1]]. */
+template <typename F>
+static void bin_triangles(size_t tri_count, const int cells[3], F range,
+                          std::vector<size_t>& offsets,
+                          std::vector<GLuint>& triangles)
+{
+    const size_t cell_count = size_t(cells[0]) * cells[1] * cells[2];
+    auto for_cells = [&](size_t t, std::vector<std::atomic<size_t>>& cursors,
+                         bool scatter)
+    {
+        int lo[3], hi[3];
+        range(t, lo, hi);
+        for (int z=lo[2]; z <= hi[2]; ++z)
+        {
+            for (int y=lo[1]; y <= hi[1]; ++y)
+            {
+                for (int x=lo[0]; x <= hi[0]; ++x)
+                {
+                    const size_t c = x + size_t(cells[0]) * (y + size_t(cells[1]) * z);
+                    const size_t i = cursors[c].fetch_add(1, std::memory_order_relaxed);
+                    if (scatter)
+                    {
+                        triangles[i] = t;
+                    }
+                }
+            }
+        }
+    };
+
+    std::vector<std::atomic<size_t>> cursors(cell_count);
+    parallel_for(tri_count, [&](size_t begin, size_t end, size_t)
+    {
+        for (size_t t=begin; t < end; ++t)
+        {
+            for_cells(t, cursors, false);
+        }
+    });
+
+    offsets.assign(cell_count + 1, 0);
+    for (size_t c=0; c < cell_count; ++c)
+    {
+        offsets[c + 1] = offsets[c] + cursors[c].load();
+        cursors[c].store(offsets[c]);
+    }
+
+    triangles.resize(offsets[cell_count]);
+    parallel_for(tri_count, [&](size_t begin, size_t end, size_t)
+    {
+        for (size_t t=begin; t < end; ++t)
+        {
+            for_cells(t, cursors, true);
+        }
+    });
+}
+
+/*  Distance from p to the closest point of triangle abc (from Ericson's
+ *  Real-Time Collision Detection, section 5.1.5) */
+static float triangle_distance(const QVector3D& p, const QVector3D& a,
+                               const QVector3D& b, const QVector3D& c)
+{
+    const QVector3D ab = b - a;
+    const QVector3D ac = c - a;
+    const QVector3D ap = p - a;
+    const float d1 = QVector3D::dotProduct(ab, ap);
+    const float d2 = QVector3D::dotProduct(ac, ap);
+    if (d1 <= 0 && d2 <= 0)
+    {
+        return ap.length();
+    }
+
+    const QVector3D bp = p - b;
+    const float d3 = QVector3D::dotProduct(ab, bp);
+    const float d4 = QVector3D::dotProduct(ac, bp);
+    if (d3 >= 0 && d4 <= d3)
+    {
+        return bp.length();
+    }
+
+    const float vc = d1*d4 - d3*d2;
+    if (vc <= 0 && d1 >= 0 && d3 <= 0)
+    {
+        return (p - (a + ab * (d1 / (d1 - d3)))).length();
+    }
+
+    const QVector3D cp = p - c;
+    const float d5 = QVector3D::dotProduct(ab, cp);
+    const float d6 = QVector3D::dotProduct(ac, cp);
+    if (d6 >= 0 && d5 <= d6)
+    {
+        return cp.length();
+    }
+
+    const float vb = d5*d2 - d1*d6;
+    if (vb <= 0 && d2 >= 0 && d6 <= 0)
+    {
+        return (p - (a + ac * (d2 / (d2 - d6)))).length();
+    }
+
+    const float va = d3*d6 - d5*d4;
+    if (va <= 0 && (d4 - d3) >= 0 && (d5 - d6) >= 0)
+    {
+        return (p - (b + (c - b) * ((d4 - d3) / ((d4 - d3) + (d5 - d6))))).length();
+    }
+
+    const float denom = 1 / (va + vb + vc);
+    return (p - (a + ab * (vb * denom) + ac * (vc * denom))).length();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+VoxelGrid::VoxelGrid(const Mesh* mesh, int resolution, int band, bool winding)
+    : voxel(1), dims{1, 1, 1}, band(std::min(std::max(band, 0), MAX_BAND)),
+      inside_count(0)
+{
+    resolution = std::min(std::max(resolution, 1), MAX_RESOLUTION);
+    const QVector3D lo(mesh->xmin(), mesh->ymin(), mesh->zmin());
+    const QVector3D hi(mesh->xmax(), mesh->ymax(), mesh->zmax());
+    const QVector3D extent = hi - lo;
+    const float longest = std::max(std::max(extent.x(), extent.y()), extent.z());
+    if (longest > 0)
+    {
+        voxel = longest / resolution;
+    }
+
+    // Pad by the band and one voxel more, so the outside always shows
+    const int pad = this->band + 1;
+    for (int i=0; i < 3; ++i)
+    {
+        dims[i] = std::max(int(ceil(extent[i] / voxel)), 1) + 2 * pad;
+    }
+    origin = lo - QVector3D(pad, pad, pad) * voxel;
+    occupancy.resize(size_t(dims[0]) * dims[1] * dims[2]);
+
+    classify(mesh->vertices, mesh->indices, winding);
+    if (this->band)
+    {
+        compute_distance(mesh->vertices, mesh->indices);
+    }
+
+    const unsigned workers = worker_count();
+    std::vector<size_t> counts(workers, 0);
+    parallel_for(occupancy.size(), [&](size_t begin, size_t end, size_t w)
+    {
+        counts[w] = std::count(occupancy.begin() + begin,
+                               occupancy.begin() + end, 1);
+    });
+    for (unsigned w=0; w < workers; ++w)
+    {
+        inside_count += counts[w];
+    }
+}
+
+void VoxelGrid::classify(const std::vector<GLfloat>& vertices,
+                         const std::vector<GLuint>& indices, bool winding)
+{
+    // Cast one ray up z through the centre of every column of voxels.
+    // Triangles are binned by the columns of bricks that they cover, and
+    // each column of bricks is then filled by one worker.
+    const size_t tri_count = indices.size() / 3;
+    const int cells[3] = {(dims[0] + BRICK - 1) / BRICK,
+                          (dims[1] + BRICK - 1) / BRICK, 1};
+    auto point = [&](GLuint i) { return &vertices[i * 3]; };
+
+    std::vector<size_t> offsets;
+    std::vector<GLuint> triangles;
+    bin_triangles(tri_count, cells, [&](size_t t, int* lo, int* hi)
+    {
+        lo[2] = hi[2] = 0;
+        for (int j=0; j < 2; ++j)
+        {
+            float a = INFINITY, b = -INFINITY;
+            for (int k=0; k < 3; ++k)
+            {
+                const float f = point(indices[t*3 + k])[j];
+                a = std::min(a, f);
+                b = std::max(b, f);
+            }
+            // Columns whose centres fall in [a, b]
+            const int first = std::max(int(ceil((a - origin[j]) / voxel - 0.5f)), 0);
+            const int last = std::min(int(floor((b - origin[j]) / voxel - 0.5f)),
+                                      dims[j] - 1);
+            lo[j] = first / BRICK;
+            hi[j] = first > last ? lo[j] - 1 : last / BRICK;
+        }
+    }, offsets, triangles);
+
+    parallel_for(size_t(cells[0]) * cells[1], [&](size_t begin, size_t end, size_t)
+    {
+        std::vector<std::pair<float, int>> crossings;
+        for (size_t c=begin; c < end; ++c)
+        {
+            const int bx = c % cells[0];
+            const int by = c / cells[0];
+            for (int y=by * BRICK; y < std::min((by + 1) * BRICK, dims[1]); ++y)
+            {
+                for (int x=bx * BRICK; x < std::min((bx + 1) * BRICK, dims[0]); ++x)
+                {
+                    const QVector3D p = center(x, y, 0);
+                    crossings.clear();
+                    for (size_t i=offsets[c]; i < offsets[c + 1]; ++i)
+                    {
+                        const GLuint t = triangles[i];
+                        const GLfloat* a = point(indices[t*3]);
+                        const GLfloat* b = point(indices[t*3 + 1]);
+                        const GLfloat* d = point(indices[t*3 + 2]);
+
+                        // Edge functions, which are also the barycentric
+                        // weights (times the area) of the opposite corner
+                        auto edge = [&](const GLfloat* e0, const GLfloat* e1)
+                        {
+                            return (double(e1[0]) - e0[0]) * (double(p.y()) - e0[1]) -
+                                   (double(e1[1]) - e0[1]) * (double(p.x()) - e0[0]);
+                        };
+                        const double area = (double(b[0]) - a[0]) * (double(d[1]) - a[1]) -
+                                            (double(b[1]) - a[1]) * (double(d[0]) - a[0]);
+                        if (area == 0)
+                        {
+                            continue;
+                        }
+
+                        // A ray through an edge or corner hits exactly one
+                        // of the triangles sharing it: points on an edge
+                        // count for the triangle to its left if the edge
+                        // points up (or left, if it is flat).
+                        const double s = area > 0 ? 1 : -1;
+                        const GLfloat* corners[3] = {a, b, d};
+                        double w[3];
+                        bool covered = true;
+                        for (int k=0; k < 3 && covered; ++k)
+                        {
+                            const GLfloat* e0 = corners[(k + 1) % 3];
+                            const GLfloat* e1 = corners[(k + 2) % 3];
+                            w[k] = edge(e0, e1) * s;
+                            const double dx = (double(e1[0]) - e0[0]) * s;
+                            const double dy = (double(e1[1]) - e0[1]) * s;
+                            covered = w[k] > 0 ||
+                                      (w[k] == 0 && (dy > 0 || (dy == 0 && dx < 0)));
+                        }
+                        if (!covered)
+                        {
+                            continue;
+                        }
+
+                        const double z = (w[0] * a[2] + w[1] * b[2] + w[2] * d[2]) / (area * s);
+                        // Entering through a face that looks down is +1
+                        crossings.push_back({float(z), area > 0 ? -1 : 1});
+                    }
+                    std::sort(crossings.begin(), crossings.end());
+
+                    int count = 0;
+                    size_t next = 0;
+                    for (int z=0; z < dims[2]; ++z)
+                    {
+                        const float pz = origin.z() + (z + 0.5f) * voxel;
+                        for (; next < crossings.size() && crossings[next].first < pz; ++next)
+                        {
+                            count += winding ? crossings[next].second : 1;
+                        }
+                        occupancy[index(x, y, z)] = winding ? count != 0 : (count & 1);
+                    }
+                }
+            }
+        }
+    });
+}
+
+void VoxelGrid::compute_distance(const std::vector<GLfloat>& vertices,
+                                 const std::vector<GLuint>& indices)
+{
+    // Voxels start at the edge of the band, and each brick then takes
+    // the distance to every triangle that comes within the band of it.
+    const float limit = band * voxel;
+    distances.resize(occupancy.size());
+    parallel_for(occupancy.size(), [&](size_t begin, size_t end, size_t)
+    {
+        for (size_t i=begin; i < end; ++i)
+        {
+            distances[i] = occupancy[i] ? -limit : limit;
+        }
+    });
+
+    const size_t tri_count = indices.size() / 3;
+    const int cells[3] = {(dims[0] + BRICK - 1) / BRICK,
+                          (dims[1] + BRICK - 1) / BRICK,
+                          (dims[2] + BRICK - 1) / BRICK};
+    auto point = [&](GLuint i)
+    {
+        const GLfloat* p = &vertices[i * 3];
+        return QVector3D(p[0], p[1], p[2]);
+    };
+
+    // Voxels whose centres are within the band of a triangle's bounds
+    auto voxel_range = [&](size_t t, int* lo, int* hi)
+    {
+        for (int j=0; j < 3; ++j)
+        {
+            float a = INFINITY, b = -INFINITY;
+            for (int k=0; k < 3; ++k)
+            {
+                const float f = vertices[indices[t*3 + k] * 3 + j];
+                a = std::min(a, f);
+                b = std::max(b, f);
+            }
+            lo[j] = std::max(int(ceil((a - limit - origin[j]) / voxel - 0.5f)), 0);
+            hi[j] = std::min(int(floor((b + limit - origin[j]) / voxel - 0.5f)),
+                             dims[j] - 1);
+        }
+    };
+
+    std::vector<size_t> offsets;
+    std::vector<GLuint> triangles;
+    bin_triangles(tri_count, cells, [&](size_t t, int* lo, int* hi)
+    {
+        voxel_range(t, lo, hi);
+        for (int j=0; j < 3; ++j)
+        {
+            hi[j] = lo[j] > hi[j] ? lo[j] / BRICK - 1 : hi[j] / BRICK;
+            lo[j] /= BRICK;
+        }
+    }, offsets, triangles);
+
+    // Bricks own their voxels, so workers never write the same one
+    parallel_for(size_t(cells[0]) * cells[1] * cells[2],
+                 [&](size_t begin, size_t end, size_t)
+    {
+        for (size_t c=begin; c < end; ++c)
+        {
+            const int brick[3] = {int(c % cells[0]),
+                                  int(c / cells[0] % cells[1]),
+                                  int(c / cells[0] / cells[1])};
+            for (size_t i=offsets[c]; i < offsets[c + 1]; ++i)
+            {
+                const GLuint t = triangles[i];
+                const QVector3D a = point(indices[t*3]);
+                const QVector3D b = point(indices[t*3 + 1]);
+                const QVector3D d = point(indices[t*3 + 2]);
+
+                int lo[3], hi[3];
+                voxel_range(t, lo, hi);
+                for (int j=0; j < 3; ++j)
+                {
+                    lo[j] = std::max(lo[j], brick[j] * BRICK);
+                    hi[j] = std::min(hi[j], brick[j] * BRICK + BRICK - 1);
+                }
+
+                for (int z=lo[2]; z <= hi[2]; ++z)
+                {
+                    for (int y=lo[1]; y <= hi[1]; ++y)
+                    {
+                        for (int x=lo[0]; x <= hi[0]; ++x)
+                        {
+                            float& v = distances[index(x, y, z)];
+                            const float d2 = triangle_distance(center(x, y, z), a, b, d);
+                            if (d2 < fabs(v))
+                            {
+                                v = v < 0 ? -d2 : d2;
+                            }
+                        }
+                    }
+                }
+            }
+        }
+    });
+}
+
+bool VoxelGrid::save(const QString& filename, QString* error) const
+{
+    QFile file(filename);
+    if (!file.open(QIODevice::WriteOnly))
+    {
+        *error = "Could not open " + filename + " for writing";
+        return false;
+    }
+
+    const float lower[3] = {origin.x(), origin.y(), origin.z()};
+    bool okay = file.write("FSTLVOX1", 8) == 8 &&
+        file.write(reinterpret_cast<const char*>(dims), sizeof(dims)) == sizeof(dims) &&
+        file.write(reinterpret_cast<const char*>(lower), sizeof(lower)) == sizeof(lower) &&
+        file.write(reinterpret_cast<const char*>(&voxel), sizeof(voxel)) == sizeof(voxel) &&
+        file.write(reinterpret_cast<const char*>(&band), sizeof(band)) == sizeof(band);
+    if (okay && band)
+    {
+        const qint64 bytes = distances.size() * sizeof(float);
+        okay = file.write(reinterpret_cast<const char*>(distances.data()), bytes) == bytes;
+    }
+    else if (okay)
+    {
+        const qint64 bytes = occupancy.size();
+        okay = file.write(reinterpret_cast<const char*>(occupancy.data()), bytes) == bytes;
+    }
+
+    if (!okay)
+    {
+        *error = "Could not write " + filename;
+    }
+    return okay;
+}
@@ -0,0 +1,86 @@
+#ifndef VOXEL_H
+#define VOXEL_H
+
+#include <QString>
+#include <QVector3D>
+#include <QtOpenGL/QtOpenGL>
+
+#include <vector>
+
+class Mesh;
+
+/*
+ *  A voxel grid of a mesh, with each voxel marked as inside or outside
+ *  and (optionally) a narrow-band signed distance field.
+ *
+ *  Voxels are stored with x varying fastest, then y, then z; voxel
+ *  (x, y, z) is centred at lower() + (x + 0.5, y + 0.5, z + 0.5) * size().
+ *
+ *  Saved grids start with the magic "FSTLVOX1", then the three
+ *  dimensions (int32), lower corner (3 floats), voxel size (float) and
+ *  band (int32), then one byte per voxel (1 inside, 0 outside) if the
+ *  band is 0, or one float per voxel (the signed distance) otherwise.
+ *  Everything is in native (little-endian) byte order.
+ */
+class VoxelGrid
+{
+public:
+    /*  Voxelizes the mesh with resolution voxels along its longest side.
+     *  Inside is decided along rays in z by the even-odd rule, or by the
+     *  winding number if winding is set (which needs consistently wound
+     *  triangles, but lets shells overlap).  If band > 0, signed
+     *  distances (negative inside) are computed out to band voxels from
+     *  the surface (at most MAX_BAND), and clamped to that beyond it. */
+    VoxelGrid(const Mesh* mesh, int resolution, int band=0, bool winding=false);
+
+    int dimension(int axis) const { return dims[axis]; }
+    QVector3D lower() const { return origin; }
+    float size() const { return voxel; }
+    int bandWidth() const { return band; }
+    bool hasDistance() const { return !distances.empty(); }
+
+    bool inside(int x, int y, int z) const { return occupancy[index(x, y, z)]; }
+    float distance(int x, int y, int z) const { return distances[index(x, y, z)]; }
+
+    // Number of inside voxels, and the volume that they fill
+    size_t insideCount() const { return inside_count; }
+    double volume() const { return inside_count * double(voxel) * voxel * voxel; }
+
+    /*  Writes the grid in the format described above.  On failure,
+     *  returns false and sets error. */
+    bool save(const QString& filename, QString* error) const;
+
+    // Triangles are binned into cubes of this many voxels a side, which
+    // are then filled in parallel
+    const static int BRICK = 8;
+    const static int MAX_RESOLUTION = 1024;
+
+    // Widest distance band, in voxels (wider ones are clamped to this)
+    const static int MAX_BAND = MAX_RESOLUTION;
+
+private:
+    size_t index(int x, int y, int z) const
+    {
+        return x + size_t(dims[0]) * (y + size_t(dims[1]) * z);
+    }
+    QVector3D center(int x, int y, int z) const
+    {
+        return origin + QVector3D(x + 0.5f, y + 0.5f, z + 0.5f) * voxel;
+    }
+
+    void classify(const std::vector<GLfloat>& vertices,
+                  const std::vector<GLuint>& indices, bool winding);
+    void compute_distance(const std::vector<GLfloat>& vertices,
+                          const std::vector<GLuint>& indices);
+
+    QVector3D origin;
+    float voxel;
+    int dims[3];
+    int band;
+
+    std::vector<uint8_t> occupancy;
+    std::vector<float> distances;
+    size_t inside_count;
+};
+
+#endif // VOXEL_H
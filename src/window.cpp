@@ -1,21 +1,50 @@
 #include <QMenuBar>
+#include <QDockWidget>
+#include <QTreeWidget>
 
 #include "window.h"
 #include "canvas.h"
 #include "loader.h"
+#include "ingest.h"
+#include "lodmesh.h"
+#include "plate.h"
+#include "duplicates.h"
+#include "folderindex.h"
+#include "foldergrid.h"
+#include "qualitypanel.h"
+#include "glcore.h"
 
 const QString Window::RECENT_FILE_KEY = "recentFiles";
 const QString Window::INVERT_ZOOM_KEY = "invertZoom";
 const QString Window::AUTORELOAD_KEY = "autoreload";
+const QString Window::FACET_NORMALS_KEY = "facetNormals";
+const QString Window::FIX_WINDING_KEY = "fixWinding";
+const QString Window::FILL_HOLES_KEY = "fillHoles";
+const QString Window::ORIENT_FOR_PRINTING_KEY = "orientForPrinting";
+const QString Window::SHOW_SLICE_KEY = "showSlice";
+const int Window::VOXEL_RESOLUTION;
+const int Window::VOXEL_BAND;
+const QString Window::SHOW_ORIENTED_BOX_KEY = "showOrientedBox";
+const QString Window::SHOW_QUALITY_KEY = "showQuality";
+const QString Window::SHOW_FOLDER_GRID_KEY = "showFolderGrid";
 const QString Window::DRAW_AXES_KEY = "drawAxes";
 const QString Window::PROJECTION_KEY = "projection";
 const QString Window::DRAW_MODE_KEY = "drawMode";
+const QString Window::AUTO_SPLATS_KEY = "autoSplats";
+const QString Window::SHOW_PERFORMANCE_KEY = "showPerformance";
 const QString Window::WINDOW_GEOM_KEY = "windowGeometry";
 const QString Window::RESET_TRANSFORM_ON_LOAD_KEY = "resetTransformOnLoad";
 
-Window::Window(QWidget *parent) :
+static bool is_curvature(DrawMode mode)
+{
+    return mode == meancurvature || mode == gaussiancurvature;
+}
+
+Window::Window(QWidget *parent, bool core_gl) :
     QMainWindow(parent),
     open_action(new QAction("Open", this)),
+    pack_action(new QAction("Pack Parts...", this)),
+    duplicates_action(new QAction("Find Duplicates...", this)),
     about_action(new QAction("About", this)),
     quit_action(new QAction("Quit", this)),
     perspective_action(new QAction("Perspective", this)),
@@ -23,10 +52,25 @@ Window::Window(QWidget *parent) :
     shaded_action(new QAction("Shaded", this)),
     wireframe_action(new QAction("Wireframe", this)),
     surfaceangle_action(new QAction("Surface Angle", this)),
+    splats_action(new QAction("Splats", this)),
+    mean_curvature_action(new QAction("Mean Curvature", this)),
+    gaussian_curvature_action(new QAction("Gaussian Curvature", this)),
+    auto_splats_action(new QAction("Splat Dense Meshes", this)),
     axes_action(new QAction("Draw Axes", this)),
     invert_zoom_action(new QAction("Invert Zoom", this)),
+    performance_action(new QAction("Show Performance", this)),
+    slice_action(new QAction("Show Voxel Slice", this)),
+    slice_up_action(new QAction("Slice Up", this)),
+    slice_down_action(new QAction("Slice Down", this)),
+    oriented_box_action(new QAction("Show Oriented Box", this)),
+    quality_action(new QAction("Show Mesh Quality", this)),
+    folder_grid_action(new QAction("Show Folder Grid", this)),
     reload_action(new QAction("Reload", this)),
     autoreload_action(new QAction("Autoreload", this)),
+    facet_normals_action(new QAction("Use Facet Normals", this)),
+    fix_winding_action(new QAction("Fix Winding", this)),
+    fill_holes_action(new QAction("Fill Holes", this)),
+    orient_action(new QAction("Orient for Printing", this)),
     save_screenshot_action(new QAction("Save Screenshot", this)),
     hide_menuBar_action(new QAction("Hide Menu Bar", this)),
     fullscreen_action(new QAction("Toggle Fullscreen",this)),
@@ -34,6 +78,14 @@ Window::Window(QWidget *parent) :
     recent_files(new QMenu("Open recent", this)),
     recent_files_group(new QActionGroup(this)),
     recent_files_clear_action(new QAction("Clear recent files", this)),
+    duplicates_dock(new QDockWidget("Duplicates", this)),
+    duplicates_tree(new QTreeWidget(duplicates_dock)),
+    quality_dock(new QDockWidget("Mesh Quality", this)),
+    quality_panel(new QualityPanel(quality_dock)),
+    folder_index(new FolderIndex(this)),
+    folder_dock(new QDockWidget("Folder", this)),
+    folder_grid(new FolderGrid(folder_dock, folder_index)),
+    current_fingerprint(0),
     watcher(new QFileSystemWatcher(this))
 
 {
@@ -41,11 +93,9 @@ Window::Window(QWidget *parent) :
     setWindowIcon(QIcon(":/qt/icons/fstl_64x64.png"));
     setAcceptDrops(true);
 
-    QSurfaceFormat format;
-    format.setDepthBufferSize(24);
-    format.setStencilBufferSize(8);
-    format.setVersion(2, 1);
-    format.setProfile(QSurfaceFormat::CoreProfile);
+    // The OpenGL 4.5 core-profile renderer is opt-in, and falls back to
+    // the OpenGL 2.1 one if the driver can't provide such a context.
+    QSurfaceFormat format = gl_surface_format(core_gl && gl_core_available());
 
     QSurfaceFormat::setDefaultFormat(format);
     
@@ -60,6 +110,38 @@ Window::Window(QWidget *parent) :
                      this, &Window::on_open);
     this->addAction(open_action);
 
+    QObject::connect(pack_action, &QAction::triggered,
+                     this, &Window::on_pack);
+
+    QObject::connect(duplicates_action, &QAction::triggered,
+                     this, &Window::on_find_duplicates);
+
+    duplicates_tree->setHeaderHidden(true);
+    duplicates_dock->setObjectName("duplicates");
+    duplicates_dock->setWidget(duplicates_tree);
+    duplicates_dock->hide();
+    addDockWidget(Qt::LeftDockWidgetArea, duplicates_dock);
+    QObject::connect(duplicates_tree, &QTreeWidget::itemActivated,
+                     this, &Window::on_duplicate_activated);
+
+    // Hidden and shown through its menu item, so that the setting and
+    // the dock can't disagree
+    quality_dock->setObjectName("quality");
+    quality_dock->setWidget(quality_panel);
+    quality_dock->setFeatures(QDockWidget::DockWidgetMovable |
+                              QDockWidget::DockWidgetFloatable);
+    quality_dock->hide();
+    addDockWidget(Qt::RightDockWidgetArea, quality_dock);
+
+    folder_dock->setObjectName("folder");
+    folder_dock->setWidget(folder_grid);
+    folder_dock->setFeatures(QDockWidget::DockWidgetMovable |
+                             QDockWidget::DockWidgetFloatable);
+    folder_dock->hide();
+    addDockWidget(Qt::BottomDockWidgetArea, folder_dock);
+    QObject::connect(folder_grid, &FolderGrid::file_activated,
+                     this, &Window::on_folder_activated);
+
     quit_action->setShortcut(QKeySequence::Quit);
     QObject::connect(quit_action, &QAction::triggered,
                      this, &Window::close);
@@ -69,6 +151,22 @@ Window::Window(QWidget *parent) :
     QObject::connect(autoreload_action, &QAction::triggered,
             this, &Window::on_autoreload_triggered);
 
+    facet_normals_action->setCheckable(true);
+    QObject::connect(facet_normals_action, &QAction::triggered,
+            this, &Window::on_facetNormals);
+
+    fix_winding_action->setCheckable(true);
+    QObject::connect(fix_winding_action, &QAction::triggered,
+            this, &Window::on_fixWinding);
+
+    fill_holes_action->setCheckable(true);
+    QObject::connect(fill_holes_action, &QAction::triggered,
+            this, &Window::on_fillHoles);
+
+    orient_action->setCheckable(true);
+    QObject::connect(orient_action, &QAction::triggered,
+            this, &Window::on_orientForPrinting);
+
     reload_action->setShortcut(QKeySequence::Refresh);
     reload_action->setEnabled(false);
     QObject::connect(reload_action, &QAction::triggered,
@@ -81,6 +179,8 @@ Window::Window(QWidget *parent) :
                      this, &Window::on_clear_recent);
     QObject::connect(recent_files_group, &QActionGroup::triggered,
                      this, &Window::on_load_recent);
+    recent_files->setStyle(preview_menu_style(recent_files));
+    recent_files->setToolTipsVisible(true);
 
     save_screenshot_action->setCheckable(false);
     QObject::connect(save_screenshot_action, &QAction::triggered, 
@@ -90,10 +190,16 @@ Window::Window(QWidget *parent) :
 
     auto file_menu = menuBar()->addMenu("File");
     file_menu->addAction(open_action);
+    file_menu->addAction(pack_action);
+    file_menu->addAction(duplicates_action);
     file_menu->addMenu(recent_files);
     file_menu->addSeparator();
     file_menu->addAction(reload_action);
     file_menu->addAction(autoreload_action);
+    file_menu->addAction(facet_normals_action);
+    file_menu->addAction(fix_winding_action);
+    file_menu->addAction(fill_holes_action);
+    file_menu->addAction(orient_action);
     file_menu->addAction(save_screenshot_action);
     file_menu->addAction(quit_action);
 
@@ -115,8 +221,12 @@ Window::Window(QWidget *parent) :
     draw_menu->addAction(shaded_action);
     draw_menu->addAction(wireframe_action);
     draw_menu->addAction(surfaceangle_action);
+    draw_menu->addAction(splats_action);
+    draw_menu->addAction(mean_curvature_action);
+    draw_menu->addAction(gaussian_curvature_action);
     auto drawModes = new QActionGroup(draw_menu);
-    for (auto p : {shaded_action, wireframe_action, surfaceangle_action})
+    for (auto p : {shaded_action, wireframe_action, surfaceangle_action, splats_action,
+                   mean_curvature_action, gaussian_curvature_action})
     {
         drawModes->addAction(p);
         p->setCheckable(true);
@@ -124,11 +234,53 @@ Window::Window(QWidget *parent) :
     drawModes->setExclusive(true);
     QObject::connect(drawModes, &QActionGroup::triggered,
                      this, &Window::on_drawMode);
+    draw_menu->addSeparator();
+    draw_menu->addAction(auto_splats_action);
+    auto_splats_action->setCheckable(true);
+    QObject::connect(auto_splats_action, &QAction::triggered,
+            this, &Window::on_autoSplats);
     view_menu->addAction(axes_action);
     axes_action->setCheckable(true);
     QObject::connect(axes_action, &QAction::triggered,
             this, &Window::on_drawAxes);
 
+    view_menu->addAction(performance_action);
+    performance_action->setCheckable(true);
+    QObject::connect(performance_action, &QAction::triggered,
+            this, &Window::on_showPerformance);
+
+    view_menu->addAction(slice_action);
+    slice_action->setCheckable(true);
+    QObject::connect(slice_action, &QAction::triggered,
+            this, &Window::on_showSlice);
+
+    view_menu->addAction(slice_up_action);
+    slice_up_action->setShortcut(Qt::Key_PageUp);
+    QObject::connect(slice_up_action, &QAction::triggered,
+            this, &Window::on_sliceUp);
+    this->addAction(slice_up_action);
+
+    view_menu->addAction(slice_down_action);
+    slice_down_action->setShortcut(Qt::Key_PageDown);
+    QObject::connect(slice_down_action, &QAction::triggered,
+            this, &Window::on_sliceDown);
+    this->addAction(slice_down_action);
+
+    view_menu->addAction(oriented_box_action);
+    oriented_box_action->setCheckable(true);
+    QObject::connect(oriented_box_action, &QAction::triggered,
+            this, &Window::on_showOrientedBox);
+
+    view_menu->addAction(quality_action);
+    quality_action->setCheckable(true);
+    QObject::connect(quality_action, &QAction::triggered,
+            this, &Window::on_showQuality);
+
+    view_menu->addAction(folder_grid_action);
+    folder_grid_action->setCheckable(true);
+    QObject::connect(folder_grid_action, &QAction::triggered,
+            this, &Window::on_showFolderGrid);
+
     view_menu->addAction(invert_zoom_action);
     invert_zoom_action->setCheckable(true);
     QObject::connect(invert_zoom_action, &QAction::triggered,
@@ -171,6 +323,30 @@ void Window::load_persist_settings(){
     resetTransformOnLoadAction->setChecked(resetTransformOnLoad);
 
     autoreload_action->setChecked(settings.value(AUTORELOAD_KEY, true).toBool());
+    facet_normals_action->setChecked(settings.value(FACET_NORMALS_KEY, false).toBool());
+    fix_winding_action->setChecked(settings.value(FIX_WINDING_KEY, false).toBool());
+    fill_holes_action->setChecked(settings.value(FILL_HOLES_KEY, false).toBool());
+    orient_action->setChecked(settings.value(ORIENT_FOR_PRINTING_KEY, false).toBool());
+
+    bool show_performance = settings.value(SHOW_PERFORMANCE_KEY, false).toBool();
+    canvas->show_performance(show_performance);
+    performance_action->setChecked(show_performance);
+
+    bool show_slice = settings.value(SHOW_SLICE_KEY, false).toBool();
+    canvas->show_slice(show_slice);
+    slice_action->setChecked(show_slice);
+
+    bool show_oriented_box = settings.value(SHOW_ORIENTED_BOX_KEY, false).toBool();
+    canvas->show_oriented_box(show_oriented_box);
+    oriented_box_action->setChecked(show_oriented_box);
+
+    bool show_quality = settings.value(SHOW_QUALITY_KEY, false).toBool();
+    quality_dock->setVisible(show_quality);
+    quality_action->setChecked(show_quality);
+
+    bool show_folder_grid = settings.value(SHOW_FOLDER_GRID_KEY, false).toBool();
+    folder_dock->setVisible(show_folder_grid);
+    folder_grid_action->setChecked(show_folder_grid);
 
     bool draw_axes = settings.value(DRAW_AXES_KEY, false).toBool();
     canvas->draw_axes(draw_axes);
@@ -192,9 +368,14 @@ void Window::load_persist_settings(){
         draw_mode = shaded;
     }
     canvas->set_drawMode(draw_mode);
-    QAction* (dm_acts[]) = {shaded_action, wireframe_action, surfaceangle_action};
+    QAction* (dm_acts[]) = {shaded_action, wireframe_action, surfaceangle_action, splats_action,
+                            mean_curvature_action, gaussian_curvature_action};
     dm_acts[draw_mode]->setChecked(true);
 
+    bool auto_splats = settings.value(AUTO_SPLATS_KEY, false).toBool();
+    canvas->auto_splats(auto_splats);
+    auto_splats_action->setChecked(auto_splats);
+
     resize(600, 400);
     restoreGeometry(settings.value(WINDOW_GEOM_KEY).toByteArray());
 }
@@ -202,13 +383,104 @@ void Window::load_persist_settings(){
 void Window::on_open()
 {
     const QString filename = QFileDialog::getOpenFileName(
-                this, "Load .stl file", QString(), "STL files (*.stl *.STL)");
+                this, "Load .stl file", QString(), "STL files (*.stl *.STL);;LOD files (*.fstllod)");
     if (!filename.isNull())
     {
         load_stl(filename);
     }
 }
 
+void Window::on_pack()
+{
+    const QStringList filenames = QFileDialog::getOpenFileNames(
+                this, "Pack .stl files onto a plate", QString(), "STL files (*.stl *.STL)");
+    if (!filenames.isEmpty())
+    {
+        load_plate(filenames);
+    }
+}
+
+void Window::on_find_duplicates()
+{
+    const QString folder = QFileDialog::getExistingDirectory(
+                this, "Find duplicate parts in folder");
+    if (folder.isNull())
+    {
+        return;
+    }
+
+    duplicates_tree->clear();
+    duplicates_dock->setWindowTitle("Duplicates");
+    duplicates_dock->show();
+    duplicates_action->setEnabled(false);
+
+    DuplicateFinder* finder = new DuplicateFinder(this, folder);
+    connect(finder, &DuplicateFinder::progress,
+              this, &Window::on_duplicate_progress);
+    connect(finder, &DuplicateFinder::got_groups,
+              this, &Window::on_duplicates);
+    connect(finder, &DuplicateFinder::finished,
+            finder, &DuplicateFinder::deleteLater);
+    finder->start();
+}
+
+void Window::on_duplicate_progress(int done, int total)
+{
+    duplicates_dock->setWindowTitle(
+            QString("Checking %1 of %2 files").arg(done).arg(total));
+}
+
+void Window::on_duplicates(const QList<QStringList>& groups,
+                           const QStringList& unreadable)
+{
+    duplicates_action->setEnabled(true);
+    duplicates_dock->setWindowTitle(
+            QString("Duplicates (%1 groups)").arg(groups.size()));
+
+    // Each group lists its files, which load when activated
+    for (const auto& group : groups)
+    {
+        QTreeWidgetItem* item = new QTreeWidgetItem(duplicates_tree,
+                QStringList(QString("%1 copies of %2").arg(group.size())
+                            .arg(QFileInfo(group.first()).fileName())));
+        for (const auto& file : group)
+        {
+            QTreeWidgetItem* child = new QTreeWidgetItem(
+                    item, QStringList(QFileInfo(file).fileName()));
+            child->setToolTip(0, file);
+            child->setData(0, Qt::UserRole, file);
+        }
+        item->setExpanded(true);
+    }
+    if (groups.isEmpty())
+    {
+        new QTreeWidgetItem(duplicates_tree, QStringList("No duplicates found"));
+    }
+    if (!unreadable.isEmpty())
+    {
+        QTreeWidgetItem* item = new QTreeWidgetItem(duplicates_tree,
+                QStringList(QString("%1 unreadable files").arg(unreadable.size())));
+        for (const auto& error : unreadable)
+        {
+            new QTreeWidgetItem(item, QStringList(error));
+        }
+    }
+}
+
+void Window::on_duplicate_activated(QTreeWidgetItem* item)
+{
+    const QString file = item->data(0, Qt::UserRole).toString();
+    if (!file.isEmpty())
+    {
+        load_stl(file);
+    }
+}
+
+void Window::on_folder_activated(const QString& filename)
+{
+    load_stl(filename);
+}
+
 void Window::on_about()
 {
     QMessageBox::about(this, "",
@@ -243,14 +515,32 @@ void Window::on_missing_file()
                           "The target file is missing.<br>");
 }
 
+void Window::on_ingest_error(const QString& message)
+{
+    QMessageBox::critical(this, "Error",
+                          "<b>Error:</b><br>"
+                          "Could not start shared-memory ingest.<br>" +
+                          message.toHtmlEscaped());
+}
+
+void Window::on_plate_error(const QString& message)
+{
+    QMessageBox::critical(this, "Error",
+                          "<b>Error:</b><br>"
+                          "Some parts could not be loaded.<br>" +
+                          message.toHtmlEscaped().replace("\n", "<br>"));
+}
+
 void Window::enable_open()
 {
     open_action->setEnabled(true);
+    pack_action->setEnabled(true);
 }
 
 void Window::disable_open()
 {
     open_action->setEnabled(false);
+    pack_action->setEnabled(false);
 }
 
 void Window::set_watched(const QString& filename)
@@ -272,6 +562,7 @@ void Window::set_watched(const QString& filename)
         recent.pop_back();
     }
     settings.setValue(RECENT_FILE_KEY, recent);
+    recent_cache.retain(recent);
     rebuild_recent_files();
 }
 
@@ -300,12 +591,34 @@ void Window::on_drawMode(QAction* act)
     {
         mode = wireframe;
     }
-    else
+    else if (act == surfaceangle_action)
     {
         mode = surfaceangle;
     }
+    else if (act == mean_curvature_action)
+    {
+        mode = meancurvature;
+    }
+    else if (act == gaussian_curvature_action)
+    {
+        mode = gaussiancurvature;
+    }
+    else
+    {
+        mode = splats;
+    }
+
+    // Curvature is estimated while loading, so switching to it reloads
+    // the current file (as with voxel slices)
+    QSettings settings;
+    const bool had_curvature = is_curvature(
+            (DrawMode)settings.value(DRAW_MODE_KEY, shaded).toInt());
     canvas->set_drawMode(mode);
-    QSettings().setValue(DRAW_MODE_KEY, mode);
+    settings.setValue(DRAW_MODE_KEY, mode);
+    if (is_curvature(mode) && !had_curvature)
+    {
+        on_reload();
+    }
 }
 
 void Window::on_drawAxes(bool d)
@@ -320,6 +633,98 @@ void Window::on_invertZoom(bool d)
     QSettings().setValue(INVERT_ZOOM_KEY, d);
 }
 
+void Window::on_showPerformance(bool d)
+{
+    canvas->show_performance(d);
+    QSettings().setValue(SHOW_PERFORMANCE_KEY, d);
+}
+
+void Window::on_showSlice(bool d)
+{
+    // Grids are only built while the slice is shown, so reload to build
+    // one for the current mesh
+    canvas->show_slice(d);
+    QSettings().setValue(SHOW_SLICE_KEY, d);
+    if (d)
+    {
+        on_reload();
+    }
+}
+
+void Window::on_sliceUp()
+{
+    canvas->move_slice(1);
+}
+
+void Window::on_sliceDown()
+{
+    canvas->move_slice(-1);
+}
+
+void Window::on_showOrientedBox(bool d)
+{
+    // Like voxel grids, boxes are only measured while they're shown
+    canvas->show_oriented_box(d);
+    QSettings().setValue(SHOW_ORIENTED_BOX_KEY, d);
+    if (d)
+    {
+        on_reload();
+    }
+}
+
+void Window::on_showQuality(bool d)
+{
+    // Quality is only measured while the panel is shown
+    quality_dock->setVisible(d);
+    QSettings().setValue(SHOW_QUALITY_KEY, d);
+    if (d)
+    {
+        on_reload();
+    }
+    else
+    {
+        quality_panel->set_report(nullptr);
+    }
+}
+
+void Window::on_showFolderGrid(bool d)
+{
+    folder_dock->setVisible(d);
+    QSettings().setValue(SHOW_FOLDER_GRID_KEY, d);
+}
+
+void Window::on_autoSplats(bool d)
+{
+    canvas->auto_splats(d);
+    QSettings().setValue(AUTO_SPLATS_KEY, d);
+}
+
+void Window::on_facetNormals(bool d)
+{
+    // The normals are read (or skipped) by the loader, so reload to
+    // check the current file
+    QSettings().setValue(FACET_NORMALS_KEY, d);
+    on_reload();
+}
+
+void Window::on_fixWinding(bool d)
+{
+    QSettings().setValue(FIX_WINDING_KEY, d);
+    on_reload();
+}
+
+void Window::on_fillHoles(bool d)
+{
+    QSettings().setValue(FILL_HOLES_KEY, d);
+    on_reload();
+}
+
+void Window::on_orientForPrinting(bool d)
+{
+    QSettings().setValue(ORIENT_FOR_PRINTING_KEY, d);
+    on_reload();
+}
+
 void Window::on_resetTransformOnLoad(bool d) {
     canvas->setResetTransformOnLoad(d);
     QSettings().setValue(RESET_TRANSFORM_ON_LOAD_KEY, d);
@@ -327,9 +732,11 @@ void Window::on_resetTransformOnLoad(bool d) {
 
 void Window::on_watched_change(const QString& filename)
 {
+    // Editors often touch files without changing them, which needn't
+    // rebuild the mesh
     if (autoreload_action->isChecked())
     {
-        load_stl(filename, true);
+        load_stl(filename, true, true);
     }
 }
 
@@ -346,6 +753,7 @@ void Window::on_clear_recent()
 {
     QSettings settings;
     settings.setValue(RECENT_FILE_KEY, QStringList());
+    recent_cache.retain(QStringList());
     rebuild_recent_files();
 }
 
@@ -357,6 +765,19 @@ void Window::on_load_recent(QAction* a)
 void Window::on_loaded(const QString& filename)
 {
     current_file = filename;
+    folder_index->set_file(filename);
+}
+
+void Window::on_fingerprint(quint64 fingerprint)
+{
+    current_fingerprint = fingerprint;
+}
+
+void Window::on_summary(FileSummary* summary)
+{
+    // Saved once set_watched has put the file in the recent list
+    recent_cache.store(*summary);
+    delete summary;
 }
 
 void Window::on_save_screenshot()
@@ -410,9 +831,24 @@ void Window::rebuild_recent_files()
     }
     recent_files->clear();
 
+    // Only the cache is read here, so the menu doesn't wait on the disk
     for (auto f : files)
     {
         const auto a = new QAction(f, recent_files);
+        const FileSummary* s = recent_cache.find(f);
+        if (s)
+        {
+            const QVector3D d = s->upper - s->lower;
+            a->setText(QString("%1  (%2 triangles, %3 x %4 x %5)")
+                           .arg(QFileInfo(f).fileName())
+                           .arg(QLocale().toString(s->triangles))
+                           .arg(d.x(), 0, 'g', 4).arg(d.y(), 0, 'g', 4)
+                           .arg(d.z(), 0, 'g', 4));
+            a->setIcon(QIcon(QPixmap::fromImage(s->preview)));
+            a->setToolTip(QString("%1\n%2 KB, last loaded %3")
+                              .arg(f).arg((s->size + 1023) / 1024)
+                              .arg(QLocale().toString(s->loaded, QLocale::ShortFormat)));
+        }
         a->setData(f);
         recent_files_group->addAction(a);
         recent_files->addAction(a);
@@ -436,18 +872,44 @@ void Window::on_reload()
     }
 }
 
-bool Window::load_stl(const QString& filename, bool is_reload)
+bool Window::load_stl(const QString& filename, bool is_reload,
+                      bool skip_unchanged)
 {
     if (!open_action->isEnabled())  return false;
 
+    if (filename.endsWith(".fstllod", Qt::CaseInsensitive))
+        return load_lod(filename);
+
     canvas->set_status("Loading " + filename);
 
-    Loader* loader = new Loader(this, filename, is_reload);
+    const int repairs =
+        (fix_winding_action->isChecked() ? Mesh::FIX_WINDING : 0) |
+        (fill_holes_action->isChecked() ? Mesh::FILL_HOLES : 0);
+    Loader* loader = new Loader(this, filename, is_reload,
+                                facet_normals_action->isChecked(), repairs);
     connect(loader, &Loader::started,
               this, &Window::disable_open);
 
+    if (slice_action->isChecked())
+    {
+        loader->set_voxelize(VOXEL_RESOLUTION, VOXEL_BAND);
+    }
+    loader->set_oriented_box(oriented_box_action->isChecked());
+    loader->set_print_orientation(orient_action->isChecked());
+    loader->set_curvature(mean_curvature_action->isChecked() ||
+                          gaussian_curvature_action->isChecked());
+    loader->set_quality(quality_action->isChecked());
+    if (skip_unchanged && filename == current_file)
+    {
+        loader->set_unchanged_fingerprint(current_fingerprint);
+    }
+
     connect(loader, &Loader::got_mesh,
             canvas, &Canvas::load_mesh);
+    connect(loader, &Loader::got_voxels,
+            canvas, &Canvas::load_voxels);
+    connect(loader, &Loader::got_quality,
+            quality_panel, &QualityPanel::set_report);
     connect(loader, &Loader::error_bad_stl,
               this, &Window::on_bad_stl);
     connect(loader, &Loader::error_empty_mesh,
@@ -462,7 +924,8 @@ bool Window::load_stl(const QString& filename, bool is_reload)
     connect(loader, &Loader::finished,
             canvas, &Canvas::clear_status);
 
-    if (filename[0] != ':')
+    // Resources and stdin ("-") can't be watched or reopened later
+    if (filename[0] != ':' && filename != "-")
     {
         connect(loader, &Loader::loaded_file,
                   this, &Window::setWindowTitle);
@@ -470,6 +933,11 @@ bool Window::load_stl(const QString& filename, bool is_reload)
                   this, &Window::set_watched);
         connect(loader, &Loader::loaded_file,
                   this, &Window::on_loaded);
+        connect(loader, &Loader::loaded_fingerprint,
+                  this, &Window::on_fingerprint);
+        connect(loader, &Loader::got_summary,
+                  this, &Window::on_summary);
+        loader->set_summary(true);
         reload_action->setEnabled(true);
     }
 
@@ -477,137 +945,144 @@ bool Window::load_stl(const QString& filename, bool is_reload)
     return true;
 }
 
-void Window::dragEnterEvent(QDragEnterEvent *event)
+bool Window::load_plate(const QStringList& filenames)
 {
-    if (event->mimeData()->hasUrls())
+    if (!open_action->isEnabled())  return false;
+
+    canvas->set_status(QString("Packing %1 parts").arg(filenames.size()));
+
+    PlateLoader* loader = new PlateLoader(this, filenames);
+    connect(loader, &PlateLoader::started,
+              this, &Window::disable_open);
+    connect(loader, &PlateLoader::got_plate,
+            canvas, &Canvas::load_plate);
+    connect(loader, &PlateLoader::error_parts,
+              this, &Window::on_plate_error);
+    connect(loader, &PlateLoader::finished,
+            loader, &PlateLoader::deleteLater);
+    connect(loader, &PlateLoader::finished,
+              this, &Window::enable_open);
+    connect(loader, &PlateLoader::finished,
+            canvas, &Canvas::clear_status);
+
+    // A plate isn't a single file, so there's nothing to watch or reload
+    if (!watcher->files().isEmpty())
     {
-        auto urls = event->mimeData()->urls();
-        if (urls.size() == 1 && urls.front().path().endsWith(".stl"))
-            event->acceptProposedAction();
+        watcher->removePaths(watcher->files());
     }
-}
+    reload_action->setEnabled(false);
+    setWindowTitle(QString("fstl - %1 parts").arg(filenames.size()));
 
-void Window::dropEvent(QDropEvent *event)
-{
-    load_stl(event->mimeData()->urls().front().toLocalFile());
+    loader->start();
+    return true;
 }
 
-void Window::resizeEvent(QResizeEvent *event)
+bool Window::load_lod(const QString& filename)
 {
-    QSettings().setValue(WINDOW_GEOM_KEY, saveGeometry());
-    QWidget::resizeEvent(event);
-}
+    // Only the node table is read here; the canvas streams in the
+    // meshes themselves as it draws them.
+    LodMesh* lod = new LodMesh(filename);
+    QString error;
+    if (!lod->load(&error))
+    {
+        delete lod;
+        QMessageBox::critical(this, "Error",
+                              "<b>Error:</b><br>" + error.toHtmlEscaped());
+        return false;
+    }
 
-void Window::moveEvent(QMoveEvent *event)
-{
-    QSettings().setValue(WINDOW_GEOM_KEY, saveGeometry());
-    QWidget::moveEvent(event);
+    canvas->load_lod(lod);
+    setWindowTitle(filename);
+    set_watched(filename);
+    on_loaded(filename);
+    reload_action->setEnabled(true);
+    return true;
 }
 
-void Window::sorted_insert(QStringList& list, const QCollator& collator, const QString& value)
+bool Window::start_ingest(const QString& name)
 {
-    int start = 0;
-    int end = list.size() - 1;
-    int index = 0;
-    while (start <= end){
-        int mid = (start+end)/2;
-        if (list[mid] == value) {
-            return;
-        }
-        int compare = collator.compare(value, list[mid]);
-        if (compare < 0) {
-            end = mid-1;
-            index = mid;
-        } else {
-            start = mid+1;
-            index = start;
-        }
-    }
+    Ingest* ingest = new Ingest(this, name);
+    connect(ingest, &Ingest::frame_ready,
+            canvas, &Canvas::load_ingest);
+    connect(ingest, &Ingest::error,
+              this, &Window::on_ingest_error);
 
-    list.insert(index, value);
+    if (!ingest->start())
+    {
+        ingest->deleteLater();
+        return false;
+    }
+    setWindowTitle("fstl - " + name);
+    canvas->set_status("Waiting for " + name);
+    connect(ingest, &Ingest::frame_ready,
+            canvas, &Canvas::clear_status);
+    return true;
 }
 
-void Window::build_folder_file_list()
+void Window::dragEnterEvent(QDragEnterEvent *event)
 {
-    QString current_folder_path = QFileInfo(current_file).absoluteDir().absolutePath();
-    if (!lookup_folder_files.isEmpty())
+    if (event->mimeData()->hasUrls())
     {
-        if (current_folder_path == lookup_folder) {
-            return;
+        // Several files at once are packed onto a plate
+        auto urls = event->mimeData()->urls();
+        bool all_stl = true;
+        for (const auto& url : urls)
+        {
+            all_stl &= url.path().endsWith(".stl");
         }
-
-        lookup_folder_files.clear();
-    }
-    lookup_folder = current_folder_path;
-
-    QCollator collator;
-    collator.setNumericMode(true);
-
-    QDirIterator dirIterator(lookup_folder, QStringList() << "*.stl", QDir::Files | QDir::Readable | QDir::Hidden);
-    while (dirIterator.hasNext()) {
-        dirIterator.next();
-
-        QString name = dirIterator.fileName();
-        sorted_insert(lookup_folder_files, collator, name);
+        if (all_stl)
+            event->acceptProposedAction();
     }
 }
 
-QPair<QString, QString> Window::get_file_neighbors()
+void Window::dropEvent(QDropEvent *event)
 {
-    if (current_file.isEmpty()) {
-        return QPair<QString, QString>(QString(), QString());
+    const auto urls = event->mimeData()->urls();
+    if (urls.size() == 1)
+    {
+        load_stl(urls.front().toLocalFile());
     }
-
-    build_folder_file_list();
-
-    QFileInfo fileInfo(current_file);
-
-    QString current_dir = fileInfo.absoluteDir().absolutePath();
-    QString current_name = fileInfo.fileName();
-
-    QString prev = QString();
-    QString next = QString();
-
-    QListIterator<QString> fileIterator(lookup_folder_files);
-    while (fileIterator.hasNext()) {
-        QString name = fileIterator.next();
-
-        if (name == current_name) {
-            if (fileIterator.hasNext()) {
-                next = current_dir + QDir::separator() + fileIterator.next();
-            }
-            break;
+    else
+    {
+        QStringList filenames;
+        for (const auto& url : urls)
+        {
+            filenames << url.toLocalFile();
         }
-
-        prev = name;
+        load_plate(filenames);
     }
+}
 
-    if (!prev.isEmpty()) {
-        prev.prepend(QDir::separator());
-        prev.prepend(current_dir);
-    }
+void Window::resizeEvent(QResizeEvent *event)
+{
+    QSettings().setValue(WINDOW_GEOM_KEY, saveGeometry());
+    QWidget::resizeEvent(event);
+}
 
-    return QPair<QString, QString>(prev, next);
+void Window::moveEvent(QMoveEvent *event)
+{
+    QSettings().setValue(WINDOW_GEOM_KEY, saveGeometry());
+    QWidget::moveEvent(event);
 }
 
 bool Window::load_prev(void)
 {
-    QPair<QString, QString> neighbors = get_file_neighbors();
-    if (neighbors.first.isEmpty()) {
+    const QString prev = folder_index->neighbor(current_file, -1);
+    if (prev.isEmpty()) {
         return false;
     }
 
-    return load_stl(neighbors.first);
+    return load_stl(prev);
 }
 
 bool Window::load_next(void)
 {
-    QPair<QString, QString> neighbors = get_file_neighbors();
-    if (neighbors.second.isEmpty()) {
+    const QString next = folder_index->neighbor(current_file, 1);
+    if (next.isEmpty()) {
         return false;
     }
 
-    return load_stl(neighbors.second);
+    return load_stl(next);
 }
 
 void Window::keyPressEvent(QKeyEvent* event)
@@ -4,16 +4,26 @@
 #include <QMainWindow>
 #include <QActionGroup>
 #include <QFileSystemWatcher>
-#include <QCollator>
+
+#include "recent.h"
 
 class Canvas;
+class FolderGrid;
+class FolderIndex;
+class QualityPanel;
+class QDockWidget;
+class QTreeWidget;
+class QTreeWidgetItem;
 
 class Window : public QMainWindow
 {
     Q_OBJECT
 public:
-    explicit Window(QWidget* parent=0);
-    bool load_stl(const QString& filename, bool is_reload=false);
+    explicit Window(QWidget* parent=0, bool core_gl=false);
+    bool load_stl(const QString& filename, bool is_reload=false,
+                  bool skip_unchanged=false);
+    bool load_plate(const QStringList& filenames);
+    bool start_ingest(const QString& name);
     bool load_prev(void);
     bool load_next(void);
 
@@ -26,10 +36,14 @@ protected:
 
 public slots:
     void on_open();
+    void on_pack();
+    void on_find_duplicates();
     void on_about();
     void on_bad_stl();
     void on_empty_mesh();
     void on_missing_file();
+    void on_ingest_error(const QString& message);
+    void on_plate_error(const QString& message);
 
     void enable_open();
     void disable_open();
@@ -41,6 +55,18 @@ private slots:
     void on_drawMode(QAction* mode);
     void on_drawAxes(bool d);
     void on_invertZoom(bool d);
+    void on_autoSplats(bool d);
+    void on_showPerformance(bool d);
+    void on_showSlice(bool d);
+    void on_sliceUp();
+    void on_sliceDown();
+    void on_showOrientedBox(bool d);
+    void on_showQuality(bool d);
+    void on_showFolderGrid(bool d);
+    void on_facetNormals(bool d);
+    void on_fixWinding(bool d);
+    void on_fillHoles(bool d);
+    void on_orientForPrinting(bool d);
     void on_resetTransformOnLoad(bool d);
     void on_watched_change(const QString& filename);
     void on_reload();
@@ -48,18 +74,25 @@ private slots:
     void on_clear_recent();
     void on_load_recent(QAction* a);
     void on_loaded(const QString& filename);
+    void on_fingerprint(quint64 fingerprint);
+    void on_summary(FileSummary* summary);
     void on_save_screenshot();
     void on_fullscreen();
     void on_hide_menuBar();
+    void on_duplicate_progress(int done, int total);
+    void on_duplicates(const QList<QStringList>& groups,
+                       const QStringList& unreadable);
+    void on_duplicate_activated(QTreeWidgetItem* item);
+    void on_folder_activated(const QString& filename);
 
 private:
+    bool load_lod(const QString& filename);
     void rebuild_recent_files();
     void load_persist_settings();
-    void sorted_insert(QStringList& list, const QCollator& collator, const QString& value);
-    void build_folder_file_list();
-    QPair<QString, QString> get_file_neighbors();
 
     QAction* const open_action;
+    QAction* const pack_action;
+    QAction* const duplicates_action;
     QAction* const about_action;
     QAction* const quit_action;
     QAction* const perspective_action;
@@ -67,10 +100,25 @@ private:
     QAction* const shaded_action;
     QAction* const wireframe_action;
     QAction* const surfaceangle_action;
+    QAction* const splats_action;
+    QAction* const mean_curvature_action;
+    QAction* const gaussian_curvature_action;
+    QAction* const auto_splats_action;
     QAction* const axes_action;
     QAction* const invert_zoom_action;
+    QAction* const performance_action;
+    QAction* const slice_action;
+    QAction* const slice_up_action;
+    QAction* const slice_down_action;
+    QAction* const oriented_box_action;
+    QAction* const quality_action;
+    QAction* const folder_grid_action;
     QAction* const reload_action;
     QAction* const autoreload_action;
+    QAction* const facet_normals_action;
+    QAction* const fix_winding_action;
+    QAction* const fill_holes_action;
+    QAction* const orient_action;
     QAction* const save_screenshot_action;
     QAction* const hide_menuBar_action;
     QAction* const fullscreen_action;
@@ -79,19 +127,52 @@ private:
     QMenu* const recent_files;
     QActionGroup* const recent_files_group;
     QAction* const recent_files_clear_action;
+
+    // Previews and details shown in the recent-files menu
+    RecentCache recent_cache;
+
+    // Groups of duplicate parts found by File > Find Duplicates
+    QDockWidget* const duplicates_dock;
+    QTreeWidget* const duplicates_tree;
+
+    // Histograms shown by View > Show Mesh Quality
+    QDockWidget* const quality_dock;
+    QualityPanel* const quality_panel;
+
     const static int MAX_RECENT_FILES=8;
     const static QString RECENT_FILE_KEY;
     const static QString INVERT_ZOOM_KEY;
     const static QString AUTORELOAD_KEY;
+    const static QString FACET_NORMALS_KEY;
+    const static QString FIX_WINDING_KEY;
+    const static QString FILL_HOLES_KEY;
+    const static QString ORIENT_FOR_PRINTING_KEY;
+    const static QString SHOW_SLICE_KEY;
+
+    // Voxel grid shown by the slice overlay
+    const static int VOXEL_RESOLUTION = 256;
+    const static int VOXEL_BAND = 3;
+    const static QString SHOW_ORIENTED_BOX_KEY;
+    const static QString SHOW_QUALITY_KEY;
+    const static QString SHOW_FOLDER_GRID_KEY;
     const static QString DRAW_AXES_KEY;
     const static QString PROJECTION_KEY;
     const static QString DRAW_MODE_KEY;
+    const static QString AUTO_SPLATS_KEY;
+    const static QString SHOW_PERFORMANCE_KEY;
     const static QString WINDOW_GEOM_KEY;
     const static QString RESET_TRANSFORM_ON_LOAD_KEY;
 
     QString current_file;
-    QString lookup_folder;
-    QStringList lookup_folder_files;
+
+    // Files in the folder of current_file, for the arrow keys and the
+    // grid shown by View > Show Folder Grid
+    FolderIndex* const folder_index;
+    QDockWidget* const folder_dock;
+    FolderGrid* const folder_grid;
+
+    // Contents hash of current_file when it was loaded
+    quint64 current_fingerprint;
 
     QFileSystemWatcher* watcher;
 